@@ -0,0 +1,62 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "jit.h"
+#include "types.h"
+
+namespace nes {
+
+// One instruction with fetch and decode already done
+struct DecodedInstruction {
+  u16 operand;  // Operand bytes, or the address of the value for immediate mode
+  u8 opcode;
+  u8 length;  // Opcode plus operand bytes
+  u8 cycles;  // Base cycles
+  u8 fetched;  // Last byte the fetch reads, left on the data bus: the opcode for implied and immediate modes
+  u8 pair = 0;  // If not 0, the CPU's pair table entry running this and the next instruction together
+};
+
+// Straight-line run of instructions, ending with the first branch, jump, call or return
+struct DecodedBlock {
+  u16 start;
+  u16 end;  // Address just past the last instruction
+  std::vector<DecodedInstruction> instructions;
+
+  u32 executions = 0;                 // Times entered, to find blocks worth translating
+  JitBlockFunction native = nullptr;  // Translated code, if any
+};
+
+// Decoded blocks keyed by the PC they start at. A block is dropped as soon as
+// any byte it was decoded from is written.
+class BlockCache final : public CodeWriteListener {
+ public:
+  static constexpr size_t MAX_BLOCK_INSTRUCTIONS = 32;
+
+  BlockCache();
+  ~BlockCache() = default;
+
+  DecodedBlock *find(u16 pc) const { return _blocks[pc].get(); }
+  DecodedBlock *insert(std::unique_ptr<DecodedBlock> block);
+  void clear();
+
+  // Bumped whenever a block is dropped, so a block that is running can tell it may be gone
+  u32 get_generation() const { return _generation; }
+  const u32 *get_generation_address() const { return &_generation; }
+
+  void code_written(u16 address) override;
+  void code_page_remapped(u8 page) override;
+
+ private:
+  static constexpr size_t ADDRESS_SPACE_SIZE = 64 * 1024;
+  static constexpr size_t PAGE_COUNT = 256;
+
+  std::vector<std::unique_ptr<DecodedBlock>> _blocks;
+  std::array<std::vector<u16>, PAGE_COUNT> _page_blocks;  // Start of every block overlapping each page
+  u32 _generation = 0;
+
+  void remove(u16 start);
+};
+
+}  // namespace nes
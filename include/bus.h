@@ -1,24 +1,254 @@
 #pragma once
 #include <array>
+#include <bitset>
 #include <cstddef>
+#include <memory>
+#include <vector>
 #include "types.h"
 
 namespace nes {
-class Bus : public Addressable {
+// Inclusive range of CPU addresses
+struct AddressRange {
+  u16 first;
+  u16 last;
+};
+
+// Final so CPU<Bus> can call read/write directly and inline them
+//
+// The address space is a table of 256-byte pages. A page is either backed by
+// host memory, so an access is one indexed load or store, or handed to a
+// device (MMIO). Out of the box $0000-$1FFF is the 2KB of RAM mirrored four
+// times, $FFFA-$FFFF hold the NMI/reset/IRQ vectors and everything else is open
+// bus: like on the hardware, nothing drives the data lines and a read returns
+// whatever value was last on them.
+class Bus final : public Addressable {
  public:
+  static constexpr size_t PAGE_SIZE = 256;
+  static constexpr size_t PAGE_COUNT = 256;
+
   Bus();
   ~Bus() = default;
+  Bus(const Bus &) = delete;  // Pages point into the bus itself
+  Bus &operator=(const Bus &) = delete;
+
   void write(u16 address, u8 data) override;
   void write_word(u16 address, u16 value);
   u8 read(u16 address) const override;
   u16 read_word(u16 address) const;
   bool handles_address(u16 address) const override;
 
+  // Bulk access, resolved once per page: memory pages are copied with
+  // memcpy/memset, device pages get one access per byte. Addresses wrap
+  // around at $FFFF. (Pointer and length, std::span needs C++20.)
+  void read_block(u16 address, u8 *data, size_t length) const;
+  void write_block(u16 address, const u8 *data, size_t length);
+  void fill(u16 address, u8 value, size_t length);
+
+  // Page mapping. A memory page with no write pointer is read-only, its
+  // writes go to write_device if there is one (bank registers behind ROM) and
+  // are dropped otherwise. An unmapped page reads open bus and drops writes. The
+  // memory must stay valid for as long as it is mapped. Remapping a page code
+  // was decoded from tells the code write listeners.
+  void map_memory(u8 page, const u8 *read_memory, u8 *write_memory, Addressable *write_device = nullptr);
+  void map_device(u8 page, Addressable *device);
+  void unmap(u8 page);
+
+  // Attaches a device to every address in range it handles_address(). Whole
+  // pages go straight into the page table; a partly covered page gets a
+  // per-byte table in front of whatever was mapped there before. Later
+  // mappings win where they overlap.
+  void map(AddressRange range, Addressable &device);
+
+  // Code page tracking for decoded-instruction caches. Writes into a marked
+  // page (through any of its mirrors) are reported to every listener.
+  void add_code_write_listener(CodeWriteListener *listener);
+  void remove_code_write_listener(CodeWriteListener *listener);
+  void mark_code_page(u8 page);
+
+  // Watching. Accesses to a watched page leave the direct path and are
+  // reported to the watcher, whatever the page is mapped to; pages that are
+  // not watched cost nothing extra. Watches stay on across remapping.
+  void set_memory_watcher(MemoryWatcher *watcher) { _watcher = watcher; }
+  void watch_page(u8 page, bool watched);
+  bool is_page_watched(u8 page) const { return _watched_pages[page]; }
+
+  // Dirty page tracking for snapshots and memory views. A page turns dirty
+  // when a write lands in its memory or on its device, or when it is remapped
+  // (writes dropped on ROM or open bus leave it clean);
+  // fetch_dirty_pages() returns the pages dirtied since the last fetch and
+  // clears them. RAM mirrors are reported together. Built without
+  // BUS_DIRTY_PAGES nothing is tracked and every page is always dirty.
+  std::bitset<PAGE_COUNT> fetch_dirty_pages();
+
+  // Data bus latch: the last value read or written by the CPU, which is what
+  // unmapped addresses read back. Bulk access leaves it alone, and so should
+  // tools peeking at memory (restore it with set_open_bus()).
+  u8 get_open_bus() const { return _open_bus; }
+  void set_open_bus(u8 value) { _open_bus = value; }
+
+  // Raw page tables for code generators that inline the memory path (the JIT).
+  // A null read or write entry means the page has to go through read()/write(),
+  // as must writes to code pages so the listeners hear about them. dirty is null
+  // when dirty pages are not tracked.
+  struct PageTables {
+    const u8 *const *read;
+    u8 *const *write;
+    const bool *code;
+    bool *dirty;
+    u8 *open_bus;
+  };
+  PageTables get_page_tables() {
+    return {_read_pages.data(), _write_pages.data(), _code_pages.data(), TRACKS_DIRTY_PAGES ? _dirty_pages.data() : nullptr,
+            &_open_bus};
+  }
+
+  // Reads a memory page without touching the latch or any device, for looking
+  // at code ahead of execution. Returns false where only a device can answer
+  // (watched pages included).
+  bool peek(u16 address, u8 &value) const {
+    const u8 *memory = _read_pages[address >> 8];
+    if (memory == nullptr) return false;
+    value = memory[address & 0xFF];
+    return true;
+  }
+
+  // Whether reading address can change device state. The CPU only skips idle
+  // loops whose reads are all free of side effects, which only memory pages
+  // promise (watched pages report every read, so they count as devices).
+  bool has_read_side_effects(u16 address) const { return _read_pages[address >> 8] == nullptr; }
+
  private:
   static constexpr size_t _CPU_RAM_SIZE = 2 * 1024;  // 2KB
-  static constexpr size_t _RESET_VECTOR_SIZE = 4;
+
+  // Unmapped pages, reads return the latch
+  class OpenBus final : public Addressable {
+   public:
+    explicit OpenBus(const u8 &latch)
+      : _latch(latch) {}
+    u8 read(u16 /*address*/) const override { return _latch; }
+    void write(u16 /*address*/, u8 /*value*/) override {}
+    bool handles_address(u16 /*address*/) const override { return true; }
+
+   private:
+    const u8 &_latch;
+  };
+
+  // $FFFA-$FFFF are the only bytes backed on the last page, the rest is open bus
+  class Vectors final : public Addressable {
+   public:
+    explicit Vectors(const u8 &latch)
+      : _latch(latch) {}
+    u8 read(u16 address) const override { return handles_address(address) ? _bytes[address - 0xFFFA] : _latch; }
+    void write(u16 address, u8 value) override {
+      if (handles_address(address)) _bytes[address - 0xFFFA] = value;
+    }
+    bool handles_address(u16 address) const override { return address >= 0xFFFA; }
+
+   private:
+    const u8 &_latch;
+    std::array<u8, 6> _bytes{};
+  };
+
+  // A page with a read pointer only takes writes from its device; one without always has one
+  struct PageMapping {
+    const u8 *read_memory;
+    u8 *write_memory;
+    Addressable *device;
+  };
+
+  // Page shared by several devices, or by devices and what was there before
+  class SplitPage final : public Addressable {
+   public:
+    explicit SplitPage(const PageMapping &fallback)
+      : _fallback(fallback) {}
+    u8 read(u16 address) const override;
+    void write(u16 address, u8 value) override;
+    bool handles_address(u16 /*address*/) const override { return true; }
+    void attach(u8 offset, Addressable *device) { _devices[offset] = device; }
+    const Addressable *device_at(u16 address) const { return _devices[address & 0xFF]; }
+    const PageMapping &get_fallback() const { return _fallback; }
+
+   private:
+    std::array<Addressable *, PAGE_SIZE> _devices{};
+    PageMapping _fallback;
+  };
+
+  // Stands in for every watched page and forwards to what is really mapped there
+  class WatchedPage final : public Addressable {
+   public:
+    explicit WatchedPage(Bus &bus)
+      : _bus(bus) {}
+    u8 read(u16 address) const override;
+    void write(u16 address, u8 value) override;
+    bool handles_address(u16 /*address*/) const override { return true; }
+
+   private:
+    Bus &_bus;
+  };
 
   std::array<u8, _CPU_RAM_SIZE> _ram{0};
-  std::array<u8, _RESET_VECTOR_SIZE> _reset_vector{0};
+  mutable u8 _open_bus = 0;
+  OpenBus _unmapped{_open_bus};
+  Vectors _vectors{_open_bus};
+  WatchedPage _watched_page{*this};
+
+  // What each page is mapped to, and the copy accesses go through: the same
+  // mapping, or the watched page stand-in while the page is watched
+  std::array<PageMapping, PAGE_COUNT> _mappings{};
+  std::array<const u8 *, PAGE_COUNT> _read_pages{};
+  std::array<u8 *, PAGE_COUNT> _write_pages{};
+  std::array<Addressable *, PAGE_COUNT> _devices{};
+  std::array<std::unique_ptr<SplitPage>, PAGE_COUNT> _split_pages;
+
+  void set_page(u8 page, const u8 *read_memory, u8 *write_memory, Addressable *device);
+  void apply_mapping(u8 page);
+
+  std::array<bool, PAGE_COUNT> _watched_pages{};
+  MemoryWatcher *_watcher = nullptr;
+
+  // A byte per page so the write path marks with a plain store. The table is
+  // always there so the layout does not depend on BUS_DIRTY_PAGES, only the
+  // stores are compiled out.
+#ifdef BUS_DIRTY_PAGES
+  static constexpr bool TRACKS_DIRTY_PAGES = true;
+#else
+  static constexpr bool TRACKS_DIRTY_PAGES = false;
+#endif
+  std::array<bool, PAGE_COUNT> _dirty_pages{};
+  void mark_dirty(u8 page) {
+    if constexpr (TRACKS_DIRTY_PAGES) _dirty_pages[page] = true;
+  }
+
+  // Whether a write to address through mapping changes what the page holds
+  bool write_lands(const PageMapping &mapping, u16 address) const;
+
+  std::array<bool, PAGE_COUNT> _code_pages{};
+  std::vector<CodeWriteListener *> _code_write_listeners;
+
+  void notify_code_write(u16 address);
+
+  // Kept out of line so the memory path inlined into the CPU stays small
+  u8 read_device(u16 address) const;
+  void write_device(u16 address, u8 value);
 };
+
+// Both paths store the latch unconditionally, so memory pages take no extra branch
+inline void Bus::write(u16 address, u8 value) {
+  const u8 page = address >> 8;
+  _open_bus = value;
+  if (u8 *memory = _write_pages[page]) {
+    memory[address & 0xFF] = value;
+    mark_dirty(page);
+  } else {
+    write_device(address, value);
+  }
+
+  if (_code_pages[page]) notify_code_write(address);
+}
+
+inline u8 Bus::read(u16 address) const {
+  const u8 *memory = _read_pages[address >> 8];
+  if (memory != nullptr) return _open_bus = memory[address & 0xFF];
+  return read_device(address);
+}
 }  // namespace nes
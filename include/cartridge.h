@@ -0,0 +1,114 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bus.h"
+#include "rom_image.h"
+#include "types.h"
+
+namespace nes {
+
+// Nametable layout the cartridge wires up for the PPU
+enum class Mirroring : u8 { HORIZONTAL, VERTICAL, SINGLE_SCREEN_LOWER, SINGLE_SCREEN_UPPER, FOUR_SCREEN };
+
+// What the 16-byte iNES / NES 2.0 header says about the rest of the file
+struct CartridgeHeader {
+  u16 mapper;
+  u8 submapper;
+  size_t prg_rom_size;
+  size_t chr_rom_size;  // 0 means the board has 8KB of CHR RAM instead
+  size_t prg_ram_size;
+  Mirroring mirroring;
+  bool battery;
+  bool trainer;  // 512 bytes between the header and PRG ROM
+  bool nes2;
+};
+
+// A cartridge and its mapper. PRG RAM sits at $6000-$7FFF and PRG ROM at
+// $8000-$FFFF; both are mapped into the Bus as memory pages, so the CPU reads
+// them directly. Writes to ROM land on the mapper's registers, and a bank
+// switch only points the affected pages somewhere else in the image.
+//
+// CHR is banked in 1KB slots for the PPU side through read_chr()/write_chr().
+class Cartridge : public Addressable {
+ public:
+  static constexpr size_t PRG_SLOT_SIZE = 8 * 1024;  // $8000, $A000, $C000, $E000
+  static constexpr size_t CHR_SLOT_SIZE = 1024;
+  static constexpr size_t HEADER_SIZE = 16;
+  static constexpr size_t TRAINER_SIZE = 512;
+
+  // Returns false if data does not start with a usable iNES / NES 2.0 header
+  static bool parse_header(const u8 *data, size_t size, CartridgeHeader &header);
+
+  // Build the cartridge for an image, or nullptr if it is not an iNES / NES 2.0
+  // file, is truncated or needs a mapper that is not supported (NROM, MMC1,
+  // UxROM, CNROM and MMC3 are). Files are memory-mapped (see RomImage), and
+  // PRG ROM pages go into the Bus pointing straight at the mapping.
+  static std::unique_ptr<Cartridge> load(RomImage image);
+  static std::unique_ptr<Cartridge> load(std::vector<u8> image) { return load(RomImage(std::move(image))); }
+  static std::unique_ptr<Cartridge> load_file(const std::string &path) { return load(RomImage::open(path)); }
+
+  ~Cartridge() override = default;
+
+  // Maps PRG RAM and ROM into bus. The cartridge must outlive the mapping.
+  void insert(Bus &bus);
+
+  // $6000-$FFFF as the CPU sees it, writes to ROM go to the mapper registers
+  u8 read(u16 address) const override;
+  void write(u16 address, u8 value) override;
+  bool handles_address(u16 address) const override { return address >= 0x6000; }
+
+  // Pattern tables, $0000-$1FFF on the PPU bus. Writes only stick on CHR RAM.
+  u8 read_chr(u16 address) const { return _chr[_chr_offsets[(address >> 10) & 0x07] + (address & 0x03FF)]; }
+  void write_chr(u16 address, u8 value);
+
+  const CartridgeHeader &get_header() const { return _header; }
+  const RomImage &get_image() const { return _image; }
+  Mirroring get_mirroring() const { return _mirroring; }
+
+  // Scanline counter for mappers that raise IRQs (MMC3), clocked by the PPU
+  // once per rendered line. The IRQ output is meant for CPU::set_irq_line().
+  virtual void clock_scanline() {}
+  bool irq_pending() const { return _irq_pending; }
+
+ protected:
+  Cartridge(RomImage image, const CartridgeHeader &header);
+
+  virtual void write_register(u16 address, u8 value) = 0;
+
+  // Banks are counted in slots. Bank numbers wrap around the size of the
+  // image, like the unconnected address lines would.
+  size_t prg_bank_count() const { return _header.prg_rom_size / PRG_SLOT_SIZE; }
+  size_t chr_bank_count() const { return _chr_size / CHR_SLOT_SIZE; }
+  void set_prg_bank(u8 slot, size_t bank);
+  void set_prg_bank_16k(u8 half, size_t bank);
+  void set_chr_bank(u8 slot, size_t bank);
+  void set_chr_bank_4k(u8 half, size_t bank);
+  void set_chr_bank_8k(size_t bank);
+  void set_prg_ram_access(bool readable, bool writable);
+
+  Mirroring _mirroring;
+  bool _irq_pending = false;
+
+ private:
+  RomImage _image;
+  CartridgeHeader _header;
+  const u8 *_prg;
+  const u8 *_chr;
+  size_t _chr_size;
+  std::vector<u8> _chr_ram;
+  std::vector<u8> _prg_ram;
+  bool _prg_ram_readable = true;
+  bool _prg_ram_writable = true;
+
+  std::array<size_t, 4> _prg_offsets{};
+  std::array<size_t, 8> _chr_offsets{};
+  Bus *_bus = nullptr;
+
+  void map_prg_slot(u8 slot);
+  void map_prg_ram();
+};
+
+}  // namespace nes
@@ -1,12 +1,41 @@
 #pragma once
 #include <array>
 #include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <utility>
+#include "block_cache.h"
 #include "bus.h"
+#include "flat_bus.h"
+#include "jit.h"
+#include "scheduler.h"
 #include "types.h"
 
 namespace nes {
 
-class CPU {
+// 6502 core templated on its memory system. Memory must provide
+// u8 read(u16) and void write(u16, u8); when those are non-virtual (or the
+// type is final) every memory access is inlined into the opcode handlers.
+// Model picks the chip, so variant differences cost nothing at runtime.
+template <typename Memory, Variant Model = Variant::RICOH_2A03>
+class BasicCPU {
+ public:
+  // Hot dispatch entry, one per opcode. Kept to a handler and two bytes so the
+  // whole table stays small; names and modes live in InstructionInfo.
+  struct Instruction {
+    static constexpr u8 EXTRA_CYCLE = 0x01;  // Costs one more cycle when a page is crossed
+    static constexpr u8 IMPLIED = 0x02;      // Takes no operand address
+
+    void (*handler)(BasicCPU &cpu);  // Fused addressing mode + operation
+    u8 cycles;                       // Base cycles, 0 for unknown opcodes
+    u8 flags;
+  };
+
+  // Called with the PC on an unknown opcode. Returns the cycles to charge after
+  // dealing with it (usually by moving the PC on), or 0 to halt.
+  using FaultHook = std::function<u8(BasicCPU &cpu, u8 opcode)>;
+
  private:
   // CPU Registers
   u8 _A;       // Accumulator
@@ -17,31 +46,217 @@ class CPU {
   u16 _PC;     // Program Counter
   u8 _cycles;  // Remaining cycles for current instruction
 
-  // Reference to the bus for memory access
-  Bus &_bus;
+  // Reference to the memory system
+  Memory &_bus;
 
   // Used for addressing mode to know if a page is crossed to add a cycle
   bool _page_crossed = false;
 
-  // Instruction table mapping opcodes to handlers
+  // Everything an instruction boundary has to act on (a latched NMI, an active
+  // IRQ line, a halt) sets a bit here, so the common case tests one byte.
+  static constexpr u8 SIGNAL_NMI = 0x01;
+  static constexpr u8 SIGNAL_IRQ = 0x02;
+  static constexpr u8 SIGNAL_HALT = 0x04;
+  static constexpr u8 SIGNAL_IDLE_LOOP = 0x08;  // A short backward jump may have closed an idle loop
+  static constexpr u8 SIGNAL_EXCEPTION = 0x10;  // A handler called from translated code threw
+  u8 _pending_signals = 0;
+  bool _nmi_line = false;
+
+  // Idle-loop skipping. A loop qualifies when it is at most IDLE_LOOP_MAX_INSTRUCTIONS
+  // reads, compares and flag operations closed by one jump back to its head. It is
+  // skipped once a whole iteration has left every register unchanged, since nothing
+  // else can change until an event or interrupt ends the run() batch.
+  static constexpr u16 IDLE_LOOP_MAX_BYTES = 16;
+  static constexpr u8 IDLE_LOOP_MAX_INSTRUCTIONS = 8;
+  struct IdleLoop {
+    u16 head = 0;      // First instruction of the loop
+    u16 branch = 0;    // Jump or branch back to the head
+    u8 cycles = 0;     // Cycles per iteration, 0 if the loop can not be idle
+    bool seen = false; // The state below was recorded at the head during this run()
+    u8 a = 0, x = 0, y = 0, sp = 0, status = 0;
+    u64 elapsed = 0;
+  };
+  // Heads of loops found not to be idle, direct-mapped on their low bits so
+  // several loops taking turns are each only looked at once
+  static constexpr u32 NO_IDLE_LOOP = 0x10000;
+  static constexpr size_t IDLE_LOOP_REJECTED_SLOTS = 64;
+  using RejectedIdleLoops = std::array<u32, IDLE_LOOP_REJECTED_SLOTS>;
+  static constexpr RejectedIdleLoops NO_REJECTED_IDLE_LOOPS = [] {
+    RejectedIdleLoops heads{};
+    for (u32 &head : heads) head = NO_IDLE_LOOP;
+    return heads;
+  }();
+  bool is_idle_loop_rejected(const u16 head) const { return _idle_loop_rejected[head % IDLE_LOOP_REJECTED_SLOTS] == head; }
+  bool _idle_loop_skip = false;
+  bool _idle_loop_armed = false;  // Only run() can skip, so jumps only raise the signal inside it
+  RejectedIdleLoops _idle_loop_rejected = NO_REJECTED_IDLE_LOOPS;
+  IdleLoop _idle_loop;
+  u64 _idle_cycles_skipped = 0;
+  u64 _idle_loop_checks = 0;
+
+  // Unknown opcode handling
+  FaultPolicy _fault_policy = FaultPolicy::HALT;
+  FaultHook _fault_hook;
+  Fault _fault = Fault::NONE;
+  u8 _fault_opcode = 0;
+
+  // Lazy flag evaluation (CPU_LAZY_FLAGS): handlers only record what N, Z, C and V
+  // depend on, and _status is materialized when something actually reads it
+#ifdef CPU_LAZY_FLAGS
+  static constexpr bool LAZY_FLAGS = true;
+#else
+  static constexpr bool LAZY_FLAGS = false;
+#endif
+  u8 _negative_result = 0;  // N is bit 7 of the last result that set it
+  u8 _zero_result = 1;      // Z is set when the last result that set it was 0
+  u8 _carry = 0;            // C as 0 or 1
+  u8 _overflow_lhs = 0;     // V is derived from the last ADC/SBC operands and result
+  u8 _overflow_rhs = 0;
+  u8 _overflow_result = 0;
+
+  // The 2A03 ignores the D flag, so its ADC/SBC never test it
+  static constexpr bool HAS_DECIMAL_MODE = Model != Variant::RICOH_2A03;
+
+  // Instruction table mapping opcodes to handlers, built at compile time from
+  // opcodes.def plus the variant's own list and shared by every CPU of the same type
   static constexpr size_t INSTRUCTION_TABLE_SIZE = 256;
-  std::array<Instruction, INSTRUCTION_TABLE_SIZE> _instruction_table;
+  using InstructionTable = std::array<Instruction, INSTRUCTION_TABLE_SIZE>;
+  static const InstructionTable _instruction_table;
+  static constexpr InstructionTable build_instruction_table();
+
+  // Per-opcode entry used to execute instructions out of the block cache,
+  // where the operand was already fetched when the block was decoded
+  struct DecodedOperation {
+    void (*handler)(BasicCPU &cpu, u16 operand);
+    AddressingMode mode;
+    bool ends_block;  // Branches, jumps, calls and returns end a block
+  };
+  using DecodedTable = std::array<DecodedOperation, INSTRUCTION_TABLE_SIZE>;
+  static const DecodedTable _decoded_table;
+  static constexpr DecodedTable build_decoded_table();
+
+  // Superinstructions: common pairs of adjacent instructions the block decoder
+  // marks so both run through one handler, without a second dispatch or the
+  // flags the first one only sets for the second to test. Pairs are only
+  // formed in decoded blocks, so they need the block cache; clock(),
+  // step_instruction() and run() without the cache execute one instruction at a time.
+  enum class Pairing : u8 { LOAD_STORE, CLEAR_ADD, SET_SUBTRACT, DECREMENT_BRANCH, INCREMENT_COMPARE, COMPARE_BRANCH };
+  struct PairedOperation {
+    u8 first;
+    u8 second;
+    // Returns false when only the first instruction ran
+    bool (*handler)(BasicCPU &cpu, const DecodedInstruction &first, const DecodedInstruction &second);
+  };
+  static constexpr size_t PAIR_TABLE_SIZE = 64;
+  using PairTable = std::array<PairedOperation, PAIR_TABLE_SIZE>;
+  static const PairTable _pair_table;
+  static constexpr PairTable build_pair_table();
+  static u8 find_pair(const u8 first, const u8 second);
+
+  // Only allocated while the block cache is enabled
+  std::unique_ptr<BlockCache> _block_cache;
+
+  // Per-address branch outcomes, only allocated while branch statistics are enabled
+  std::unique_ptr<std::array<BranchStats, 0x10000>> _branch_stats;
+
+  // Native translation of hot blocks (CPU_JIT turns it on by default). A block
+  // is translated once it has been entered more than JIT_HOT_THRESHOLD times.
+#ifdef CPU_JIT
+  static constexpr bool JIT_BY_DEFAULT = true;
+#else
+  static constexpr bool JIT_BY_DEFAULT = false;
+#endif
+#ifdef CPU_JIT_HOT_THRESHOLD
+  static constexpr u32 JIT_HOT_THRESHOLD = CPU_JIT_HOT_THRESHOLD;
+#else
+  static constexpr u32 JIT_HOT_THRESHOLD = 16;
+#endif
+  std::unique_ptr<JitCompiler> _jit;
+
+  // Translated code has no unwind information, so its entry points catch whatever
+  // a handler, device or fault hook throws and run_blocks() rethrows it
+  std::exception_ptr _jit_exception;
+
+  // Entry points for translated code, which only has a void * to the CPU
+  template <u8 Opcode>
+  static void execute_from_jit(void *cpu, const u16 operand);
+  using JitEntryTable = std::array<void (*)(void *cpu, u16 operand), INSTRUCTION_TABLE_SIZE>;
+  static const JitEntryTable _jit_entries;
+  template <size_t... Opcodes>
+  static constexpr JitEntryTable build_jit_entries(std::index_sequence<Opcodes...>);
+
+  // Decode and execute one whole instruction, returns the cycles it took
+  u8 execute_instruction();
+
+  // Enters a pending interrupt, returns its cycles or 0 if none can be taken
+  u8 service_interrupt();
+
+  // Applies the fault policy to an unknown opcode the PC has just moved past,
+  // returns the cycles to charge or 0 once halted
+  u8 handle_unknown_opcode(const u8 opcode);
+  u64 skip_idle_loop(const u64 elapsed, const u64 cycle_budget);
+  u8 measure_idle_loop(const u16 head, u16 &branch);
+
+  // Block cache execution
+  DecodedBlock *decode_block(const u16 pc);
+
+  // Reads code ahead of execution (decoding, idle-loop checks) without touching
+  // the data bus latch or any device. Returns false where only a device could answer.
+  bool peek_byte(const u16 address, u8 &value) const;
+
+  // Leaves what the skipped fetch of a decoded instruction would have read on
+  // the data bus, on memory that emulates open bus
+  void latch_fetched(const u8 value);
+  // Returns false when the block can not be translated and has to be interpreted
+  bool compile_block(DecodedBlock &block);
+  u64 run_blocks(const u64 cycle_budget);
+
+  // Fused handlers, instantiated once per opcode
+  template <AddressingMode Mode, void (BasicCPU::*Operation)(u16), bool ExtraCycle>
+  static void execute_addressed(BasicCPU &cpu);
+  template <void (BasicCPU::*Operation)()>
+  static void execute_implied(BasicCPU &cpu);
+  template <AddressingMode Mode, void (BasicCPU::*Operation)(u16), bool ExtraCycle>
+  static void execute_decoded(BasicCPU &cpu, const u16 operand);
+  template <void (BasicCPU::*Operation)()>
+  static void execute_decoded_implied(BasicCPU &cpu, const u16 /*operand*/);
+  template <Pairing Kind, u8 First, u8 Second>
+  static bool execute_pair(BasicCPU &cpu, const DecodedInstruction &first, const DecodedInstruction &second);
 
   // Flag operations
   void update_zero_and_negative_flags(const u8 value);
+  void update_overflow_flag(const u8 lhs, const u8 rhs, const u8 result);
+
+  // ALU steps shared by the official and the combined undocumented operations
+  void add_with_carry(const u8 value, const bool carry);
+  void subtract_with_borrow(const u8 value, const bool carry);
+  void compare(const u8 reg, const u8 value);
+  u8 shift_left(const u8 value);
+  u8 shift_right(const u8 value);
+  u8 rotate_left(const u8 value);
+  u8 rotate_right(const u8 value);
+  void add_decimal(const u8 value, const bool carry);
+  void subtract_decimal(const u8 value, const bool carry);
 
-  // Addressing modes
-  u16 immediate();
-  u16 zero_page();
-  u16 zero_page_x();
-  u16 zero_page_y();
-  u16 absolute();
-  u16 absolute_x();
-  u16 absolute_y();
-  u16 indirect_x();
-  u16 indirect_y();
-  u16 absolute_indirect();
-  u16 relative();
+  // Addressing modes. The operand bytes are fetched first and then resolved
+  // into the effective address, so cached blocks can skip the fetch.
+  template <AddressingMode Mode>
+  u16 fetch_address();
+  template <AddressingMode Mode>
+  u16 fetch_operand();
+  template <AddressingMode Mode>
+  u16 resolve_address(const u16 operand);
+  template <AddressingMode Mode, bool ExtraCycle>
+  u16 resolve_and_charge(const u16 operand);
+  u16 zero_page_x(const u16 operand);
+  u16 zero_page_y(const u16 operand);
+  u16 absolute_x(const u16 operand);
+  u16 absolute_y(const u16 operand);
+  u16 indirect_x(const u16 operand);
+  u16 indirect_y(const u16 operand);
+  u16 absolute_indirect(const u16 operand);
+  u16 zero_page_indirect(const u16 operand);
+  u16 absolute_indexed_indirect(const u16 operand);
 
   // Operations that require an address
   // Load operations
@@ -71,19 +286,50 @@ class CPU {
   // Increment/Decrement operations
   void op_inc(u16 addr);
   void op_dec(u16 addr);
-  // Branching operations
-  void op_bcc(u16 addr);
-  void op_bcs(u16 addr);
-  void op_beq(u16 addr);
-  void op_bmi(u16 addr);
-  void op_bne(u16 addr);
-  void op_bpl(u16 addr);
-  void op_bvc(u16 addr);
-  void op_bvs(u16 addr);
+  // Branching operations. Code is the branch opcode, xxy10000: xx picks the
+  // flag from BRANCH_CONDITIONS and y the value it must have for the branch to be taken.
+  struct BranchCondition {
+    Flag flag;
+    bool expected;
+  };
+  static constexpr std::array<BranchCondition, 8> BRANCH_CONDITIONS = {{
+      {Flag::NEGATIVE, false},   // BPL
+      {Flag::NEGATIVE, true},    // BMI
+      {Flag::OVERFLOW_, false},  // BVC
+      {Flag::OVERFLOW_, true},   // BVS
+      {Flag::CARRY, false},      // BCC
+      {Flag::CARRY, true},       // BCS
+      {Flag::ZERO, false},       // BNE
+      {Flag::ZERO, true},        // BEQ
+  }};
+  template <u8 Code>
+  void op_branch(u16 offset);
+  void branch(const bool taken, u16 offset);
+  void take_branch(u16 offset);
   // Control-Flow operations
   void op_jmp(u16 addr);
   void op_jsr(u16 addr);
   void op_jmp_ind(u16 addr);
+  // Undocumented operations
+  void op_lax(u16 addr);
+  void op_sax(u16 addr);
+  void op_dcp(u16 addr);
+  void op_isc(u16 addr);
+  void op_slo(u16 addr);
+  void op_rla(u16 addr);
+  void op_sre(u16 addr);
+  void op_rra(u16 addr);
+  void op_anc(u16 addr);
+  void op_alr(u16 addr);
+  void op_arr(u16 addr);
+  void op_axs(u16 addr);
+  void op_nop_read(u16 addr);
+  // 65C02 operations
+  void op_bit_imm(u16 addr);
+  void op_stz(u16 addr);
+  void op_tsb(u16 addr);
+  void op_trb(u16 addr);
+  void op_bra(u16 addr);
 
   // Operations that don't require an address (implied operations)
   // No operation
@@ -100,6 +346,10 @@ class CPU {
   void op_php();
   void op_pla();
   void op_plp();
+  void op_phx();
+  void op_phy();
+  void op_plx();
+  void op_ply();
   // Shift/Rotate operations
   void op_asl_acc();
   void op_lsr_acc();
@@ -110,6 +360,8 @@ class CPU {
   void op_iny();
   void op_dex();
   void op_dey();
+  void op_inc_acc();
+  void op_dec_acc();
   // Flag operations
   void op_clc();
   void op_cld();
@@ -124,33 +376,131 @@ class CPU {
   void op_rts();
 
  public:
-  CPU(Bus &bus_ref);
-  ~CPU() = default;
+  BasicCPU(Memory &bus_ref);
+  ~BasicCPU();
 
   // Core methods
   void clock();
   void reset();
 
+  // Instruction-granular execution. A halted CPU (see FaultPolicy) consumes no
+  // cycles: step_instruction() returns 0 and the run methods return early.
+  u8 step_instruction();              // Run one instruction to completion, returns cycles consumed
+  u64 run(const u64 cycle_budget);    // Run whole instructions until the budget is used, returns cycles consumed
+
+  // Runs in batches of whole instructions up to each scheduled event, firing it
+  // before continuing, until the scheduler reaches target_cycle. Returns cycles consumed.
+  u64 run_until(Scheduler &scheduler, const u64 target_cycle);
+
+  // Decoded-block cache used by run(). Needs a memory type that reports writes
+  // into code pages (Bus); returns whether the cache is now enabled. Common
+  // instruction pairs only run as superinstructions from the cache.
+  bool set_block_cache_enabled(const bool enabled);
+  bool is_block_cache_enabled() const { return _block_cache != nullptr; }
+
+  // Translates hot cached blocks to native code (x86-64 Linux only), turning the
+  // block cache on with it. clock() and step_instruction() always interpret.
+  bool set_jit_enabled(const bool enabled);
+  bool is_jit_enabled() const { return _jit != nullptr; }
+
+  // Taken/not-taken counts per branch address, for profiling. Counting costs one
+  // test per branch while disabled; enabling starts from zero.
+  void set_branch_stats_enabled(const bool enabled);
+  bool is_branch_stats_enabled() const { return _branch_stats != nullptr; }
+  BranchStats get_branch_stats(const u16 address) const { return _branch_stats ? (*_branch_stats)[address] : BranchStats{}; }
+  void clear_branch_stats();
+
+  // Fast-forwards run() through provably idle polling loops (e.g. `JMP *` or
+  // `BIT $xx / BPL`) up to the end of its budget, i.e. the next scheduled event.
+  // Registers, memory and cycle counts end up exactly as if the loop had run.
+  // Needs a memory type that reports read side effects (Bus) and is on by default there.
+  bool set_idle_loop_skip_enabled(const bool enabled);
+  bool is_idle_loop_skip_enabled() const { return _idle_loop_skip; }
+  u64 get_idle_cycles_skipped() const { return _idle_cycles_skipped; }
+  // How many times the code of a candidate loop was walked to see whether it is idle
+  u64 get_idle_loop_checks() const { return _idle_loop_checks; }
+
+  // Interrupt lines, sampled at instruction boundaries. NMI is edge-triggered:
+  // it is latched when the line becomes active and taken once. IRQ is
+  // level-triggered: it is taken at every boundary while the line is active
+  // and the I flag is clear.
+  void set_nmi_line(const bool active);
+  void trigger_nmi() { _pending_signals |= SIGNAL_NMI; }
+  void set_irq_line(const bool active);
+  bool is_nmi_pending() const { return (_pending_signals & SIGNAL_NMI) != 0; }
+  bool is_irq_line_active() const { return (_pending_signals & SIGNAL_IRQ) != 0; }
+
+  // Unknown opcode handling
+  void set_fault_policy(const FaultPolicy policy) { _fault_policy = policy; }
+  void set_fault_hook(FaultHook hook) { _fault_hook = std::move(hook); }
+  FaultPolicy get_fault_policy() const { return _fault_policy; }
+  Fault get_fault() const { return _fault; }
+  u8 get_fault_opcode() const { return _fault_opcode; }
+  bool is_halted() const { return (_pending_signals & SIGNAL_HALT) != 0; }
+  void clear_fault();
+
   // Getters
-  u8 get_accumulator() const;
-  u8 get_x() const;
-  u8 get_y() const;
-  u16 get_pc() const;
-  u8 get_sp() const;
+  u8 get_accumulator() const { return _A; }
+  u8 get_x() const { return _X; }
+  u8 get_y() const { return _Y; }
+  u16 get_pc() const { return _PC; }
+  u8 get_sp() const { return _SP; }
   u8 get_status() const;
-  u8 get_remaining_cycles() const;
+  u8 get_remaining_cycles() const { return _cycles; }
   bool get_flag(Flag flag) const;
-  Instruction get_instruction(const Opcode opcode) const;
+  Instruction get_instruction(const Opcode opcode) const { return _instruction_table[(u8)opcode]; }
+  static const InstructionInfo &get_instruction_info(const u8 opcode);
 
   // Setters
-  void set_sp(u8 sp);
-  void set_pc(u16 sp);
+  void set_sp(const u8 sp) { _SP = sp; }
+  void set_pc(const u16 pc) { _PC = pc; }
   void set_flag(const Flag flag, const bool value);
   void set_status(const u8 status);
 
   // Memory access methods
-  u8 read_byte(u16 address);
-  void write_byte(const u16 address, const u8 value);
+  u8 read_byte(const u16 address) { return _bus.read(address); }
+  void write_byte(const u16 address, const u8 value) { _bus.write(address, value); }
 };
 
+// NES CPU with every access inlined into the concrete Bus
+using CPU = BasicCPU<Bus>;
+
+// CPU that reaches memory through the virtual Addressable interface,
+// for memory systems only known at runtime
+using DynamicCPU = BasicCPU<Addressable>;
+
+// Generic 6502 and 65C02 cores with decimal mode, for non-NES binaries
+using CPU6502 = BasicCPU<Bus, Variant::NMOS_6502>;
+using CPU65C02 = BasicCPU<Bus, Variant::CMOS_65C02>;
+
+// Cores over 64KB of flat RAM for test ROMs and fuzzing, see FlatBus
+using FlatCPU = BasicCPU<FlatBus>;
+using FlatCPU6502 = BasicCPU<FlatBus, Variant::NMOS_6502>;
+
+template <typename Memory, Variant Model>
+inline bool BasicCPU<Memory, Model>::get_flag(Flag flag) const {
+  if constexpr (LAZY_FLAGS) {
+    switch (flag) {
+      case Flag::NEGATIVE:
+        return (_negative_result & 0x80) != 0;
+      case Flag::ZERO:
+        return _zero_result == 0;
+      case Flag::CARRY:
+        return _carry != 0;
+      case Flag::OVERFLOW_:
+        return ((_overflow_lhs ^ _overflow_result) & (_overflow_rhs ^ _overflow_result) & 0x80) != 0;
+      default:
+        break;
+    }
+  }
+  return (_status & (u8)(flag)) != 0;
+}
+
+extern template class BasicCPU<Bus>;
+extern template class BasicCPU<Addressable>;
+extern template class BasicCPU<Bus, Variant::NMOS_6502>;
+extern template class BasicCPU<Bus, Variant::CMOS_65C02>;
+extern template class BasicCPU<FlatBus>;
+extern template class BasicCPU<FlatBus, Variant::NMOS_6502>;
+
 }  // namespace nes
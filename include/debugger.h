@@ -17,6 +17,14 @@
 
 namespace nes {
 
+// The debugger drives the inlined NES CPU unless built with DEBUGGER_DYNAMIC_BUS,
+// which routes its memory accesses through the virtual Addressable interface instead
+#ifdef DEBUGGER_DYNAMIC_BUS
+using DebuggerCPU = DynamicCPU;
+#else
+using DebuggerCPU = CPU;
+#endif
+
 struct DisassembledInstruction {
   u16 address;
   u8 opcode;
@@ -27,9 +35,20 @@ struct DisassembledInstruction {
   u8 cycles;
 };
 
-class Debugger {
+// What a watchpoint fires on; CHANGE only fires on writes that change the value
+enum class WatchType : u8 { READ = 0x01, WRITE = 0x02, CHANGE = 0x04 };
+
+struct WatchHit {
+  u16 address;
+  WatchType type;
+  u8 old_value;
+  u8 value;
+};
+
+class Debugger : public MemoryWatcher {
  public:
-  Debugger(CPU& cpu, Bus& bus);
+  Debugger(DebuggerCPU& cpu, Bus& bus);
+  ~Debugger() override;
 
   // Execution control
   void step();
@@ -45,6 +64,15 @@ class Debugger {
   bool has_breakpoint(u16 address) const;
   std::vector<u16> get_breakpoints() const;
 
+  // Watchpoint methods. types is a mask of WatchType bits; step() stops after
+  // an instruction that hit one. Only the pages holding watchpoints are
+  // watched on the Bus, so the rest of memory runs at full speed.
+  void add_watchpoint(u16 address, u8 types);
+  void remove_watchpoint(u16 address);
+  void clear_watchpoints();
+  bool has_watchpoint(u16 address) const;
+  const std::vector<WatchHit>& get_watch_hits() const;
+
   // State inspection methods
   u8 get_register_a() const;
   u8 get_register_x() const;
@@ -60,10 +88,16 @@ class Debugger {
   void write_memory(u16 address, u8 value);
   std::vector<u8> read_memory_range(u16 start, u16 end) const;
   std::vector<u8> get_stack() const;
+  // Last value on the data bus, what unmapped addresses read back
+  u8 get_open_bus() const;
+  // Pages written or remapped since the last call, see Bus::fetch_dirty_pages()
+  std::vector<u8> fetch_dirty_pages();
 
   // Statistics
   u64 get_instruction_count() const;
   u64 get_cycle_count() const;
+  void set_branch_stats_enabled(bool enabled);
+  BranchStats get_branch_stats(u16 address) const;
 
   // Disassembly methods
   DisassembledInstruction disassemble_instruction(u16 address) const;
@@ -77,17 +111,26 @@ class Debugger {
 
  private:
   void check_breakpoints();
-  void init_addressing_mode_table();
 
-  CPU& _cpu;
+  // MemoryWatcher
+  void memory_read(u16 address, u8 value) override;
+  void memory_written(u16 address, u8 old_value, u8 value) override;
+  void record_hit(u16 address, WatchType type, u8 old_value, u8 value);
+
+  // Reads memory for the debugger itself without tripping watchpoints or
+  // disturbing the open bus latch
+  u8 peek(u16 address) const;
+
+  DebuggerCPU& _cpu;
   Bus& _bus;
   bool _running;
   u64 _instruction_count;
   u64 _cycle_count;
   std::unordered_map<u16, bool> _breakpoints;
-
-  // Lookup table for addressing modes by opcode
-  std::array<std::string, 256> _addressing_mode_table;
+  std::unordered_map<u16, u8> _watchpoints;
+  std::array<u16, Bus::PAGE_COUNT> _watchpoints_per_page{};
+  std::vector<WatchHit> _watch_hits;
+  mutable bool _inspecting = false;
 };
 
 }  // namespace nes
@@ -0,0 +1,59 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <vector>
+#include "types.h"
+
+namespace nes {
+// 64KB of RAM and nothing else: no mirrors, no devices, no page table. Every
+// address reads back what was last written there, which is what generic 6502
+// test ROMs (Klaus Dormann's functional tests and the like) and fuzz harnesses
+// expect. Final so BasicCPU<FlatBus> inlines each access to a single load or
+// store.
+class FlatBus final : public Addressable {
+ public:
+  static constexpr size_t SIZE = 64 * 1024;
+  static constexpr size_t PAGE_SIZE = 256;
+
+  FlatBus() = default;
+  ~FlatBus() override = default;
+  FlatBus(const FlatBus &) = delete;
+  FlatBus &operator=(const FlatBus &) = delete;
+
+  void write(u16 address, u8 value) override;
+  u8 read(u16 address) const override { return _memory[address]; }
+  bool handles_address(u16 /*address*/) const override { return true; }
+
+  // Same bulk interface as Bus, addresses wrap around at $FFFF
+  void read_block(u16 address, u8 *data, size_t length) const;
+  void write_block(u16 address, const u8 *data, size_t length);
+  void fill(u16 address, u8 value, size_t length);
+
+  // Code page tracking for decoded-instruction caches, as on Bus
+  void add_code_write_listener(CodeWriteListener *listener);
+  void remove_code_write_listener(CodeWriteListener *listener);
+  void mark_code_page(u8 page) { _code_pages[page] = true; }
+
+  // Plain memory, so every read can be skipped
+  bool has_read_side_effects(u16 /*address*/) const { return false; }
+  bool peek(u16 address, u8 &value) const {
+    value = _memory[address];
+    return true;
+  }
+
+  u8 *data() { return _memory.data(); }
+  const u8 *data() const { return _memory.data(); }
+
+ private:
+  std::array<u8, SIZE> _memory{};
+  std::array<bool, SIZE / PAGE_SIZE> _code_pages{};
+  std::vector<CodeWriteListener *> _code_write_listeners;
+
+  void notify_code_write(u16 address);
+};
+
+inline void FlatBus::write(u16 address, u8 value) {
+  _memory[address] = value;
+  if (_code_pages[address >> 8]) notify_code_write(address);
+}
+}  // namespace nes
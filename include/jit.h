@@ -0,0 +1,118 @@
+#pragma once
+#include <cstddef>
+#include "types.h"
+
+namespace nes {
+
+// Native code for one decoded block. Runs the block's instructions on cpu,
+// adding their cycles to elapsed, and returns early once budget is reached,
+// *generation changes (the block overwrote cached code) or an interrupt is
+// pending. Returns the new elapsed.
+using JitBlockFunction = u64 (*)(void *cpu, u64 elapsed, u64 budget, const u32 *generation);
+
+// What an instruction does when it is simple enough to be emitted inline.
+// Everything else, and every access that does not hit plain memory, runs the
+// instruction's handler instead.
+enum class JitOperation : u8 {
+  CALL,        // Call the handler
+  LOAD,        // reg = memory, sets N and Z
+  STORE,       // memory = reg
+  TRANSFER,    // reg = source, sets N and Z unless reg is SP
+  INCREMENT,   // reg++, sets N and Z
+  DECREMENT,   // reg--, sets N and Z
+  SET_FLAG,    // status |= flag
+  CLEAR_FLAG,  // status &= ~flag
+  BRANCH,      // PC += (s8)operand if the flag has the expected value, last in the block
+  JUMP,        // PC = operand, last in the block
+};
+
+enum class JitRegister : u8 { A, X, Y, SP };
+
+// How a LOAD or STORE finds its address
+enum class JitAddressing : u8 {
+  FIXED,              // operand is the address
+  ZERO_PAGE_INDEXED,  // (operand + index) & $FF
+  INDEXED,            // operand + index, wrapping at $FFFF
+};
+
+// What the compiler needs to know about one instruction
+struct JitInstruction {
+  void (*handler)(void *cpu, u16 operand);  // Decoded handler for the opcode, always set
+  u16 address;                              // Where the instruction starts
+  u16 operand;
+  u8 length;
+  u8 cycles;
+  u8 fetched;  // Put on the data bus latch before the instruction runs
+  JitOperation operation = JitOperation::CALL;
+  JitRegister reg = JitRegister::A;
+  JitAddressing addressing = JitAddressing::FIXED;
+  JitRegister index = JitRegister::X;  // Index register, or the TRANSFER source
+  bool extra_cycle = false;            // An INDEXED load costs one more cycle when it crosses a page
+  u8 flag = 0;                         // SET_FLAG, CLEAR_FLAG and BRANCH
+  bool expected = false;               // BRANCH is taken when the flag is set (true) or clear (false)
+};
+
+// Where the registers touched between handlers live inside the CPU object
+struct JitLayout {
+  size_t pc_offset;
+  size_t status_offset;
+  size_t cycles_offset;
+  size_t pending_signals_offset;
+  size_t register_offsets[4];  // Indexed by JitRegister
+
+  // A taken BRANCH or JUMP at most idle_loop_max_bytes backwards raises
+  // idle_loop_signal, if the byte at idle_loop_armed_offset is set and the
+  // target is not in its slot (target % idle_loop_rejected_slots) of the u32
+  // array at idle_loop_rejected_offset
+  size_t idle_loop_armed_offset;
+  size_t idle_loop_rejected_offset;
+  size_t idle_loop_rejected_slots;
+  u16 idle_loop_max_bytes;
+  u8 idle_loop_signal;
+};
+
+// Page tables of a memory type that exposes them (see Bus::get_page_tables()),
+// so LOAD and STORE can access plain memory pages inline. A null read table
+// leaves every access to the handlers; a null entry sends that page to them.
+struct JitMemory {
+  const u8 *const *read_pages = nullptr;
+  u8 *const *write_pages = nullptr;
+  const bool *code_pages = nullptr;  // Stores to code pages go through the handler so cached code hears about them
+  bool *dirty_pages = nullptr;       // Marked by every inline store, if not null
+  u8 *open_bus = nullptr;            // Data bus latch, set for every fetch and inline access if not null
+};
+
+// x86-64 translator: loads, stores, transfers, register increments, flag
+// operations, branches and jumps become native code working on the CPU object
+// directly; every other instruction advances the PC, sets the base cycles and
+// calls its handler, with no dispatch in between. Code is written into an
+// mmap'd arena that is only writable while a block is being emitted.
+class JitCompiler {
+ public:
+#if defined(__x86_64__) && defined(__linux__)
+  static constexpr bool SUPPORTED = true;
+#else
+  static constexpr bool SUPPORTED = false;
+#endif
+
+  JitCompiler();
+  ~JitCompiler();
+  JitCompiler(const JitCompiler &) = delete;
+  JitCompiler &operator=(const JitCompiler &) = delete;
+
+  // Returns nullptr when the arena is full or the platform is unsupported
+  JitBlockFunction compile(const JitLayout &layout, const JitMemory &memory, const JitInstruction *instructions, size_t count);
+  bool is_available() const { return _arena != nullptr; }
+  bool is_empty() const { return _used == 0; }
+
+  // Forget all compiled code, every JitBlockFunction handed out becomes invalid
+  void clear() { _used = 0; }
+
+ private:
+  static constexpr size_t ARENA_SIZE = 1024 * 1024;  // 1MB
+
+  u8 *_arena = nullptr;
+  size_t _used = 0;
+};
+
+}  // namespace nes
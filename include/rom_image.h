@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "types.h"
+
+namespace nes {
+
+// Bytes of a ROM file. Files are mapped read-only and MAP_PRIVATE where the
+// platform has mmap, so nothing is copied at startup and every process
+// running the same ROM shares its pages through the OS page cache. Elsewhere,
+// or when mapping fails, the file is read into memory instead.
+class RomImage {
+ public:
+#if defined(__unix__) || defined(__APPLE__)
+  static constexpr bool CAN_MAP_FILES = true;
+#else
+  static constexpr bool CAN_MAP_FILES = false;
+#endif
+
+  RomImage() = default;
+  explicit RomImage(std::vector<u8> bytes);
+  ~RomImage();
+  RomImage(RomImage &&other) noexcept;
+  RomImage &operator=(RomImage &&other) noexcept;
+  RomImage(const RomImage &) = delete;
+  RomImage &operator=(const RomImage &) = delete;
+
+  // Empty if the file cannot be opened or is empty
+  static RomImage open(const std::string &path);
+
+  const u8 *data() const { return _data; }
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+  bool is_mapped() const { return _mapped; }
+
+ private:
+  std::vector<u8> _bytes;  // Only used when the file is not mapped
+  const u8 *_data = nullptr;
+  size_t _size = 0;
+  bool _mapped = false;
+
+  void release();
+};
+
+}  // namespace nes
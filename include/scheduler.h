@@ -0,0 +1,55 @@
+#pragma once
+#include <functional>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+#include "types.h"
+
+namespace nes {
+
+// Events keyed by absolute CPU cycle. The CPU runs whole instructions in
+// batches up to the next event (see BasicCPU::run_until), so an event fires
+// on the first instruction boundary at or after its cycle.
+class Scheduler {
+ public:
+  using EventId = u64;
+  using Callback = std::function<void()>;
+
+  static constexpr u64 NO_EVENT = std::numeric_limits<u64>::max();
+
+  Scheduler() = default;
+  ~Scheduler() = default;
+
+  // Callbacks may schedule or cancel events, including rescheduling themselves
+  EventId schedule(const u64 cycle, Callback callback);
+  EventId schedule_in(const u64 delay, Callback callback) { return schedule(_cycle + delay, std::move(callback)); }
+  void cancel(const EventId id);
+
+  // Cycles elapsed since the scheduler was created
+  u64 get_cycle() const { return _cycle; }
+  void advance(const u64 cycles) { _cycle += cycles; }
+
+  // Cycle of the earliest pending event, NO_EVENT if there is none
+  u64 get_next_event_cycle();
+  bool has_pending_events() const { return !_callbacks.empty(); }
+
+  // Fires every event due at or before the current cycle, in cycle order and
+  // in scheduling order for events on the same cycle
+  void dispatch_due_events();
+
+ private:
+  struct Event {
+    u64 cycle;
+    EventId id;  // Ids increase, so they also break ties in scheduling order
+
+    bool operator>(const Event &other) const { return cycle != other.cycle ? cycle > other.cycle : id > other.id; }
+  };
+
+  u64 _cycle = 0;
+  EventId _next_id = 0;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> _queue;
+  std::unordered_map<EventId, Callback> _callbacks;  // Cancelled events are simply missing here
+};
+
+}  // namespace nes
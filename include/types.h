@@ -9,7 +9,6 @@ using u64 = std::uint64_t;
 using i8 = std::int8_t;
 
 class Addressable;
-class CPU;
 
 // Interface for memory-mapped components
 class Addressable {
@@ -20,24 +19,93 @@ class Addressable {
   virtual bool handles_address(u16 address) const = 0;
 };
 
-// Forward declarations for better type clarity
-using AddressedOperation = void (CPU::*)(u16 addr);
-using ImpliedOperation = void (CPU::*)();
-using ModeHandler = u16 (CPU::*)();
-
-// Instruction structure with support for both addressed and implied operations
-struct Instruction {
-  union {
-    AddressedOperation addressed_op;
-    ImpliedOperation implied_op;
-  };
-  ModeHandler mode;
-  u8 cycles;
-  const char *name;
-  bool is_extra_cycle = false;
-  bool is_implied = false;  // Flag to indicate if this is an implied operation
+// Told when memory inside a page marked as code is written, so anything
+// decoded from that page can be thrown away
+class CodeWriteListener {
+ public:
+  virtual ~CodeWriteListener() = default;
+  virtual void code_written(u16 address) = 0;
+  // The page now shows different memory, everything decoded from it is stale
+  virtual void code_page_remapped(u8 page) = 0;
+};
+
+// Told about every access to a watched page (see Bus::watch_page). old_value
+// is what the address held before a write; device pages are not read back
+// and report the written value instead.
+class MemoryWatcher {
+ public:
+  virtual ~MemoryWatcher() = default;
+  virtual void memory_read(u16 address, u8 value) = 0;
+  virtual void memory_written(u16 address, u8 old_value, u8 value) = 0;
+};
+
+// Cold per-opcode metadata, only needed for disassembly
+struct InstructionInfo {
+  const char *mnemonic;
+  const char *mode;
+};
+
+enum class AddressingMode : u8 {
+  IMP,  // Implied
+  ACC,  // Accumulator
+  IMM,  // Immediate
+  ZPG,  // Zero Page
+  ZPX,  // Zero Page X-Indexed
+  ZPY,  // Zero Page Y-Indexed
+  ABS,  // Absolute
+  ABX,  // Absolute X-Indexed
+  ABY,  // Absolute Y-Indexed
+  IND,  // Absolute Indirect
+  IZX,  // Indirect X (Zero Page Pre-Indexed)
+  IZY,  // Indirect Y (Zero Page Post-Indexed)
+  REL,  // Relative
+  ZPI,  // Zero Page Indirect (65C02)
+  AIX,  // Absolute X-Indexed Indirect (65C02)
+};
+
+// Chip the core emulates, fixed at compile time by BasicCPU's template argument
+enum class Variant : u8 {
+  RICOH_2A03,  // NES CPU, decimal mode is wired off
+  NMOS_6502,   // Original 6502 with BCD arithmetic
+  CMOS_65C02,  // 65C02, BCD with valid N/Z flags and one extra cycle
+};
+
+// What the CPU does when it fetches an opcode with no table entry
+enum class FaultPolicy : u8 {
+  HALT,   // Stop on the opcode until reset() or clear_fault()
+  NOP,    // Skip the opcode byte as a 2-cycle NOP
+  HOOK,   // Let the fault hook decide, halting if it declines
+  THROW,  // Throw std::runtime_error
+};
+
+// How often the branch at one address went each way
+struct BranchStats {
+  u64 taken = 0;
+  u64 not_taken = 0;
 };
 
+enum class Fault : u8 {
+  NONE,
+  UNKNOWN_OPCODE,
+};
+
+// Number of operand bytes that follow the opcode
+constexpr u8 operand_bytes(const AddressingMode mode) {
+  switch (mode) {
+    case AddressingMode::IMP:
+    case AddressingMode::ACC:
+      return 0;
+    case AddressingMode::ABS:
+    case AddressingMode::ABX:
+    case AddressingMode::ABY:
+    case AddressingMode::IND:
+    case AddressingMode::AIX:
+      return 2;
+    default:
+      return 1;
+  }
+}
+
 enum class Opcode : u8 {
   // Load operations
   LDA_IMM = 0xA9,  // LDA Immediate
@@ -238,6 +306,214 @@ enum class Opcode : u8 {
 
   // NOP
   NOP_IMP = 0xEA,  // No operation
+
+  // Undocumented operations
+  // LAX - Load A and X
+  LAX_ZPG = 0xA7,  // LAX Zero Page
+  LAX_ZPY = 0xB7,  // LAX Zero Page Y-Indexed
+  LAX_ABS = 0xAF,  // LAX Absolute
+  LAX_ABY = 0xBF,  // LAX Absolute Y-Indexed
+  LAX_IZX = 0xA3,  // LAX Indirect X (Zero Page Pre-Indexed)
+  LAX_IZY = 0xB3,  // LAX Indirect Y (Zero Page Post-Indexed)
+
+  // SAX - Store A AND X
+  SAX_ZPG = 0x87,  // SAX Zero Page
+  SAX_ZPY = 0x97,  // SAX Zero Page Y-Indexed
+  SAX_ABS = 0x8F,  // SAX Absolute
+  SAX_IZX = 0x83,  // SAX Indirect X (Zero Page Pre-Indexed)
+
+  // SLO - ASL then ORA
+  SLO_ZPG = 0x07,  // SLO Zero Page
+  SLO_ZPX = 0x17,  // SLO Zero Page X-Indexed
+  SLO_ABS = 0x0F,  // SLO Absolute
+  SLO_ABX = 0x1F,  // SLO Absolute X-Indexed
+  SLO_ABY = 0x1B,  // SLO Absolute Y-Indexed
+  SLO_IZX = 0x03,  // SLO Indirect X (Zero Page Pre-Indexed)
+  SLO_IZY = 0x13,  // SLO Indirect Y (Zero Page Post-Indexed)
+
+  // RLA - ROL then AND
+  RLA_ZPG = 0x27,  // RLA Zero Page
+  RLA_ZPX = 0x37,  // RLA Zero Page X-Indexed
+  RLA_ABS = 0x2F,  // RLA Absolute
+  RLA_ABX = 0x3F,  // RLA Absolute X-Indexed
+  RLA_ABY = 0x3B,  // RLA Absolute Y-Indexed
+  RLA_IZX = 0x23,  // RLA Indirect X (Zero Page Pre-Indexed)
+  RLA_IZY = 0x33,  // RLA Indirect Y (Zero Page Post-Indexed)
+
+  // SRE - LSR then EOR
+  SRE_ZPG = 0x47,  // SRE Zero Page
+  SRE_ZPX = 0x57,  // SRE Zero Page X-Indexed
+  SRE_ABS = 0x4F,  // SRE Absolute
+  SRE_ABX = 0x5F,  // SRE Absolute X-Indexed
+  SRE_ABY = 0x5B,  // SRE Absolute Y-Indexed
+  SRE_IZX = 0x43,  // SRE Indirect X (Zero Page Pre-Indexed)
+  SRE_IZY = 0x53,  // SRE Indirect Y (Zero Page Post-Indexed)
+
+  // RRA - ROR then ADC
+  RRA_ZPG = 0x67,  // RRA Zero Page
+  RRA_ZPX = 0x77,  // RRA Zero Page X-Indexed
+  RRA_ABS = 0x6F,  // RRA Absolute
+  RRA_ABX = 0x7F,  // RRA Absolute X-Indexed
+  RRA_ABY = 0x7B,  // RRA Absolute Y-Indexed
+  RRA_IZX = 0x63,  // RRA Indirect X (Zero Page Pre-Indexed)
+  RRA_IZY = 0x73,  // RRA Indirect Y (Zero Page Post-Indexed)
+
+  // DCP - DEC then CMP
+  DCP_ZPG = 0xC7,  // DCP Zero Page
+  DCP_ZPX = 0xD7,  // DCP Zero Page X-Indexed
+  DCP_ABS = 0xCF,  // DCP Absolute
+  DCP_ABX = 0xDF,  // DCP Absolute X-Indexed
+  DCP_ABY = 0xDB,  // DCP Absolute Y-Indexed
+  DCP_IZX = 0xC3,  // DCP Indirect X (Zero Page Pre-Indexed)
+  DCP_IZY = 0xD3,  // DCP Indirect Y (Zero Page Post-Indexed)
+
+  // ISC - INC then SBC
+  ISC_ZPG = 0xE7,  // ISC Zero Page
+  ISC_ZPX = 0xF7,  // ISC Zero Page X-Indexed
+  ISC_ABS = 0xEF,  // ISC Absolute
+  ISC_ABX = 0xFF,  // ISC Absolute X-Indexed
+  ISC_ABY = 0xFB,  // ISC Absolute Y-Indexed
+  ISC_IZX = 0xE3,  // ISC Indirect X (Zero Page Pre-Indexed)
+  ISC_IZY = 0xF3,  // ISC Indirect Y (Zero Page Post-Indexed)
+
+  // Immediate-only combined operations
+  ANC_IMM = 0x0B,  // ANC Immediate
+  ANC_IMM_2B = 0x2B,  // ANC Immediate
+  ALR_IMM = 0x4B,  // ALR Immediate
+  ARR_IMM = 0x6B,  // ARR Immediate
+  AXS_IMM = 0xCB,  // AXS Immediate
+  SBC_IMM_EB = 0xEB,  // SBC Immediate
+
+  // Multi-byte NOPs read their operand like a load and discard it
+  NOP_IMP_1A = 0x1A,  // NOP Implied
+  NOP_IMP_3A = 0x3A,  // NOP Implied
+  NOP_IMP_5A = 0x5A,  // NOP Implied
+  NOP_IMP_7A = 0x7A,  // NOP Implied
+  NOP_IMP_DA = 0xDA,  // NOP Implied
+  NOP_IMP_FA = 0xFA,  // NOP Implied
+  NOP_IMM_80 = 0x80,  // NOP Immediate
+  NOP_IMM_82 = 0x82,  // NOP Immediate
+  NOP_IMM_89 = 0x89,  // NOP Immediate
+  NOP_IMM_C2 = 0xC2,  // NOP Immediate
+  NOP_IMM_E2 = 0xE2,  // NOP Immediate
+  NOP_ZPG_04 = 0x04,  // NOP Zero Page
+  NOP_ZPG_44 = 0x44,  // NOP Zero Page
+  NOP_ZPG_64 = 0x64,  // NOP Zero Page
+  NOP_ZPX_14 = 0x14,  // NOP Zero Page X-Indexed
+  NOP_ZPX_34 = 0x34,  // NOP Zero Page X-Indexed
+  NOP_ZPX_54 = 0x54,  // NOP Zero Page X-Indexed
+  NOP_ZPX_74 = 0x74,  // NOP Zero Page X-Indexed
+  NOP_ZPX_D4 = 0xD4,  // NOP Zero Page X-Indexed
+  NOP_ZPX_F4 = 0xF4,  // NOP Zero Page X-Indexed
+  NOP_ABS_0C = 0x0C,  // NOP Absolute
+  NOP_ABX_1C = 0x1C,  // NOP Absolute X-Indexed
+  NOP_ABX_3C = 0x3C,  // NOP Absolute X-Indexed
+  NOP_ABX_5C = 0x5C,  // NOP Absolute X-Indexed
+  NOP_ABX_7C = 0x7C,  // NOP Absolute X-Indexed
+  NOP_ABX_DC = 0xDC,  // NOP Absolute X-Indexed
+  NOP_ABX_FC = 0xFC,  // NOP Absolute X-Indexed
+
+  // 65C02 operations, some reuse NMOS undocumented opcode values
+  ORA_ZPI = 0x12,  // ORA Zero Page Indirect
+  AND_ZPI = 0x32,  // AND Zero Page Indirect
+  EOR_ZPI = 0x52,  // EOR Zero Page Indirect
+  ADC_ZPI = 0x72,  // ADC Zero Page Indirect
+  STA_ZPI = 0x92,  // STA Zero Page Indirect
+  LDA_ZPI = 0xB2,  // LDA Zero Page Indirect
+  CMP_ZPI = 0xD2,  // CMP Zero Page Indirect
+  SBC_ZPI = 0xF2,  // SBC Zero Page Indirect
+  BIT_IMM = 0x89,  // BIT Immediate
+  BIT_ZPX = 0x34,  // BIT Zero Page X-Indexed
+  BIT_ABX = 0x3C,  // BIT Absolute X-Indexed
+  INC_ACC = 0x1A,  // Increment Accumulator
+  DEC_ACC = 0x3A,  // Decrement Accumulator
+  STZ_ZPG = 0x64,  // Store Zero Zero Page
+  STZ_ZPX = 0x74,  // Store Zero Zero Page X-Indexed
+  STZ_ABS = 0x9C,  // Store Zero Absolute
+  STZ_ABX = 0x9E,  // Store Zero Absolute X-Indexed
+  TSB_ZPG = 0x04,  // Test and Set Bits Zero Page
+  TSB_ABS = 0x0C,  // Test and Set Bits Absolute
+  TRB_ZPG = 0x14,  // Test and Reset Bits Zero Page
+  TRB_ABS = 0x1C,  // Test and Reset Bits Absolute
+  PHX_IMP = 0xDA,  // Push X
+  PHY_IMP = 0x5A,  // Push Y
+  PLX_IMP = 0xFA,  // Pull X
+  PLY_IMP = 0x7A,  // Pull Y
+  BRA_REL = 0x80,  // Branch Always
+  JMP_AIX = 0x7C,  // Jump Absolute X-Indexed Indirect
+
+  // 65C02 undefined opcodes, all NOPs. The remaining ones reuse the NMOS NOP names above
+  NOP_IMP_03 = 0x03,  // NOP Implied
+  NOP_IMP_07 = 0x07,  // NOP Implied
+  NOP_IMP_0B = 0x0B,  // NOP Implied
+  NOP_IMP_0F = 0x0F,  // NOP Implied
+  NOP_IMP_13 = 0x13,  // NOP Implied
+  NOP_IMP_17 = 0x17,  // NOP Implied
+  NOP_IMP_1B = 0x1B,  // NOP Implied
+  NOP_IMP_1F = 0x1F,  // NOP Implied
+  NOP_IMP_23 = 0x23,  // NOP Implied
+  NOP_IMP_27 = 0x27,  // NOP Implied
+  NOP_IMP_2B = 0x2B,  // NOP Implied
+  NOP_IMP_2F = 0x2F,  // NOP Implied
+  NOP_IMP_33 = 0x33,  // NOP Implied
+  NOP_IMP_37 = 0x37,  // NOP Implied
+  NOP_IMP_3B = 0x3B,  // NOP Implied
+  NOP_IMP_3F = 0x3F,  // NOP Implied
+  NOP_IMP_43 = 0x43,  // NOP Implied
+  NOP_IMP_47 = 0x47,  // NOP Implied
+  NOP_IMP_4B = 0x4B,  // NOP Implied
+  NOP_IMP_4F = 0x4F,  // NOP Implied
+  NOP_IMP_53 = 0x53,  // NOP Implied
+  NOP_IMP_57 = 0x57,  // NOP Implied
+  NOP_IMP_5B = 0x5B,  // NOP Implied
+  NOP_IMP_5F = 0x5F,  // NOP Implied
+  NOP_IMP_63 = 0x63,  // NOP Implied
+  NOP_IMP_67 = 0x67,  // NOP Implied
+  NOP_IMP_6B = 0x6B,  // NOP Implied
+  NOP_IMP_6F = 0x6F,  // NOP Implied
+  NOP_IMP_73 = 0x73,  // NOP Implied
+  NOP_IMP_77 = 0x77,  // NOP Implied
+  NOP_IMP_7B = 0x7B,  // NOP Implied
+  NOP_IMP_7F = 0x7F,  // NOP Implied
+  NOP_IMP_83 = 0x83,  // NOP Implied
+  NOP_IMP_87 = 0x87,  // NOP Implied
+  NOP_IMP_8B = 0x8B,  // NOP Implied
+  NOP_IMP_8F = 0x8F,  // NOP Implied
+  NOP_IMP_93 = 0x93,  // NOP Implied
+  NOP_IMP_97 = 0x97,  // NOP Implied
+  NOP_IMP_9B = 0x9B,  // NOP Implied
+  NOP_IMP_9F = 0x9F,  // NOP Implied
+  NOP_IMP_A3 = 0xA3,  // NOP Implied
+  NOP_IMP_A7 = 0xA7,  // NOP Implied
+  NOP_IMP_AB = 0xAB,  // NOP Implied
+  NOP_IMP_AF = 0xAF,  // NOP Implied
+  NOP_IMP_B3 = 0xB3,  // NOP Implied
+  NOP_IMP_B7 = 0xB7,  // NOP Implied
+  NOP_IMP_BB = 0xBB,  // NOP Implied
+  NOP_IMP_BF = 0xBF,  // NOP Implied
+  NOP_IMP_C3 = 0xC3,  // NOP Implied
+  NOP_IMP_C7 = 0xC7,  // NOP Implied
+  NOP_IMP_CB = 0xCB,  // NOP Implied
+  NOP_IMP_CF = 0xCF,  // NOP Implied
+  NOP_IMP_D3 = 0xD3,  // NOP Implied
+  NOP_IMP_D7 = 0xD7,  // NOP Implied
+  NOP_IMP_DB = 0xDB,  // NOP Implied
+  NOP_IMP_DF = 0xDF,  // NOP Implied
+  NOP_IMP_E3 = 0xE3,  // NOP Implied
+  NOP_IMP_E7 = 0xE7,  // NOP Implied
+  NOP_IMP_EB = 0xEB,  // NOP Implied
+  NOP_IMP_EF = 0xEF,  // NOP Implied
+  NOP_IMP_F3 = 0xF3,  // NOP Implied
+  NOP_IMP_F7 = 0xF7,  // NOP Implied
+  NOP_IMP_FB = 0xFB,  // NOP Implied
+  NOP_IMP_FF = 0xFF,  // NOP Implied
+  NOP_IMM_02 = 0x02,  // NOP Immediate
+  NOP_IMM_22 = 0x22,  // NOP Immediate
+  NOP_IMM_42 = 0x42,  // NOP Immediate
+  NOP_IMM_62 = 0x62,  // NOP Immediate
+  NOP_ABS_5C = 0x5C,  // NOP Absolute
+  NOP_ABS_DC = 0xDC,  // NOP Absolute
+  NOP_ABS_FC = 0xFC,  // NOP Absolute
 };
 
 enum class Flag : u8 {
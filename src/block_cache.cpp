@@ -0,0 +1,74 @@
+#include "../include/block_cache.h"
+#include <algorithm>
+
+namespace nes {
+
+namespace {
+
+// Calls visit for every page a block was decoded from. A block may run past
+// $FFFF and wrap to page $00.
+template <typename Visitor>
+void for_each_page(const DecodedBlock &block, Visitor visit) {
+  const u8 first_page = block.start >> 8;
+  const u8 last_page = (u16)(block.end - 1) >> 8;
+  for (u8 page = first_page;; page++) {
+    visit(page);
+    if (page == last_page) break;
+  }
+}
+
+}  // namespace
+
+BlockCache::BlockCache()
+  : _blocks(ADDRESS_SPACE_SIZE) {}
+
+DecodedBlock *BlockCache::insert(std::unique_ptr<DecodedBlock> block) {
+  const u16 start = block->start;
+  if (_blocks[start] != nullptr) remove(start);
+
+  for_each_page(*block, [&](u8 page) { _page_blocks[page].push_back(start); });
+  _blocks[start] = std::move(block);
+  return _blocks[start].get();
+}
+
+void BlockCache::clear() {
+  for (auto &starts : _page_blocks) {
+    for (u16 start : starts) {
+      _blocks[start].reset();
+    }
+    starts.clear();
+  }
+  _generation++;
+}
+
+void BlockCache::code_written(u16 address) {
+  const auto &starts = _page_blocks[address >> 8];
+
+  // Only blocks covering the written byte are dropped, data sharing the page is fine
+  for (size_t i = 0; i < starts.size();) {
+    const DecodedBlock &block = *_blocks[starts[i]];
+    if ((u16)(address - block.start) < (u16)(block.end - block.start)) {
+      remove(block.start);  // Also takes it out of starts
+    } else {
+      i++;
+    }
+  }
+}
+
+void BlockCache::code_page_remapped(u8 page) {
+  auto &starts = _page_blocks[page];
+  while (!starts.empty()) {
+    remove(starts.back());
+  }
+}
+
+void BlockCache::remove(u16 start) {
+  for_each_page(*_blocks[start], [&](u8 page) {
+    auto &starts = _page_blocks[page];
+    starts.erase(std::find(starts.begin(), starts.end(), start));
+  });
+  _blocks[start].reset();
+  _generation++;
+}
+
+}  // namespace nes
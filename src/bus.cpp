@@ -1,29 +1,21 @@
 #include "../include/bus.h"
+#include <algorithm>
+#include <cstring>
 
 namespace nes {
-Bus::Bus() {}
-
-bool Bus::handles_address(u16 address) const { return true; }
-
-void Bus::write(u16 address, u8 value) {
-  if (address >= 0x0000 && address <= 0x1FFF) {
-    _ram[address & 0x07FF] = value;
-  } else if (address >= 0xFFFC && address <= 0xFFFF) {
-    _reset_vector[address - 0xFFFC] = value;
+Bus::Bus() {
+  for (size_t page = 0; page < PAGE_COUNT; page++) {
+    unmap(page);
   }
-}
-
-u8 Bus::read(u16 address) const {
-  u8 addr = 0x00;
-  if (address >= 0x0000 && address <= 0x1FFF) {
-    addr = _ram[address & 0x07FF];
-  } else if (address >= 0xFFFC && address <= 0xFFFF) {
-    addr = _reset_vector[address - 0xFFFC];
+  for (u8 page = 0x00; page <= 0x1F; page++) {
+    u8 *memory = _ram.data() + (page & 0x07) * PAGE_SIZE;
+    map_memory(page, memory, memory);
   }
-
-  return addr;
+  map_device(0xFF, &_vectors);
 }
 
+bool Bus::handles_address(u16 address) const { return true; }
+
 u16 Bus::read_word(u16 address) const {
   u8 low = read(address);
   u8 high = read(address + 1);
@@ -34,4 +26,239 @@ void Bus::write_word(u16 address, u16 value) {
   write(address, value & 0xFF);
   write(address + 1, (value >> 8) & 0xFF);
 }
+
+void Bus::read_block(u16 address, u8 *data, size_t length) const {
+  while (length > 0) {
+    const size_t chunk = std::min(length, PAGE_SIZE - (address & 0xFF));
+    if (const u8 *memory = _read_pages[address >> 8]) {
+      std::memcpy(data, memory + (address & 0xFF), chunk);
+    } else {
+      for (size_t i = 0; i < chunk; i++) {
+        data[i] = _devices[address >> 8]->read(address + i);  // Not through read_device, the latch stays
+      }
+    }
+    address += chunk;
+    data += chunk;
+    length -= chunk;
+  }
+}
+
+void Bus::write_block(u16 address, const u8 *data, size_t length) {
+  while (length > 0) {
+    const u8 page = address >> 8;
+    const size_t chunk = std::min(length, PAGE_SIZE - (address & 0xFF));
+    if (u8 *memory = _write_pages[page]) {
+      std::memcpy(memory + (address & 0xFF), data, chunk);
+      mark_dirty(page);
+    } else {
+      for (size_t i = 0; i < chunk; i++) {
+        write_device(address + i, data[i]);
+      }
+    }
+    if (_code_pages[page]) {
+      for (size_t i = 0; i < chunk; i++) {
+        notify_code_write(address + i);
+      }
+    }
+    address += chunk;
+    data += chunk;
+    length -= chunk;
+  }
+}
+
+void Bus::fill(u16 address, u8 value, size_t length) {
+  while (length > 0) {
+    const u8 page = address >> 8;
+    const size_t chunk = std::min(length, PAGE_SIZE - (address & 0xFF));
+    if (u8 *memory = _write_pages[page]) {
+      std::memset(memory + (address & 0xFF), value, chunk);
+      mark_dirty(page);
+    } else {
+      for (size_t i = 0; i < chunk; i++) {
+        write_device(address + i, value);
+      }
+    }
+    if (_code_pages[page]) {
+      for (size_t i = 0; i < chunk; i++) {
+        notify_code_write(address + i);
+      }
+    }
+    address += chunk;
+    length -= chunk;
+  }
+}
+
+void Bus::map_memory(u8 page, const u8 *read_memory, u8 *write_memory, Addressable *write_device) {
+  set_page(page, read_memory, write_memory, write_device);
+}
+
+void Bus::map_device(u8 page, Addressable *device) { set_page(page, nullptr, nullptr, device); }
+
+void Bus::unmap(u8 page) { map_device(page, &_unmapped); }
+
+void Bus::map(AddressRange range, Addressable &device) {
+  for (u32 page = range.first >> 8; page <= (u32)(range.last >> 8); page++) {
+    const u32 first = std::max<u32>(range.first, page << 8);
+    const u32 last = std::min<u32>(range.last, (page << 8) | 0xFF);
+
+    u32 handled = 0;
+    for (u32 address = first; address <= last; address++) {
+      handled += device.handles_address(address);
+    }
+    if (handled == 0) continue;
+    if (handled == PAGE_SIZE) {
+      map_device(page, &device);
+      continue;
+    }
+
+    SplitPage *split = _split_pages[page].get();
+    if (split == nullptr) {
+      _split_pages[page] = std::make_unique<SplitPage>(_mappings[page]);
+      split = _split_pages[page].get();
+      map_device(page, split);
+    }
+    for (u32 address = first; address <= last; address++) {
+      if (device.handles_address(address)) split->attach(address & 0xFF, &device);
+    }
+  }
+}
+
+// A split page is dropped once the page is mapped as a whole again
+void Bus::set_page(u8 page, const u8 *read_memory, u8 *write_memory, Addressable *device) {
+  _mappings[page] = {read_memory, write_memory, device};
+  mark_dirty(page);
+  apply_mapping(page);
+  if (_split_pages[page] != nullptr && device != _split_pages[page].get()) _split_pages[page].reset();
+
+  if (_code_pages[page]) {
+    for (CodeWriteListener *listener : _code_write_listeners) {
+      listener->code_page_remapped(page);
+    }
+  }
+}
+
+void Bus::apply_mapping(u8 page) {
+  if (_watched_pages[page]) {
+    _read_pages[page] = nullptr;
+    _write_pages[page] = nullptr;
+    _devices[page] = &_watched_page;
+  } else {
+    _read_pages[page] = _mappings[page].read_memory;
+    _write_pages[page] = _mappings[page].write_memory;
+    _devices[page] = _mappings[page].device;
+  }
+}
+
+void Bus::watch_page(u8 page, bool watched) {
+  _watched_pages[page] = watched;
+  apply_mapping(page);
+}
+
+u8 Bus::WatchedPage::read(u16 address) const {
+  const PageMapping &mapping = _bus._mappings[address >> 8];
+  const u8 value = mapping.read_memory ? mapping.read_memory[address & 0xFF] : mapping.device->read(address);
+  if (_bus._watcher != nullptr) _bus._watcher->memory_read(address, value);
+  return value;
+}
+
+void Bus::WatchedPage::write(u16 address, u8 value) {
+  const PageMapping &mapping = _bus._mappings[address >> 8];
+  const u8 old_value = mapping.read_memory ? mapping.read_memory[address & 0xFF] : value;
+  if (mapping.write_memory != nullptr) {
+    mapping.write_memory[address & 0xFF] = value;
+  } else if (mapping.device != nullptr) {
+    mapping.device->write(address, value);
+  }
+  if (_bus._watcher != nullptr) _bus._watcher->memory_written(address, old_value, value);
+}
+
+u8 Bus::SplitPage::read(u16 address) const {
+  if (Addressable *device = _devices[address & 0xFF]) return device->read(address);
+  if (_fallback.read_memory != nullptr) return _fallback.read_memory[address & 0xFF];
+  return _fallback.device->read(address);
+}
+
+void Bus::SplitPage::write(u16 address, u8 value) {
+  if (Addressable *device = _devices[address & 0xFF]) {
+    device->write(address, value);
+  } else if (_fallback.write_memory != nullptr) {
+    _fallback.write_memory[address & 0xFF] = value;
+  } else if (_fallback.device != nullptr) {
+    _fallback.device->write(address, value);
+  }
+}
+
+u8 Bus::read_device(u16 address) const { return _open_bus = _devices[address >> 8]->read(address); }
+
+// Read-only memory pages have no device either, the write is dropped
+void Bus::write_device(u16 address, u8 value) {
+  if (Addressable *device = _devices[address >> 8]) device->write(address, value);
+  if constexpr (TRACKS_DIRTY_PAGES) {
+    if (write_lands(_mappings[address >> 8], address)) mark_dirty(address >> 8);
+  }
+}
+
+// Writes to ROM reach at most the mapper registers, whose bank switches remap
+// (and so dirty) the page themselves. Open bus takes nothing.
+bool Bus::write_lands(const PageMapping &mapping, u16 address) const {
+  if (mapping.write_memory != nullptr) return true;
+  if (mapping.read_memory != nullptr || mapping.device == nullptr || mapping.device == &_unmapped) return false;
+
+  const SplitPage *split = _split_pages[address >> 8].get();
+  if (mapping.device != split) return true;
+  return split->device_at(address) != nullptr || write_lands(split->get_fallback(), address);
+}
+
+void Bus::add_code_write_listener(CodeWriteListener *listener) { _code_write_listeners.push_back(listener); }
+
+void Bus::remove_code_write_listener(CodeWriteListener *listener) {
+  _code_write_listeners.erase(std::remove(_code_write_listeners.begin(), _code_write_listeners.end(), listener),
+                              _code_write_listeners.end());
+
+  // Nobody is caching code any more, writes can skip the check
+  if (_code_write_listeners.empty()) _code_pages.fill(false);
+}
+
+// RAM pages are marked together with their mirrors so a write through any
+// alias is seen
+void Bus::mark_code_page(u8 page) {
+  if (page <= 0x1F) {
+    for (u8 mirror = 0; mirror < 4; mirror++) {
+      _code_pages[(page & 0x07) | (mirror << 3)] = true;
+    }
+  } else {
+    _code_pages[page] = true;
+  }
+}
+
+std::bitset<Bus::PAGE_COUNT> Bus::fetch_dirty_pages() {
+  std::bitset<PAGE_COUNT> dirty;
+  if constexpr (!TRACKS_DIRTY_PAGES) return dirty.set();
+
+  for (size_t page = 0; page < PAGE_COUNT; page++) {
+    if (!_dirty_pages[page]) continue;
+    if (page <= 0x1F) {
+      for (size_t mirror = 0; mirror < 4; mirror++) {
+        dirty[(page & 0x07) | (mirror << 3)] = true;
+      }
+    } else {
+      dirty[page] = true;
+    }
+  }
+  _dirty_pages.fill(false);
+  return dirty;
+}
+
+void Bus::notify_code_write(u16 address) {
+  for (CodeWriteListener *listener : _code_write_listeners) {
+    // Code may have been decoded through any mirror of the written RAM byte
+    if (address <= 0x1FFF) {
+      for (u16 mirror = 0; mirror < 4; mirror++) {
+        listener->code_written((address & 0x07FF) | (mirror << 11));
+      }
+    } else {
+      listener->code_written(address);
+    }
+  }
+}
 }  // namespace nes
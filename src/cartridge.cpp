@@ -0,0 +1,382 @@
+#include "../include/cartridge.h"
+#include <algorithm>
+
+namespace nes {
+
+namespace {
+
+// NES 2.0 ROM sizes are a 12-bit count of units, or a power of two times a
+// small odd multiplier when the high nibble is $F
+u64 nes2_rom_size(const u8 lsb, const u8 msb, const u64 unit) {
+  if (msb != 0x0F) return (((u64)msb << 8) | lsb) * unit;
+  const u8 exponent = lsb >> 2;
+  if (exponent > 40) return (u64)1 << 40;  // Far bigger than any file, so it fails the size check
+  return ((u64)1 << exponent) * ((lsb & 0x03) * 2 + 1);
+}
+
+// NES 2.0 RAM sizes are 64 << shift bytes, 0 meaning none
+size_t nes2_ram_size(const u8 shift) { return (shift == 0) ? 0 : (size_t)64 << shift; }
+
+// Mapper 0: 16KB or 32KB of PRG ROM, 8KB of CHR, no registers. A 16KB image
+// shows up at both $8000 and $C000.
+class Nrom final : public Cartridge {
+ public:
+  Nrom(RomImage image, const CartridgeHeader &header)
+    : Cartridge(std::move(image), header) {}
+
+ protected:
+  void write_register(u16 /*address*/, u8 /*value*/) override {}
+};
+
+// Mapper 1: five serial writes fill a shift register, the fifth picks the
+// register from address bits 13-14. Writing a value with bit 7 set resets it.
+class Mmc1 final : public Cartridge {
+ public:
+  Mmc1(RomImage image, const CartridgeHeader &header)
+    : Cartridge(std::move(image), header) {
+    update_banks();
+  }
+
+ protected:
+  void write_register(u16 address, u8 value) override {
+    if (value & 0x80) {
+      _shift = SHIFT_EMPTY;
+      _control |= 0x0C;
+      update_banks();
+      return;
+    }
+
+    const bool complete = _shift & 0x01;  // The marker bit reached the bottom
+    _shift = (_shift >> 1) | ((value & 0x01) << 4);
+    if (!complete) return;
+
+    switch ((address >> 13) & 0x03) {
+      case 0: _control = _shift; break;
+      case 1: _chr_bank_0 = _shift; break;
+      case 2: _chr_bank_1 = _shift; break;
+      case 3: _prg_bank = _shift; break;
+    }
+    _shift = SHIFT_EMPTY;
+    update_banks();
+  }
+
+ private:
+  static constexpr u8 SHIFT_EMPTY = 0x10;
+
+  u8 _shift = SHIFT_EMPTY;
+  u8 _control = 0x0C;  // Powers up with the last bank fixed at $C000
+  u8 _chr_bank_0 = 0;
+  u8 _chr_bank_1 = 0;
+  u8 _prg_bank = 0;
+
+  void update_banks() {
+    static constexpr Mirroring MIRRORING[] = {Mirroring::SINGLE_SCREEN_LOWER, Mirroring::SINGLE_SCREEN_UPPER,
+                                              Mirroring::VERTICAL, Mirroring::HORIZONTAL};
+    _mirroring = MIRRORING[_control & 0x03];
+
+    const size_t bank = _prg_bank & 0x0F;
+    switch ((_control >> 2) & 0x03) {
+      case 0:
+      case 1:  // 32KB at $8000, the low bit is ignored
+        set_prg_bank_16k(0, bank & ~1);
+        set_prg_bank_16k(1, bank | 1);
+        break;
+      case 2:  // First bank fixed at $8000, 16KB switched at $C000
+        set_prg_bank_16k(0, 0);
+        set_prg_bank_16k(1, bank);
+        break;
+      case 3:  // 16KB switched at $8000, last bank fixed at $C000
+        set_prg_bank_16k(0, bank);
+        set_prg_bank_16k(1, prg_bank_count() / 2 - 1);
+        break;
+    }
+
+    if (_control & 0x10) {
+      set_chr_bank_4k(0, _chr_bank_0);
+      set_chr_bank_4k(1, _chr_bank_1);
+    } else {
+      set_chr_bank_4k(0, _chr_bank_0 & ~1);
+      set_chr_bank_4k(1, _chr_bank_0 | 1);
+    }
+
+    // Bit 4 disables PRG RAM on MMC1B and later
+    const bool ram_enabled = !(_prg_bank & 0x10);
+    set_prg_ram_access(ram_enabled, ram_enabled);
+  }
+};
+
+// Mapper 2: any write to ROM picks the 16KB bank at $8000, $C000 stays on the last one
+class Uxrom final : public Cartridge {
+ public:
+  Uxrom(RomImage image, const CartridgeHeader &header)
+    : Cartridge(std::move(image), header) {
+    set_prg_bank_16k(0, 0);
+    set_prg_bank_16k(1, prg_bank_count() / 2 - 1);
+  }
+
+ protected:
+  void write_register(u16 /*address*/, u8 value) override { set_prg_bank_16k(0, value); }
+};
+
+// Mapper 3: fixed PRG like NROM, any write to ROM picks the 8KB CHR bank
+class Cnrom final : public Cartridge {
+ public:
+  Cnrom(RomImage image, const CartridgeHeader &header)
+    : Cartridge(std::move(image), header) {}
+
+ protected:
+  void write_register(u16 /*address*/, u8 value) override { set_chr_bank_8k(value); }
+};
+
+// Mapper 4: eight bank registers written through a select/data pair, 8KB
+// PRG and 1KB/2KB CHR banks, and a scanline counter that raises IRQs
+class Mmc3 final : public Cartridge {
+ public:
+  Mmc3(RomImage image, const CartridgeHeader &header)
+    : Cartridge(std::move(image), header) {
+    update_banks();
+  }
+
+  void clock_scanline() override {
+    if (_irq_counter == 0 || _irq_reload) {
+      _irq_counter = _irq_latch;
+      _irq_reload = false;
+    } else {
+      _irq_counter--;
+    }
+    if (_irq_counter == 0 && _irq_enabled) _irq_pending = true;
+  }
+
+ protected:
+  // Even addresses write the first register of each pair, odd ones the second
+  void write_register(u16 address, u8 value) override {
+    const bool odd = address & 0x01;
+    switch (address & 0xE000) {
+      case 0x8000:
+        if (odd) {
+          _registers[_bank_select & 0x07] = value;
+        } else {
+          _bank_select = value;
+        }
+        update_banks();
+        break;
+      case 0xA000:
+        if (odd) {
+          const bool enabled = value & 0x80;
+          set_prg_ram_access(enabled, enabled && !(value & 0x40));
+        } else if (get_header().mirroring != Mirroring::FOUR_SCREEN) {
+          _mirroring = (value & 0x01) ? Mirroring::HORIZONTAL : Mirroring::VERTICAL;
+        }
+        break;
+      case 0xC000:
+        if (odd) {
+          _irq_counter = 0;
+          _irq_reload = true;
+        } else {
+          _irq_latch = value;
+        }
+        break;
+      case 0xE000:
+        _irq_enabled = odd;
+        if (!odd) _irq_pending = false;
+        break;
+    }
+  }
+
+ private:
+  u8 _bank_select = 0;
+  std::array<u8, 8> _registers = {0, 2, 4, 5, 6, 7, 0, 1};
+  u8 _irq_latch = 0;
+  u8 _irq_counter = 0;
+  bool _irq_reload = false;
+  bool _irq_enabled = false;
+
+  void update_banks() {
+    // Bit 6 swaps $8000 and $C000, bit 7 swaps the CHR halves
+    const size_t second_last = prg_bank_count() - 2;
+    const bool prg_swapped = _bank_select & 0x40;
+    set_prg_bank(0, prg_swapped ? second_last : _registers[6]);
+    set_prg_bank(1, _registers[7]);
+    set_prg_bank(2, prg_swapped ? _registers[6] : second_last);
+    set_prg_bank(3, prg_bank_count() - 1);
+
+    const u8 invert = (_bank_select & 0x80) ? 4 : 0;
+    set_chr_bank(0 ^ invert, _registers[0] & 0xFE);
+    set_chr_bank(1 ^ invert, _registers[0] | 0x01);
+    set_chr_bank(2 ^ invert, _registers[1] & 0xFE);
+    set_chr_bank(3 ^ invert, _registers[1] | 0x01);
+    for (u8 slot = 0; slot < 4; slot++) {
+      set_chr_bank((4 + slot) ^ invert, _registers[2 + slot]);
+    }
+  }
+};
+
+}  // namespace
+
+bool Cartridge::parse_header(const u8 *data, size_t size, CartridgeHeader &header) {
+  if (size < HEADER_SIZE || data[0] != 'N' || data[1] != 'E' || data[2] != 'S' || data[3] != 0x1A) return false;
+
+  const u8 flags6 = data[6];
+  const u8 flags7 = data[7];
+  header.nes2 = (flags7 & 0x0C) == 0x08;
+  header.trainer = flags6 & 0x04;
+  header.battery = flags6 & 0x02;
+  if (flags6 & 0x08) {
+    header.mirroring = Mirroring::FOUR_SCREEN;
+  } else {
+    header.mirroring = (flags6 & 0x01) ? Mirroring::VERTICAL : Mirroring::HORIZONTAL;
+  }
+
+  u64 prg_rom_size;
+  u64 chr_rom_size;
+  if (header.nes2) {
+    header.mapper = (flags6 >> 4) | (flags7 & 0xF0) | ((data[8] & 0x0F) << 8);
+    header.submapper = data[8] >> 4;
+    prg_rom_size = nes2_rom_size(data[4], data[9] & 0x0F, 16 * 1024);
+    chr_rom_size = nes2_rom_size(data[5], data[9] >> 4, 8 * 1024);
+    header.prg_ram_size = nes2_ram_size(data[10] & 0x0F) + nes2_ram_size(data[10] >> 4);
+  } else {
+    // Old dumping tools signed bytes 7-15 ("DiskDude!"), so the upper mapper
+    // nibble is only trusted when the padding at the end is clean
+    const bool clean = data[12] == 0 && data[13] == 0 && data[14] == 0 && data[15] == 0;
+    header.mapper = (flags6 >> 4) | (clean ? (flags7 & 0xF0) : 0);
+    header.submapper = 0;
+    prg_rom_size = (u64)data[4] * 16 * 1024;
+    chr_rom_size = (u64)data[5] * 8 * 1024;
+    header.prg_ram_size = (data[8] == 0 ? 1 : data[8]) * 8 * 1024;  // 0 still means 8KB
+  }
+
+  // Banks are switched in whole PRG and CHR slots
+  if (prg_rom_size == 0 || prg_rom_size % PRG_SLOT_SIZE != 0 || chr_rom_size % CHR_SLOT_SIZE != 0) return false;
+  if (HEADER_SIZE + (header.trainer ? TRAINER_SIZE : 0) + prg_rom_size + chr_rom_size > size) return false;
+  header.prg_rom_size = prg_rom_size;
+  header.chr_rom_size = chr_rom_size;
+  return true;
+}
+
+std::unique_ptr<Cartridge> Cartridge::load(RomImage image) {
+  CartridgeHeader header;
+  if (!parse_header(image.data(), image.size(), header)) return nullptr;
+
+  switch (header.mapper) {
+    case 0: return std::make_unique<Nrom>(std::move(image), header);
+    case 1: return std::make_unique<Mmc1>(std::move(image), header);
+    case 2: return std::make_unique<Uxrom>(std::move(image), header);
+    case 3: return std::make_unique<Cnrom>(std::move(image), header);
+    case 4: return std::make_unique<Mmc3>(std::move(image), header);
+    default: return nullptr;
+  }
+}
+
+Cartridge::Cartridge(RomImage image, const CartridgeHeader &header)
+  : _mirroring(header.mirroring), _image(std::move(image)), _header(header) {
+  _prg = _image.data() + HEADER_SIZE + (header.trainer ? TRAINER_SIZE : 0);
+  if (header.chr_rom_size > 0) {
+    _chr = _prg + header.prg_rom_size;
+    _chr_size = header.chr_rom_size;
+  } else {
+    _chr_ram.resize(8 * 1024);
+    _chr = _chr_ram.data();
+    _chr_size = _chr_ram.size();
+  }
+
+  // Smaller RAM chips repeat through the 8KB window, a page at least
+  if (header.prg_ram_size > 0) _prg_ram.resize(std::max(header.prg_ram_size, Bus::PAGE_SIZE));
+
+  // The trainer was meant to be loaded at $7000
+  if (header.trainer && _prg_ram.size() >= 0x1000 + TRAINER_SIZE) {
+    std::copy_n(_image.data() + HEADER_SIZE, TRAINER_SIZE, _prg_ram.begin() + 0x1000);
+  }
+
+  // The first 32KB of PRG and 8KB of CHR in order until the mapper says otherwise
+  for (u8 slot = 0; slot < _prg_offsets.size(); slot++) {
+    set_prg_bank(slot, slot);
+  }
+  set_chr_bank_8k(0);
+}
+
+void Cartridge::insert(Bus &bus) {
+  _bus = &bus;
+  map_prg_ram();
+  for (u8 slot = 0; slot < _prg_offsets.size(); slot++) {
+    map_prg_slot(slot);
+  }
+}
+
+u8 Cartridge::read(u16 address) const {
+  if (address >= 0x8000) {
+    return _prg[_prg_offsets[(address - 0x8000) / PRG_SLOT_SIZE] + (address & (PRG_SLOT_SIZE - 1))];
+  }
+  if (address >= 0x6000 && _prg_ram_readable && !_prg_ram.empty()) {
+    return _prg_ram[(address - 0x6000) % _prg_ram.size()];
+  }
+  return 0;
+}
+
+void Cartridge::write(u16 address, u8 value) {
+  if (address >= 0x8000) {
+    write_register(address, value);
+  } else if (address >= 0x6000 && _prg_ram_writable && !_prg_ram.empty()) {
+    _prg_ram[(address - 0x6000) % _prg_ram.size()] = value;
+  }
+}
+
+void Cartridge::write_chr(u16 address, u8 value) {
+  if (!_chr_ram.empty()) _chr_ram[_chr_offsets[(address >> 10) & 0x07] + (address & 0x03FF)] = value;
+}
+
+// Rewriting the same bank is common (MMC1 and MMC3 recompute every slot on
+// each register write) and must not throw away code decoded from it
+void Cartridge::set_prg_bank(u8 slot, size_t bank) {
+  const size_t offset = (bank % prg_bank_count()) * PRG_SLOT_SIZE;
+  if (offset == _prg_offsets[slot]) return;
+  _prg_offsets[slot] = offset;
+  if (_bus != nullptr) map_prg_slot(slot);
+}
+
+void Cartridge::set_prg_bank_16k(u8 half, size_t bank) {
+  set_prg_bank(half * 2, bank * 2);
+  set_prg_bank(half * 2 + 1, bank * 2 + 1);
+}
+
+void Cartridge::set_chr_bank(u8 slot, size_t bank) { _chr_offsets[slot] = (bank % chr_bank_count()) * CHR_SLOT_SIZE; }
+
+void Cartridge::set_chr_bank_4k(u8 half, size_t bank) {
+  for (u8 slot = 0; slot < 4; slot++) {
+    set_chr_bank(half * 4 + slot, bank * 4 + slot);
+  }
+}
+
+void Cartridge::set_chr_bank_8k(size_t bank) {
+  for (u8 slot = 0; slot < _chr_offsets.size(); slot++) {
+    set_chr_bank(slot, bank * 8 + slot);
+  }
+}
+
+void Cartridge::set_prg_ram_access(bool readable, bool writable) {
+  if (readable == _prg_ram_readable && writable == _prg_ram_writable) return;
+  _prg_ram_readable = readable;
+  _prg_ram_writable = writable;
+  if (_bus != nullptr) map_prg_ram();
+}
+
+void Cartridge::map_prg_slot(u8 slot) {
+  const u8 first_page = 0x80 + slot * (PRG_SLOT_SIZE / Bus::PAGE_SIZE);
+  for (size_t page = 0; page < PRG_SLOT_SIZE / Bus::PAGE_SIZE; page++) {
+    _bus->map_memory(first_page + page, _prg + _prg_offsets[slot] + page * Bus::PAGE_SIZE, nullptr, this);
+  }
+}
+
+// Disabled RAM reads as unmapped, write-protected RAM is mapped read-only
+void Cartridge::map_prg_ram() {
+  for (u8 page = 0x60; page <= 0x7F; page++) {
+    if (_prg_ram.empty() || !_prg_ram_readable) {
+      _bus->unmap(page);
+      continue;
+    }
+    u8 *memory = _prg_ram.data() + ((page - 0x60) * Bus::PAGE_SIZE) % _prg_ram.size();
+    _bus->map_memory(page, memory, _prg_ram_writable ? memory : nullptr);
+  }
+}
+
+}  // namespace nes
@@ -1,298 +1,1111 @@
 #include "../include/cpu.h"
+#include <algorithm>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <vector>
 #include "types.h"
 
 namespace nes {
 
-CPU::CPU(Bus &bus_ref)
+namespace {
+
+template <Variant Model>
+constexpr std::array<InstructionInfo, 256> build_instruction_info() {
+  std::array<InstructionInfo, 256> info{};
+  for (auto &entry : info) {
+    entry = {.mnemonic = "???", .mode = "IMP"};
+  }
+
+#define ADDRESSED(opcode_, mnemonic_, operation_, mode_, cycles_, extra_cycle_) \
+  info[(u8)Opcode::opcode_] = {.mnemonic = #mnemonic_, .mode = #mode_};
+#define IMPLIED(opcode_, mnemonic_, operation_, mode_, cycles_) info[(u8)Opcode::opcode_] = {.mnemonic = #mnemonic_, .mode = #mode_};
+#include "opcodes.def"
+  if constexpr (Model == Variant::CMOS_65C02) {
+#include "opcodes_65c02.def"
+  } else {
+#include "opcodes_nmos.def"
+  }
+#undef ADDRESSED
+#undef IMPLIED
+
+  return info;
+}
+
+// Disassembly metadata does not depend on the memory type, so every CPU of a variant shares one copy
+template <Variant Model>
+constexpr std::array<InstructionInfo, 256> INSTRUCTION_INFO = build_instruction_info<Model>();
+
+// The block cache can only be used on memory that reports writes into code pages
+template <typename Memory, typename = void>
+struct TracksCodeWrites : std::false_type {};
+template <typename Memory>
+struct TracksCodeWrites<Memory, std::void_t<decltype(&Memory::mark_code_page), decltype(&Memory::add_code_write_listener)>>
+  : std::true_type {};
+
+// Idle loops are only skipped on memory that can tell which reads are safe to leave out
+template <typename Memory, typename = void>
+struct ReportsReadSideEffects : std::false_type {};
+template <typename Memory>
+struct ReportsReadSideEffects<Memory, std::void_t<decltype(&Memory::has_read_side_effects)>> : std::true_type {};
+
+// Instructions an idle loop body may contain: they write no memory and leave the
+// same registers and flags behind every time they see the same registers and memory
+constexpr bool is_idle_loop_safe(const u8 opcode) {
+  switch ((Opcode)opcode) {
+    case Opcode::LDA_IMM:
+    case Opcode::LDA_ZPG:
+    case Opcode::LDA_ABS:
+    case Opcode::LDX_IMM:
+    case Opcode::LDX_ZPG:
+    case Opcode::LDX_ABS:
+    case Opcode::LDY_IMM:
+    case Opcode::LDY_ZPG:
+    case Opcode::LDY_ABS:
+    case Opcode::CMP_IMM:
+    case Opcode::CMP_ZPG:
+    case Opcode::CMP_ABS:
+    case Opcode::CPX_IMM:
+    case Opcode::CPX_ZPG:
+    case Opcode::CPX_ABS:
+    case Opcode::CPY_IMM:
+    case Opcode::CPY_ZPG:
+    case Opcode::CPY_ABS:
+    case Opcode::AND_IMM:
+    case Opcode::AND_ZPG:
+    case Opcode::AND_ABS:
+    case Opcode::ORA_IMM:
+    case Opcode::ORA_ZPG:
+    case Opcode::ORA_ABS:
+    case Opcode::EOR_IMM:
+    case Opcode::EOR_ZPG:
+    case Opcode::EOR_ABS:
+    case Opcode::BIT_ZPG:
+    case Opcode::BIT_ABS:
+    case Opcode::TAX_IMP:
+    case Opcode::TAY_IMP:
+    case Opcode::TXA_IMP:
+    case Opcode::TYA_IMP:
+    case Opcode::TSX_IMP:
+    case Opcode::CLC_IMP:
+    case Opcode::SEC_IMP:
+    case Opcode::CLV_IMP:
+    case Opcode::CLD_IMP:
+    case Opcode::SED_IMP:
+    case Opcode::NOP_IMP:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Memory that can be read without side effects, so code is looked at ahead of execution through it
+template <typename Memory, typename = void>
+struct PeeksMemory : std::false_type {};
+template <typename Memory>
+struct PeeksMemory<Memory, std::void_t<decltype(&Memory::peek)>> : std::true_type {};
+
+// Memory with a data bus latch, which decoded instructions set in place of their skipped fetch
+template <typename Memory, typename = void>
+struct HasOpenBus : std::false_type {};
+template <typename Memory>
+struct HasOpenBus<Memory, std::void_t<decltype(&Memory::set_open_bus)>> : std::true_type {};
+
+// Memory whose page tables translated code may read and write directly
+template <typename Memory, typename = void>
+struct ExposesPageTables : std::false_type {};
+template <typename Memory>
+struct ExposesPageTables<Memory, std::void_t<decltype(&Memory::get_page_tables)>> : std::true_type {};
+
+// How the JIT may emit an opcode inline. These opcodes behave the same on every
+// variant; anything not listed keeps JitOperation::CALL. CLI and SEI are left to
+// their handlers since they decide whether a pending IRQ can be taken.
+void describe_for_jit(JitInstruction &instruction, const u8 opcode) {
+  const auto access = [&instruction](JitOperation operation, JitRegister reg, JitAddressing addressing,
+                                     JitRegister index = JitRegister::X) {
+    instruction.operation = operation;
+    instruction.reg = reg;
+    instruction.addressing = addressing;
+    instruction.index = index;
+  };
+  const auto registers = [&instruction](JitOperation operation, JitRegister reg, JitRegister source = JitRegister::A) {
+    instruction.operation = operation;
+    instruction.reg = reg;
+    instruction.index = source;
+  };
+  const auto flag = [&instruction](JitOperation operation, Flag flag, bool expected = false) {
+    instruction.operation = operation;
+    instruction.flag = (u8)flag;
+    instruction.expected = expected;
+  };
+  constexpr JitOperation LOAD = JitOperation::LOAD;
+  constexpr JitOperation STORE = JitOperation::STORE;
+  constexpr JitRegister A = JitRegister::A;
+  constexpr JitRegister X = JitRegister::X;
+  constexpr JitRegister Y = JitRegister::Y;
+  constexpr JitAddressing FIXED = JitAddressing::FIXED;
+  constexpr JitAddressing ZERO_PAGE_INDEXED = JitAddressing::ZERO_PAGE_INDEXED;
+  constexpr JitAddressing INDEXED = JitAddressing::INDEXED;
+
+  switch ((Opcode)opcode) {
+    // Loads (the immediate operand is the address of the value)
+    case Opcode::LDA_IMM:
+    case Opcode::LDA_ZPG:
+    case Opcode::LDA_ABS: return access(LOAD, A, FIXED);
+    case Opcode::LDA_ZPX: return access(LOAD, A, ZERO_PAGE_INDEXED, X);
+    case Opcode::LDA_ABX: return access(LOAD, A, INDEXED, X);
+    case Opcode::LDA_ABY: return access(LOAD, A, INDEXED, Y);
+    case Opcode::LDX_IMM:
+    case Opcode::LDX_ZPG:
+    case Opcode::LDX_ABS: return access(LOAD, X, FIXED);
+    case Opcode::LDX_ZPY: return access(LOAD, X, ZERO_PAGE_INDEXED, Y);
+    case Opcode::LDX_ABY: return access(LOAD, X, INDEXED, Y);
+    case Opcode::LDY_IMM:
+    case Opcode::LDY_ZPG:
+    case Opcode::LDY_ABS: return access(LOAD, Y, FIXED);
+    case Opcode::LDY_ZPX: return access(LOAD, Y, ZERO_PAGE_INDEXED, X);
+    case Opcode::LDY_ABX: return access(LOAD, Y, INDEXED, X);
+    // Stores
+    case Opcode::STA_ZPG:
+    case Opcode::STA_ABS: return access(STORE, A, FIXED);
+    case Opcode::STA_ZPX: return access(STORE, A, ZERO_PAGE_INDEXED, X);
+    case Opcode::STA_ABX: return access(STORE, A, INDEXED, X);
+    case Opcode::STA_ABY: return access(STORE, A, INDEXED, Y);
+    case Opcode::STX_ZPG:
+    case Opcode::STX_ABS: return access(STORE, X, FIXED);
+    case Opcode::STX_ZPY: return access(STORE, X, ZERO_PAGE_INDEXED, Y);
+    case Opcode::STY_ZPG:
+    case Opcode::STY_ABS: return access(STORE, Y, FIXED);
+    case Opcode::STY_ZPX: return access(STORE, Y, ZERO_PAGE_INDEXED, X);
+    // Transfers
+    case Opcode::TAX_IMP: return registers(JitOperation::TRANSFER, X, A);
+    case Opcode::TAY_IMP: return registers(JitOperation::TRANSFER, Y, A);
+    case Opcode::TXA_IMP: return registers(JitOperation::TRANSFER, A, X);
+    case Opcode::TYA_IMP: return registers(JitOperation::TRANSFER, A, Y);
+    case Opcode::TSX_IMP: return registers(JitOperation::TRANSFER, X, JitRegister::SP);
+    case Opcode::TXS_IMP: return registers(JitOperation::TRANSFER, JitRegister::SP, X);
+    // Register increments
+    case Opcode::INX_IMP: return registers(JitOperation::INCREMENT, X);
+    case Opcode::INY_IMP: return registers(JitOperation::INCREMENT, Y);
+    case Opcode::DEX_IMP: return registers(JitOperation::DECREMENT, X);
+    case Opcode::DEY_IMP: return registers(JitOperation::DECREMENT, Y);
+    // Flags
+    case Opcode::CLC_IMP: return flag(JitOperation::CLEAR_FLAG, Flag::CARRY);
+    case Opcode::SEC_IMP: return flag(JitOperation::SET_FLAG, Flag::CARRY);
+    case Opcode::CLD_IMP: return flag(JitOperation::CLEAR_FLAG, Flag::DECIMAL);
+    case Opcode::SED_IMP: return flag(JitOperation::SET_FLAG, Flag::DECIMAL);
+    case Opcode::CLV_IMP: return flag(JitOperation::CLEAR_FLAG, Flag::OVERFLOW_);
+    // Branches
+    case Opcode::BPL_REL: return flag(JitOperation::BRANCH, Flag::NEGATIVE, false);
+    case Opcode::BMI_REL: return flag(JitOperation::BRANCH, Flag::NEGATIVE, true);
+    case Opcode::BVC_REL: return flag(JitOperation::BRANCH, Flag::OVERFLOW_, false);
+    case Opcode::BVS_REL: return flag(JitOperation::BRANCH, Flag::OVERFLOW_, true);
+    case Opcode::BCC_REL: return flag(JitOperation::BRANCH, Flag::CARRY, false);
+    case Opcode::BCS_REL: return flag(JitOperation::BRANCH, Flag::CARRY, true);
+    case Opcode::BNE_REL: return flag(JitOperation::BRANCH, Flag::ZERO, false);
+    case Opcode::BEQ_REL: return flag(JitOperation::BRANCH, Flag::ZERO, true);
+    case Opcode::JMP_ABS: instruction.operation = JitOperation::JUMP; return;
+    default: return;
+  }
+}
+
+}  // namespace
+
+template <typename Memory, Variant Model>
+constexpr typename BasicCPU<Memory, Model>::InstructionTable BasicCPU<Memory, Model>::build_instruction_table() {
+  // Every slot not listed in opcodes.def stays invalid (0 cycles)
+  InstructionTable table{};
+
+#define ADDRESSED(opcode_, mnemonic_, operation_, mode_, cycles_, extra_cycle_)                                             \
+  table[(u8)Opcode::opcode_] = {.handler = &BasicCPU::execute_addressed<AddressingMode::mode_, &BasicCPU::operation_, extra_cycle_>, \
+                                .cycles = cycles_,                                                                             \
+                                .flags = (extra_cycle_) ? Instruction::EXTRA_CYCLE : (u8)0};
+#define IMPLIED(opcode_, mnemonic_, operation_, mode_, cycles_)                                                        \
+  table[(u8)Opcode::opcode_] = {                                                                                       \
+      .handler = &BasicCPU::execute_implied<&BasicCPU::operation_>, .cycles = cycles_, .flags = Instruction::IMPLIED};
+#include "opcodes.def"
+  if constexpr (Model == Variant::CMOS_65C02) {
+#include "opcodes_65c02.def"
+  } else {
+#include "opcodes_nmos.def"
+  }
+#undef ADDRESSED
+#undef IMPLIED
+
+  return table;
+}
+
+template <typename Memory, Variant Model>
+constexpr typename BasicCPU<Memory, Model>::InstructionTable BasicCPU<Memory, Model>::_instruction_table = BasicCPU<Memory, Model>::build_instruction_table();
+
+template <typename Memory, Variant Model>
+constexpr typename BasicCPU<Memory, Model>::DecodedTable BasicCPU<Memory, Model>::build_decoded_table() {
+  DecodedTable table{};
+
+#define ADDRESSED(opcode_, mnemonic_, operation_, mode_, cycles_, extra_cycle_)                                            \
+  table[(u8)Opcode::opcode_] = {.handler = &BasicCPU::execute_decoded<AddressingMode::mode_, &BasicCPU::operation_, extra_cycle_>, \
+                                .mode = AddressingMode::mode_,                                                                \
+                                .ends_block = AddressingMode::mode_ == AddressingMode::REL};
+#define IMPLIED(opcode_, mnemonic_, operation_, mode_, cycles_)                                                              \
+  table[(u8)Opcode::opcode_] = {                                                                                             \
+      .handler = &BasicCPU::execute_decoded_implied<&BasicCPU::operation_>, .mode = AddressingMode::mode_, .ends_block = false};
+#include "opcodes.def"
+  if constexpr (Model == Variant::CMOS_65C02) {
+#include "opcodes_65c02.def"
+  } else {
+#include "opcodes_nmos.def"
+  }
+#undef ADDRESSED
+#undef IMPLIED
+
+  // Everything else that moves the PC somewhere other than the next instruction
+  table[(u8)Opcode::JMP_ABS].ends_block = true;
+  table[(u8)Opcode::JMP_IND].ends_block = true;
+  table[(u8)Opcode::JSR_ABS].ends_block = true;
+  table[(u8)Opcode::RTS_IMP].ends_block = true;
+  table[(u8)Opcode::RTI_IMP].ends_block = true;
+  table[(u8)Opcode::BRK_IMP].ends_block = true;
+  if constexpr (Model == Variant::CMOS_65C02) table[(u8)Opcode::JMP_AIX].ends_block = true;
+
+  return table;
+}
+
+template <typename Memory, Variant Model>
+constexpr typename BasicCPU<Memory, Model>::DecodedTable BasicCPU<Memory, Model>::_decoded_table = BasicCPU<Memory, Model>::build_decoded_table();
+
+// Pairs common enough in compiled and hand-written loops to be worth a handler
+// of their own, in the addressing modes they usually come in
+template <typename Memory, Variant Model>
+constexpr typename BasicCPU<Memory, Model>::PairTable BasicCPU<Memory, Model>::build_pair_table() {
+  PairTable table{};
+  size_t count = 1;  // Entry 0 means the instruction is not paired
+
+#define PAIR(pairing_, first_, second_)                                  \
+  table[count++] = {.first = (u8)Opcode::first_,                         \
+                    .second = (u8)Opcode::second_,                       \
+                    .handler = &BasicCPU::execute_pair<Pairing::pairing_, (u8)Opcode::first_, (u8)Opcode::second_>};
+#define LOAD_STORE(load_mode_)               \
+  PAIR(LOAD_STORE, LDA_##load_mode_, STA_ZPG) \
+  PAIR(LOAD_STORE, LDA_##load_mode_, STA_ABS) \
+  PAIR(LOAD_STORE, LDA_##load_mode_, STA_ABX) \
+  PAIR(LOAD_STORE, LDA_##load_mode_, STA_ABY) \
+  PAIR(LOAD_STORE, LDA_##load_mode_, STA_IZY)
+  LOAD_STORE(IMM)
+  LOAD_STORE(ZPG)
+  LOAD_STORE(ABS)
+  LOAD_STORE(ABX)
+  LOAD_STORE(ABY)
+  LOAD_STORE(IZY)
+#undef LOAD_STORE
+#define WITH_VALUE(pairing_, first_, second_) \
+  PAIR(pairing_, first_, second_##_IMM)        \
+  PAIR(pairing_, first_, second_##_ZPG)        \
+  PAIR(pairing_, first_, second_##_ABS)        \
+  PAIR(pairing_, first_, second_##_ABX)        \
+  PAIR(pairing_, first_, second_##_ABY)        \
+  PAIR(pairing_, first_, second_##_IZY)
+  WITH_VALUE(CLEAR_ADD, CLC_IMP, ADC)
+  WITH_VALUE(SET_SUBTRACT, SEC_IMP, SBC)
+#undef WITH_VALUE
+  PAIR(COMPARE_BRANCH, CMP_IMM, BEQ_REL)
+  PAIR(COMPARE_BRANCH, CMP_ZPG, BEQ_REL)
+  PAIR(COMPARE_BRANCH, CMP_ABS, BEQ_REL)
+  PAIR(COMPARE_BRANCH, CMP_ABX, BEQ_REL)
+  PAIR(COMPARE_BRANCH, CMP_ABY, BEQ_REL)
+  PAIR(COMPARE_BRANCH, CMP_IZY, BEQ_REL)
+  PAIR(INCREMENT_COMPARE, INY_IMP, CPY_IMM)
+  PAIR(INCREMENT_COMPARE, INY_IMP, CPY_ZPG)
+  PAIR(INCREMENT_COMPARE, INY_IMP, CPY_ABS)
+  PAIR(DECREMENT_BRANCH, DEX_IMP, BNE_REL)
+#undef PAIR
+
+  return table;
+}
+
+template <typename Memory, Variant Model>
+constexpr typename BasicCPU<Memory, Model>::PairTable BasicCPU<Memory, Model>::_pair_table = BasicCPU<Memory, Model>::build_pair_table();
+
+template <typename Memory, Variant Model>
+template <u8 Opcode>
+void BasicCPU<Memory, Model>::execute_from_jit(void *cpu, const u16 operand) {
+  BasicCPU &self = *static_cast<BasicCPU *>(cpu);
+  try {
+    _decoded_table[Opcode].handler(self, operand);
+  } catch (...) {
+    // The block returns at its next check, or right away after its last instruction
+    self._jit_exception = std::current_exception();
+    self._pending_signals |= SIGNAL_EXCEPTION;
+  }
+}
+
+template <typename Memory, Variant Model>
+template <size_t... Opcodes>
+constexpr typename BasicCPU<Memory, Model>::JitEntryTable BasicCPU<Memory, Model>::build_jit_entries(std::index_sequence<Opcodes...>) {
+  // Unknown opcodes never make it into a block
+  return {{(_decoded_table[Opcodes].handler != nullptr ? &BasicCPU::execute_from_jit<(u8)Opcodes> : nullptr)...}};
+}
+
+template <typename Memory, Variant Model>
+constexpr typename BasicCPU<Memory, Model>::JitEntryTable BasicCPU<Memory, Model>::_jit_entries =
+    BasicCPU<Memory, Model>::build_jit_entries(std::make_index_sequence<INSTRUCTION_TABLE_SIZE>{});
+
+template <typename Memory, Variant Model>
+u8 BasicCPU<Memory, Model>::find_pair(const u8 first, const u8 second) {
+  for (u8 index = 1; index < PAIR_TABLE_SIZE && _pair_table[index].handler != nullptr; index++) {
+    if (_pair_table[index].first == first && _pair_table[index].second == second) return index;
+  }
+  return 0;
+}
+
+template <typename Memory, Variant Model>
+BasicCPU<Memory, Model>::BasicCPU(Memory &bus_ref)
   : _bus(bus_ref) {
   reset();
+  set_idle_loop_skip_enabled(true);
+  if constexpr (JIT_BY_DEFAULT) set_jit_enabled(true);
+}
+
+template <typename Memory, Variant Model>
+BasicCPU<Memory, Model>::~BasicCPU() {
+  set_block_cache_enabled(false);
+}
 
-  // Initialize all opcodes as invalid
-  _instruction_table.fill({.addressed_op = nullptr, .mode = nullptr, .cycles = 0, .name = "???"});
-  auto set_op = [this](const Opcode &op, const Instruction &instr) { _instruction_table[(u8)op] = instr; };
-
-  // LDA
-  set_op(Opcode::LDA_IMM, {.addressed_op = &CPU::op_lda, .mode = &CPU::immediate, .cycles = 2, .name = "LDA"});
-  set_op(Opcode::LDA_ZPG, {.addressed_op = &CPU::op_lda, .mode = &CPU::zero_page, .cycles = 3, .name = "LDA"});
-  set_op(Opcode::LDA_ABS, {.addressed_op = &CPU::op_lda, .mode = &CPU::absolute, .cycles = 4, .name = "LDA"});
-  set_op(Opcode::LDA_ABX, {.addressed_op = &CPU::op_lda, .mode = &CPU::absolute_x, .cycles = 4, .name = "LDA", .is_extra_cycle = true});
-  set_op(Opcode::LDA_ABY, {.addressed_op = &CPU::op_lda, .mode = &CPU::absolute_y, .cycles = 4, .name = "LDA", .is_extra_cycle = true});
-  set_op(Opcode::LDA_ZPX, {.addressed_op = &CPU::op_lda, .mode = &CPU::zero_page_x, .cycles = 4, .name = "LDA"});
-  set_op(Opcode::LDA_IZX, {.addressed_op = &CPU::op_lda, .mode = &CPU::indirect_x, .cycles = 6, .name = "LDA"});
-  set_op(Opcode::LDA_IZY, {.addressed_op = &CPU::op_lda, .mode = &CPU::indirect_y, .cycles = 5, .name = "LDA", .is_extra_cycle = true});
-
-  // LDX
-  set_op(Opcode::LDX_IMM, {.addressed_op = &CPU::op_ldx, .mode = &CPU::immediate, .cycles = 2, .name = "LDX"});
-  set_op(Opcode::LDX_ABS, {.addressed_op = &CPU::op_ldx, .mode = &CPU::absolute, .cycles = 4, .name = "LDX"});
-  set_op(Opcode::LDX_ABY, {.addressed_op = &CPU::op_ldx, .mode = &CPU::absolute_y, .cycles = 4, .name = "LDX", .is_extra_cycle = true});
-  set_op(Opcode::LDX_ZPG, {.addressed_op = &CPU::op_ldx, .mode = &CPU::zero_page, .cycles = 3, .name = "LDX"});
-  set_op(Opcode::LDX_ZPY, {.addressed_op = &CPU::op_ldx, .mode = &CPU::zero_page_y, .cycles = 4, .name = "LDX"});
-
-  // LDY
-  set_op(Opcode::LDY_IMM, {.addressed_op = &CPU::op_ldy, .mode = &CPU::immediate, .cycles = 2, .name = "LDY"});
-  set_op(Opcode::LDY_ABS, {.addressed_op = &CPU::op_ldy, .mode = &CPU::absolute, .cycles = 4, .name = "LDY"});
-  set_op(Opcode::LDY_ABX, {.addressed_op = &CPU::op_ldy, .mode = &CPU::absolute_x, .cycles = 4, .name = "LDY", .is_extra_cycle = true});
-  set_op(Opcode::LDY_ZPG, {.addressed_op = &CPU::op_ldy, .mode = &CPU::zero_page, .cycles = 3, .name = "LDY"});
-  set_op(Opcode::LDY_ZPX, {.addressed_op = &CPU::op_ldy, .mode = &CPU::zero_page_x, .cycles = 4, .name = "LDY"});
-
-  // STA
-  set_op(Opcode::STA_ABS, {.addressed_op = &CPU::op_sta, .mode = &CPU::absolute, .cycles = 4, .name = "STA"});
-  set_op(Opcode::STA_ABX, {.addressed_op = &CPU::op_sta, .mode = &CPU::absolute_x, .cycles = 5, .name = "STA"});
-  set_op(Opcode::STA_ABY, {.addressed_op = &CPU::op_sta, .mode = &CPU::absolute_y, .cycles = 5, .name = "STA"});
-  set_op(Opcode::STA_ZPG, {.addressed_op = &CPU::op_sta, .mode = &CPU::zero_page, .cycles = 3, .name = "STA"});
-  set_op(Opcode::STA_ZPX, {.addressed_op = &CPU::op_sta, .mode = &CPU::zero_page_x, .cycles = 4, .name = "STA"});
-  set_op(Opcode::STA_IZX, {.addressed_op = &CPU::op_sta, .mode = &CPU::indirect_x, .cycles = 6, .name = "STA"});
-  set_op(Opcode::STA_IZY, {.addressed_op = &CPU::op_sta, .mode = &CPU::indirect_y, .cycles = 6, .name = "STA"});
-
-  // STX
-  set_op(Opcode::STX_ABS, {.addressed_op = &CPU::op_stx, .mode = &CPU::absolute, .cycles = 4, .name = "STX"});
-  set_op(Opcode::STX_ZPG, {.addressed_op = &CPU::op_stx, .mode = &CPU::zero_page, .cycles = 3, .name = "STX"});
-  set_op(Opcode::STX_ZPY, {.addressed_op = &CPU::op_stx, .mode = &CPU::zero_page_y, .cycles = 4, .name = "STX"});
-
-  // STY
-  set_op(Opcode::STY_ABS, {.addressed_op = &CPU::op_sty, .mode = &CPU::absolute, .cycles = 4, .name = "STY"});
-  set_op(Opcode::STY_ZPG, {.addressed_op = &CPU::op_sty, .mode = &CPU::zero_page, .cycles = 3, .name = "STY"});
-  set_op(Opcode::STY_ZPX, {.addressed_op = &CPU::op_sty, .mode = &CPU::zero_page_x, .cycles = 4, .name = "STY"});
-
-  // Transfer operations (implied addressing)
-  set_op(Opcode::TAX_IMP, {.implied_op = &CPU::op_tax, .mode = nullptr, .cycles = 2, .name = "TAX", .is_implied = true});
-  set_op(Opcode::TAY_IMP, {.implied_op = &CPU::op_tay, .mode = nullptr, .cycles = 2, .name = "TAY", .is_implied = true});
-  set_op(Opcode::TSX_IMP, {.implied_op = &CPU::op_tsx, .mode = nullptr, .cycles = 2, .name = "TSX", .is_implied = true});
-  set_op(Opcode::TYA_IMP, {.implied_op = &CPU::op_tya, .mode = nullptr, .cycles = 2, .name = "TYA", .is_implied = true});
-  set_op(Opcode::TXS_IMP, {.implied_op = &CPU::op_txs, .mode = nullptr, .cycles = 2, .name = "TXS", .is_implied = true});
-  set_op(Opcode::TXA_IMP, {.implied_op = &CPU::op_txa, .mode = nullptr, .cycles = 2, .name = "TXA", .is_implied = true});
-
-  // Stack operations (implied addressing)
-  set_op(Opcode::PHA_IMP, {.implied_op = &CPU::op_pha, .mode = nullptr, .cycles = 3, .name = "PHA", .is_implied = true});
-  set_op(Opcode::PLA_IMP, {.implied_op = &CPU::op_pla, .mode = nullptr, .cycles = 4, .name = "PLA", .is_implied = true});
-  set_op(Opcode::PLP_IMP, {.implied_op = &CPU::op_plp, .mode = nullptr, .cycles = 4, .name = "PLP", .is_implied = true});
-  set_op(Opcode::PHP_IMP, {.implied_op = &CPU::op_php, .mode = nullptr, .cycles = 3, .name = "PHP", .is_implied = true});
-
-  // ASL
-  set_op(Opcode::ASL_ACC, {.implied_op = &CPU::op_asl_acc, .mode = nullptr, .cycles = 2, .name = "ASL", .is_implied = true});
-  set_op(Opcode::ASL_ABS, {.addressed_op = &CPU::op_asl, .mode = &CPU::absolute, .cycles = 6, .name = "ASL"});
-  set_op(Opcode::ASL_ABX, {.addressed_op = &CPU::op_asl, .mode = &CPU::absolute_x, .cycles = 7, .name = "ASL"});
-  set_op(Opcode::ASL_ZPG, {.addressed_op = &CPU::op_asl, .mode = &CPU::zero_page, .cycles = 5, .name = "ASL"});
-  set_op(Opcode::ASL_ZPX, {.addressed_op = &CPU::op_asl, .mode = &CPU::zero_page_x, .cycles = 6, .name = "ASL"});
-
-  // LSR
-  set_op(Opcode::LSR_ACC, {.implied_op = &CPU::op_lsr_acc, .mode = nullptr, .cycles = 2, .name = "LSR", .is_implied = true});
-  set_op(Opcode::LSR_ABS, {.addressed_op = &CPU::op_lsr, .mode = &CPU::absolute, .cycles = 6, .name = "LSR"});
-  set_op(Opcode::LSR_ABX, {.addressed_op = &CPU::op_lsr, .mode = &CPU::absolute_x, .cycles = 7, .name = "LSR"});
-  set_op(Opcode::LSR_ZPG, {.addressed_op = &CPU::op_lsr, .mode = &CPU::zero_page, .cycles = 5, .name = "LSR"});
-  set_op(Opcode::LSR_ZPX, {.addressed_op = &CPU::op_lsr, .mode = &CPU::zero_page_x, .cycles = 6, .name = "LSR"});
-
-  // ROL
-  set_op(Opcode::ROL_ACC, {.implied_op = &CPU::op_rol_acc, .mode = nullptr, .cycles = 2, .name = "ROL", .is_implied = true});
-  set_op(Opcode::ROL_ABS, {.addressed_op = &CPU::op_rol, .mode = &CPU::absolute, .cycles = 6, .name = "ROL"});
-  set_op(Opcode::ROL_ABX, {.addressed_op = &CPU::op_rol, .mode = &CPU::absolute_x, .cycles = 7, .name = "ROL"});
-  set_op(Opcode::ROL_ZPG, {.addressed_op = &CPU::op_rol, .mode = &CPU::zero_page, .cycles = 5, .name = "ROL"});
-  set_op(Opcode::ROL_ZPX, {.addressed_op = &CPU::op_rol, .mode = &CPU::zero_page_x, .cycles = 6, .name = "ROL"});
-
-  // ROR
-  set_op(Opcode::ROR_ACC, {.implied_op = &CPU::op_ror_acc, .mode = nullptr, .cycles = 2, .name = "ROR", .is_implied = true});
-  set_op(Opcode::ROR_ABS, {.addressed_op = &CPU::op_ror, .mode = &CPU::absolute, .cycles = 6, .name = "ROR"});
-  set_op(Opcode::ROR_ABX, {.addressed_op = &CPU::op_ror, .mode = &CPU::absolute_x, .cycles = 7, .name = "ROR"});
-  set_op(Opcode::ROR_ZPG, {.addressed_op = &CPU::op_ror, .mode = &CPU::zero_page, .cycles = 5, .name = "ROR"});
-  set_op(Opcode::ROR_ZPX, {.addressed_op = &CPU::op_ror, .mode = &CPU::zero_page_x, .cycles = 6, .name = "ROR"});
-
-  // Arithmetic instructions
-  // ADC
-  set_op(Opcode::ADC_IMM, {.addressed_op = &CPU::op_adc, .mode = &CPU::immediate, .cycles = 2, .name = "ADC"});
-  set_op(Opcode::ADC_ZPG, {.addressed_op = &CPU::op_adc, .mode = &CPU::zero_page, .cycles = 3, .name = "ADC"});
-  set_op(Opcode::ADC_ABS, {.addressed_op = &CPU::op_adc, .mode = &CPU::absolute, .cycles = 4, .name = "ADC"});
-  set_op(Opcode::ADC_ABX, {.addressed_op = &CPU::op_adc, .mode = &CPU::absolute_x, .cycles = 4, .name = "ADC", .is_extra_cycle = true});
-  set_op(Opcode::ADC_ABY, {.addressed_op = &CPU::op_adc, .mode = &CPU::absolute_y, .cycles = 4, .name = "ADC", .is_extra_cycle = true});
-  set_op(Opcode::ADC_ZPX, {.addressed_op = &CPU::op_adc, .mode = &CPU::zero_page_x, .cycles = 4, .name = "ADC"});
-  set_op(Opcode::ADC_IZX, {.addressed_op = &CPU::op_adc, .mode = &CPU::indirect_x, .cycles = 6, .name = "ADC"});
-  set_op(Opcode::ADC_IZY, {.addressed_op = &CPU::op_adc, .mode = &CPU::indirect_y, .cycles = 5, .name = "ADC", .is_extra_cycle = true});
-
-  // SBC
-  set_op(Opcode::SBC_IMM, {.addressed_op = &CPU::op_sbc, .mode = &CPU::immediate, .cycles = 2, .name = "SBC"});
-  set_op(Opcode::SBC_ZPG, {.addressed_op = &CPU::op_sbc, .mode = &CPU::zero_page, .cycles = 3, .name = "SBC"});
-  set_op(Opcode::SBC_ABS, {.addressed_op = &CPU::op_sbc, .mode = &CPU::absolute, .cycles = 4, .name = "SBC"});
-  set_op(Opcode::SBC_ABX, {.addressed_op = &CPU::op_sbc, .mode = &CPU::absolute_x, .cycles = 4, .name = "SBC", .is_extra_cycle = true});
-  set_op(Opcode::SBC_ABY, {.addressed_op = &CPU::op_sbc, .mode = &CPU::absolute_y, .cycles = 4, .name = "SBC", .is_extra_cycle = true});
-  set_op(Opcode::SBC_ZPX, {.addressed_op = &CPU::op_sbc, .mode = &CPU::zero_page_x, .cycles = 4, .name = "SBC"});
-  set_op(Opcode::SBC_IZX, {.addressed_op = &CPU::op_sbc, .mode = &CPU::indirect_x, .cycles = 6, .name = "SBC"});
-  set_op(Opcode::SBC_IZY, {.addressed_op = &CPU::op_sbc, .mode = &CPU::indirect_y, .cycles = 5, .name = "SBC", .is_extra_cycle = true});
-
-  // CMP
-  set_op(Opcode::CMP_IMM, {.addressed_op = &CPU::op_cmp, .mode = &CPU::immediate, .cycles = 2, .name = "CMP"});
-  set_op(Opcode::CMP_ZPG, {.addressed_op = &CPU::op_cmp, .mode = &CPU::zero_page, .cycles = 3, .name = "CMP"});
-  set_op(Opcode::CMP_ABS, {.addressed_op = &CPU::op_cmp, .mode = &CPU::absolute, .cycles = 4, .name = "CMP"});
-  set_op(Opcode::CMP_ABX, {.addressed_op = &CPU::op_cmp, .mode = &CPU::absolute_x, .cycles = 4, .name = "CMP", .is_extra_cycle = true});
-  set_op(Opcode::CMP_ABY, {.addressed_op = &CPU::op_cmp, .mode = &CPU::absolute_y, .cycles = 4, .name = "CMP", .is_extra_cycle = true});
-  set_op(Opcode::CMP_ZPX, {.addressed_op = &CPU::op_cmp, .mode = &CPU::zero_page_x, .cycles = 4, .name = "CMP"});
-  set_op(Opcode::CMP_IZX, {.addressed_op = &CPU::op_cmp, .mode = &CPU::indirect_x, .cycles = 6, .name = "CMP"});
-  set_op(Opcode::CMP_IZY, {.addressed_op = &CPU::op_cmp, .mode = &CPU::indirect_y, .cycles = 5, .name = "CMP", .is_extra_cycle = true});
-
-  // CPX
-  set_op(Opcode::CPX_IMM, {.addressed_op = &CPU::op_cpx, .mode = &CPU::immediate, .cycles = 2, .name = "CPX"});
-  set_op(Opcode::CPX_ZPG, {.addressed_op = &CPU::op_cpx, .mode = &CPU::zero_page, .cycles = 3, .name = "CPX"});
-  set_op(Opcode::CPX_ABS, {.addressed_op = &CPU::op_cpx, .mode = &CPU::absolute, .cycles = 4, .name = "CPX"});
-
-  // CPX
-  set_op(Opcode::CPY_IMM, {.addressed_op = &CPU::op_cpy, .mode = &CPU::immediate, .cycles = 2, .name = "CPY"});
-  set_op(Opcode::CPY_ZPG, {.addressed_op = &CPU::op_cpy, .mode = &CPU::zero_page, .cycles = 3, .name = "CPY"});
-  set_op(Opcode::CPY_ABS, {.addressed_op = &CPU::op_cpy, .mode = &CPU::absolute, .cycles = 4, .name = "CPY"});
-
-  // Logical operations
-  set_op(Opcode::AND_IMM, {.addressed_op = &CPU::op_and, .mode = &CPU::immediate, .cycles = 2, .name = "AND"});
-  set_op(Opcode::AND_ZPG, {.addressed_op = &CPU::op_and, .mode = &CPU::zero_page, .cycles = 3, .name = "AND"});
-  set_op(Opcode::AND_ABS, {.addressed_op = &CPU::op_and, .mode = &CPU::absolute, .cycles = 4, .name = "AND"});
-  set_op(Opcode::AND_ABX, {.addressed_op = &CPU::op_and, .mode = &CPU::absolute_x, .cycles = 4, .name = "AND", .is_extra_cycle = true});
-  set_op(Opcode::AND_ABY, {.addressed_op = &CPU::op_and, .mode = &CPU::absolute_y, .cycles = 4, .name = "AND", .is_extra_cycle = true});
-  set_op(Opcode::AND_ZPX, {.addressed_op = &CPU::op_and, .mode = &CPU::zero_page_x, .cycles = 4, .name = "AND"});
-  set_op(Opcode::AND_IZX, {.addressed_op = &CPU::op_and, .mode = &CPU::indirect_x, .cycles = 6, .name = "AND"});
-  set_op(Opcode::AND_IZY, {.addressed_op = &CPU::op_and, .mode = &CPU::indirect_y, .cycles = 5, .name = "AND", .is_extra_cycle = true});
-
-  // EOR
-  set_op(Opcode::EOR_IMM, {.addressed_op = &CPU::op_eor, .mode = &CPU::immediate, .cycles = 2, .name = "EOR"});
-  set_op(Opcode::EOR_ZPG, {.addressed_op = &CPU::op_eor, .mode = &CPU::zero_page, .cycles = 3, .name = "EOR"});
-  set_op(Opcode::EOR_ABS, {.addressed_op = &CPU::op_eor, .mode = &CPU::absolute, .cycles = 4, .name = "EOR"});
-  set_op(Opcode::EOR_ABX, {.addressed_op = &CPU::op_eor, .mode = &CPU::absolute_x, .cycles = 4, .name = "EOR", .is_extra_cycle = true});
-  set_op(Opcode::EOR_ABY, {.addressed_op = &CPU::op_eor, .mode = &CPU::absolute_y, .cycles = 4, .name = "EOR", .is_extra_cycle = true});
-  set_op(Opcode::EOR_ZPX, {.addressed_op = &CPU::op_eor, .mode = &CPU::zero_page_x, .cycles = 4, .name = "EOR"});
-  set_op(Opcode::EOR_IZX, {.addressed_op = &CPU::op_eor, .mode = &CPU::indirect_x, .cycles = 6, .name = "EOR"});
-  set_op(Opcode::EOR_IZY, {.addressed_op = &CPU::op_eor, .mode = &CPU::indirect_y, .cycles = 5, .name = "EOR", .is_extra_cycle = true});
-
-  // ORA
-  set_op(Opcode::ORA_IMM, {.addressed_op = &CPU::op_ora, .mode = &CPU::immediate, .cycles = 2, .name = "ORA"});
-  set_op(Opcode::ORA_ZPG, {.addressed_op = &CPU::op_ora, .mode = &CPU::zero_page, .cycles = 3, .name = "ORA"});
-  set_op(Opcode::ORA_ABS, {.addressed_op = &CPU::op_ora, .mode = &CPU::absolute, .cycles = 4, .name = "ORA"});
-  set_op(Opcode::ORA_ABX, {.addressed_op = &CPU::op_ora, .mode = &CPU::absolute_x, .cycles = 4, .name = "ORA", .is_extra_cycle = true});
-  set_op(Opcode::ORA_ABY, {.addressed_op = &CPU::op_ora, .mode = &CPU::absolute_y, .cycles = 4, .name = "ORA", .is_extra_cycle = true});
-  set_op(Opcode::ORA_ZPX, {.addressed_op = &CPU::op_ora, .mode = &CPU::zero_page_x, .cycles = 4, .name = "ORA"});
-  set_op(Opcode::ORA_IZX, {.addressed_op = &CPU::op_ora, .mode = &CPU::indirect_x, .cycles = 6, .name = "ORA"});
-  set_op(Opcode::ORA_IZY, {.addressed_op = &CPU::op_ora, .mode = &CPU::indirect_y, .cycles = 5, .name = "ORA", .is_extra_cycle = true});
-
-  // BIT
-  set_op(Opcode::BIT_ABS, {.addressed_op = &CPU::op_bit, .mode = &CPU::absolute, .cycles = 4, .name = "BIT"});
-  set_op(Opcode::BIT_ZPG, {.addressed_op = &CPU::op_bit, .mode = &CPU::zero_page, .cycles = 3, .name = "BIT"});
-
-  // Increment/Decrement operations
-  // INC
-  set_op(Opcode::INC_ABS, {.addressed_op = &CPU::op_inc, .mode = &CPU::absolute, .cycles = 6, .name = "INC"});
-  set_op(Opcode::INC_ABX, {.addressed_op = &CPU::op_inc, .mode = &CPU::absolute_x, .cycles = 7, .name = "INC"});
-  set_op(Opcode::INC_ZPG, {.addressed_op = &CPU::op_inc, .mode = &CPU::zero_page, .cycles = 5, .name = "INC"});
-  set_op(Opcode::INC_ZPX, {.addressed_op = &CPU::op_inc, .mode = &CPU::zero_page_x, .cycles = 6, .name = "INC"});
-
-  // DEC
-  set_op(Opcode::DEC_ABS, {.addressed_op = &CPU::op_dec, .mode = &CPU::absolute, .cycles = 6, .name = "DEC"});
-  set_op(Opcode::DEC_ABX, {.addressed_op = &CPU::op_dec, .mode = &CPU::absolute_x, .cycles = 7, .name = "DEC"});
-  set_op(Opcode::DEC_ZPG, {.addressed_op = &CPU::op_dec, .mode = &CPU::zero_page, .cycles = 5, .name = "DEC"});
-  set_op(Opcode::DEC_ZPX, {.addressed_op = &CPU::op_dec, .mode = &CPU::zero_page_x, .cycles = 6, .name = "DEC"});
-
-  // INX, INY
-  set_op(Opcode::INX_IMP, {.implied_op = &CPU::op_inx, .mode = nullptr, .cycles = 2, .name = "INX", .is_implied = true});
-  set_op(Opcode::INY_IMP, {.implied_op = &CPU::op_iny, .mode = nullptr, .cycles = 2, .name = "INY", .is_implied = true});
-
-  // DEX, DEY
-  set_op(Opcode::DEX_IMP, {.implied_op = &CPU::op_dex, .mode = nullptr, .cycles = 2, .name = "DEX", .is_implied = true});
-  set_op(Opcode::DEY_IMP, {.implied_op = &CPU::op_dey, .mode = nullptr, .cycles = 2, .name = "DEY", .is_implied = true});
-
-  // Branching operations
-  // BCC
-  set_op(Opcode::BCC_REL, {.addressed_op = &CPU::op_bcc, .mode = &CPU::relative, .cycles = 2, .name = "BCC"});
-  set_op(Opcode::BCS_REL, {.addressed_op = &CPU::op_bcs, .mode = &CPU::relative, .cycles = 2, .name = "BCS"});
-  set_op(Opcode::BEQ_REL, {.addressed_op = &CPU::op_beq, .mode = &CPU::relative, .cycles = 2, .name = "BEQ"});
-  set_op(Opcode::BMI_REL, {.addressed_op = &CPU::op_bmi, .mode = &CPU::relative, .cycles = 2, .name = "BMI"});
-  set_op(Opcode::BPL_REL, {.addressed_op = &CPU::op_bpl, .mode = &CPU::relative, .cycles = 2, .name = "BPL"});
-  set_op(Opcode::BNE_REL, {.addressed_op = &CPU::op_bne, .mode = &CPU::relative, .cycles = 2, .name = "BNE"});
-  set_op(Opcode::BVC_REL, {.addressed_op = &CPU::op_bvc, .mode = &CPU::relative, .cycles = 2, .name = "BVC"});
-  set_op(Opcode::BVS_REL, {.addressed_op = &CPU::op_bvs, .mode = &CPU::relative, .cycles = 2, .name = "BVS"});
-
-  // Control-Flow operations
-  set_op(Opcode::JMP_ABS, {.addressed_op = &CPU::op_jmp, .mode = &CPU::absolute, .cycles = 3, .name = "JMP"});
-  set_op(Opcode::JMP_IND, {.addressed_op = &CPU::op_jmp, .mode = &CPU::absolute_indirect, .cycles = 5, .name = "JMP"});
-  set_op(Opcode::BRK_IMP, {.implied_op = &CPU::op_brk, .mode = nullptr, .cycles = 7, .name = "BRK", .is_implied = true});
-  set_op(Opcode::JSR_ABS, {.addressed_op = &CPU::op_jsr, .mode = &CPU::absolute, .cycles = 6, .name = "JSR"});
-  set_op(Opcode::RTI_IMP, {.implied_op = &CPU::op_rti, .mode = nullptr, .cycles = 6, .name = "RTI", .is_implied = true});
-  set_op(Opcode::RTS_IMP, {.implied_op = &CPU::op_rts, .mode = nullptr, .cycles = 6, .name = "RTS", .is_implied = true});
-
-  // Flags
-  set_op(Opcode::SEC_IMP, {.implied_op = &CPU::op_sec, .mode = nullptr, .cycles = 2, .name = "SEC", .is_implied = true});
-  set_op(Opcode::SED_IMP, {.implied_op = &CPU::op_sed, .mode = nullptr, .cycles = 2, .name = "SED", .is_implied = true});
-  set_op(Opcode::SEI_IMP, {.implied_op = &CPU::op_sei, .mode = nullptr, .cycles = 2, .name = "SEI", .is_implied = true});
-  set_op(Opcode::CLC_IMP, {.implied_op = &CPU::op_clc, .mode = nullptr, .cycles = 2, .name = "CLC", .is_implied = true});
-  set_op(Opcode::CLD_IMP, {.implied_op = &CPU::op_cld, .mode = nullptr, .cycles = 2, .name = "CLD", .is_implied = true});
-  set_op(Opcode::CLI_IMP, {.implied_op = &CPU::op_cli, .mode = nullptr, .cycles = 2, .name = "CLI", .is_implied = true});
-  set_op(Opcode::CLV_IMP, {.implied_op = &CPU::op_clv, .mode = nullptr, .cycles = 2, .name = "CLV", .is_implied = true});
-
-  // No operation
-  set_op(Opcode::NOP_IMP, {.implied_op = &CPU::op_nop, .mode = nullptr, .cycles = 2, .name = "NOP", .is_implied = true});
-}
-
-void CPU::clock() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::clock() {
   if (_cycles == 0) {
-    u8 opcode = read_byte(_PC++);
-    set_flag(Flag::UNUSED, true);
+    _cycles = execute_instruction();
+    if (_cycles == 0) return;  // Halted
+  }
+  _cycles--;
+}
 
-    const auto &instruction = _instruction_table[opcode];
-    if (instruction.cycles == 0) throw std::runtime_error("Unknown opcode: " + std::to_string(opcode));
+template <typename Memory, Variant Model>
+u8 BasicCPU<Memory, Model>::step_instruction() {
+  // An instruction already started by clock() only has its remaining cycles left to burn
+  if (_cycles > 0) {
+    u8 remaining = _cycles;
+    _cycles = 0;
+    return remaining;
+  }
 
-    _cycles = instruction.cycles;
+  return execute_instruction();
+}
 
-    if (instruction.is_implied) {
-      // Handle implied addressing operations
-      (this->*(instruction.implied_op))();
-    } else {
-      // Handle operations that require addressing
-      auto addr_mode = instruction.mode;
-      u16 addr = 0;
-      if (addr_mode != nullptr) {
-        addr = (this->*addr_mode)();
-
-        if (_page_crossed && instruction.is_extra_cycle) {
-          _cycles++;
-          _page_crossed = false;
-        }
+template <typename Memory, Variant Model>
+u64 BasicCPU<Memory, Model>::run(const u64 cycle_budget) {
+  // Loop state recorded by an earlier run() is stale, memory may have changed since
+  _idle_loop.seen = false;
+  _idle_loop_armed = _idle_loop_skip;
+
+  u64 elapsed = 0;
+  if (_block_cache) {
+    elapsed = run_blocks(cycle_budget);
+  } else {
+    while (elapsed < cycle_budget) {
+      if (_pending_signals & SIGNAL_IDLE_LOOP) {
+        elapsed = skip_idle_loop(elapsed, cycle_budget);
+        if (elapsed >= cycle_budget) break;
       }
+      const u8 cycles = step_instruction();
+      if (cycles == 0) break;
+      elapsed += cycles;
+    }
+  }
+
+  _idle_loop_armed = false;
+  _pending_signals &= ~SIGNAL_IDLE_LOOP;
+  return elapsed;
+}
 
-      (this->*(instruction.addressed_op))(addr);
+template <typename Memory, Variant Model>
+u64 BasicCPU<Memory, Model>::run_until(Scheduler &scheduler, const u64 target_cycle) {
+  const u64 start = scheduler.get_cycle();
+
+  scheduler.dispatch_due_events();
+  while (scheduler.get_cycle() < target_cycle && !is_halted()) {
+    // Nothing can happen before the next event, so run straight up to it
+    const u64 batch_end = std::min(target_cycle, scheduler.get_next_event_cycle());
+    scheduler.advance(run(batch_end - scheduler.get_cycle()));
+    scheduler.dispatch_due_events();
+  }
+
+  return scheduler.get_cycle() - start;
+}
+
+template <typename Memory, Variant Model>
+bool BasicCPU<Memory, Model>::set_block_cache_enabled(const bool enabled) {
+  if constexpr (TracksCodeWrites<Memory>::value) {
+    if (enabled && !_block_cache) {
+      _block_cache = std::make_unique<BlockCache>();
+      _bus.add_code_write_listener(_block_cache.get());
+    } else if (!enabled && _block_cache) {
+      _jit.reset();
+      _bus.remove_code_write_listener(_block_cache.get());
+      _block_cache.reset();
     }
   }
-  _cycles--;
+  return _block_cache != nullptr;
 }
 
-void CPU::reset() {
+template <typename Memory, Variant Model>
+bool BasicCPU<Memory, Model>::set_jit_enabled(const bool enabled) {
+  if (!enabled) {
+    // Blocks still point into the arena that is about to go away
+    if (_jit) _block_cache->clear();
+    _jit.reset();
+    return false;
+  }
+
+  if constexpr (JitCompiler::SUPPORTED) {
+    if (!_jit && set_block_cache_enabled(true)) {
+      _jit = std::make_unique<JitCompiler>();
+      if (!_jit->is_available()) _jit.reset();
+    }
+  }
+  return _jit != nullptr;
+}
+
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::set_branch_stats_enabled(const bool enabled) {
+  // Translated branches only count when stats were on as they were compiled
+  if (_jit && enabled != (_branch_stats != nullptr)) {
+    _block_cache->clear();
+    _jit->clear();
+  }
+  if (!enabled) {
+    _branch_stats.reset();
+  } else if (!_branch_stats) {
+    _branch_stats = std::make_unique<std::array<BranchStats, 0x10000>>();
+  }
+}
+
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::clear_branch_stats() {
+  if (_branch_stats) _branch_stats->fill({});
+}
+
+template <typename Memory, Variant Model>
+bool BasicCPU<Memory, Model>::set_idle_loop_skip_enabled(const bool enabled) {
+  if constexpr (ReportsReadSideEffects<Memory>::value) {
+    _idle_loop_skip = enabled;
+  }
+  if (!_idle_loop_skip) _pending_signals &= ~SIGNAL_IDLE_LOOP;
+  _idle_loop = {};
+  _idle_loop_rejected = NO_REJECTED_IDLE_LOOPS;
+  return _idle_loop_skip;
+}
+
+// Called at the head of a loop that was just closed by a short backward jump.
+// The first visit records the registers; when the next visit comes exactly one
+// iteration later with the same registers, every further iteration up to the
+// budget would repeat it, so they are accounted for without being run.
+template <typename Memory, Variant Model>
+u64 BasicCPU<Memory, Model>::skip_idle_loop(const u64 elapsed, const u64 cycle_budget) {
+  _pending_signals &= ~SIGNAL_IDLE_LOOP;
+
+  // An interrupt about to be taken ends the wait
+  if ((_pending_signals & SIGNAL_NMI) || ((_pending_signals & SIGNAL_IRQ) && !get_flag(Flag::INTERRUPT_DISABLE))) {
+    return elapsed;
+  }
+
+  // Only rejections are kept across visits, the code may have changed since it was accepted
+  if (_PC != _idle_loop.head || !_idle_loop.seen) {
+    _idle_loop = {};
+    _idle_loop.head = _PC;
+    _idle_loop.cycles = measure_idle_loop(_PC, _idle_loop.branch);
+  }
+  if (_idle_loop.cycles == 0) {
+    _idle_loop_rejected[_PC % IDLE_LOOP_REJECTED_SLOTS] = _PC;
+    return elapsed;
+  }
+
+  const u8 status = get_status();
+  const bool repeated = _idle_loop.seen && elapsed - _idle_loop.elapsed == _idle_loop.cycles && _idle_loop.a == _A &&
+                        _idle_loop.x == _X && _idle_loop.y == _Y && _idle_loop.sp == _SP && _idle_loop.status == status;
+
+  u64 now = elapsed;
+  if (repeated && measure_idle_loop(_PC, _idle_loop.branch) == _idle_loop.cycles) {
+    const u64 iterations = (cycle_budget - elapsed) / _idle_loop.cycles;
+    now += iterations * _idle_loop.cycles;
+    _idle_cycles_skipped += iterations * _idle_loop.cycles;
+    // Branches (BRA included) count their skipped iterations, JMP has no stats
+    u8 opcode = 0;
+    if (_branch_stats && peek_byte(_idle_loop.branch, opcode) && _decoded_table[opcode].mode == AddressingMode::REL) {
+      (*_branch_stats)[_idle_loop.branch].taken += iterations;
+    }
+  }
+
+  _idle_loop.seen = true;
+  _idle_loop.a = _A;
+  _idle_loop.x = _X;
+  _idle_loop.y = _Y;
+  _idle_loop.sp = _SP;
+  _idle_loop.status = status;
+  _idle_loop.elapsed = now;
+  return now;
+}
+
+// Walks the code from head and returns the cycles of one iteration if it is a
+// straight run of idle-safe instructions closed by a JMP or branch back to head,
+// reading nothing with side effects. Returns 0 for anything else.
+template <typename Memory, Variant Model>
+u8 BasicCPU<Memory, Model>::measure_idle_loop(const u16 head, u16 &branch) {
+  _idle_loop_checks++;
+  if constexpr (ReportsReadSideEffects<Memory>::value) {
+    u16 pc = head;
+    u8 cycles = 0;
+    for (u8 i = 0; i < IDLE_LOOP_MAX_INSTRUCTIONS; i++) {
+      // Code on a device page may read differently every time
+      u8 opcode = 0;
+      if (!peek_byte(pc, opcode)) return 0;
+      const AddressingMode mode = _decoded_table[opcode].mode;
+      const u8 length = 1 + operand_bytes(mode);
+      u8 low = 0;
+      u8 high = 0;
+      if (length > 1 && !peek_byte(pc + 1, low)) return 0;
+      if (length > 2 && !peek_byte(pc + 2, high)) return 0;
+      for (u16 address = pc; address != (u16)(pc + length); address++) {
+        if (_bus.has_read_side_effects(address)) return 0;
+      }
+
+      const u16 operand = low | (high << 8);
+      const u16 next = pc + length;
+      cycles += _instruction_table[opcode].cycles;
+
+      // The jump back closes the loop, anything else that leaves it disqualifies it
+      if (opcode == (u8)Opcode::JMP_ABS || mode == AddressingMode::REL) {
+        const u16 target = (mode == AddressingMode::REL) ? (u16)(next + static_cast<int8_t>(operand)) : operand;
+        if (target != head) return 0;
+        branch = pc;
+        if (mode == AddressingMode::REL) cycles += ((target ^ next) & 0xFF00) ? 2 : 1;
+        return cycles;
+      }
+
+      if (!is_idle_loop_safe(opcode)) return 0;
+      if ((mode == AddressingMode::ZPG || mode == AddressingMode::ABS) && _bus.has_read_side_effects(operand)) return 0;
+      pc = next;
+    }
+  }
+  return 0;
+}
+
+// Same contract as the interpreter loop in run(), but straight-line code is
+// executed from decoded blocks without fetching or decoding it again
+template <typename Memory, Variant Model>
+u64 BasicCPU<Memory, Model>::run_blocks(const u64 cycle_budget) {
+  // An instruction started by clock() is finished first
+  u64 elapsed = (_cycles > 0) ? step_instruction() : 0;
+  while (elapsed < cycle_budget) {
+    if (_pending_signals != 0) {
+      if (_pending_signals & SIGNAL_HALT) break;
+      if (_pending_signals & SIGNAL_IDLE_LOOP) {
+        elapsed = skip_idle_loop(elapsed, cycle_budget);
+        if (elapsed >= cycle_budget) break;
+      }
+      if (u8 cycles = service_interrupt()) {
+        elapsed += cycles;
+        continue;
+      }
+    }
+
+    DecodedBlock *block = _block_cache->find(_PC);
+    if (block == nullptr) block = decode_block(_PC);
+
+    // Nothing decodable here, the interpreter applies the fault policy
+    if (block == nullptr) {
+      const u8 cycles = step_instruction();
+      if (cycles == 0) break;
+      elapsed += cycles;
+      continue;
+    }
+
+    if (block->native != nullptr) {
+      elapsed = block->native(this, elapsed, cycle_budget, _block_cache->get_generation_address());
+      if (_pending_signals & SIGNAL_EXCEPTION) {
+        _pending_signals &= ~SIGNAL_EXCEPTION;
+        std::rethrow_exception(std::exchange(_jit_exception, nullptr));
+      }
+      continue;
+    }
+
+    // Translating may flush the cache, so look the block up again afterwards
+    if (_jit && ++block->executions > JIT_HOT_THRESHOLD && compile_block(*block)) continue;
+
+    const u32 generation = _block_cache->get_generation();
+    const DecodedInstruction *instruction = block->instructions.data();
+    const DecodedInstruction *const last = instruction + block->instructions.size();
+    while (instruction != last) {
+      set_flag(Flag::UNUSED, true);
+
+      // A pair runs as one step unless the budget could run out after its first
+      // instruction, which may take one more cycle for crossing a page. Nothing in
+      // a pair writes code before its last instruction, and the handler stops
+      // after the first one if that raised a signal.
+      if (instruction->pair != 0 && elapsed + instruction->cycles + 1 < cycle_budget) {
+        _PC += instruction->length;
+        _cycles = instruction->cycles;
+        if (_pair_table[instruction->pair].handler(*this, *instruction, instruction[1])) instruction++;
+      } else {
+        _PC += instruction->length;
+        _cycles = instruction->cycles;
+        latch_fetched(instruction->fetched);
+        _decoded_table[instruction->opcode].handler(*this, instruction->operand);
+      }
+      elapsed += _cycles;
+      _cycles = 0;
+
+      // Stop if the budget ran out, the instruction wrote over cached code (possibly
+      // this block) or an interrupt needs looking at. A masked IRQ keeps the
+      // pending byte set, so blocks only run one instruction at a time until it is acknowledged.
+      if (elapsed >= cycle_budget || _block_cache->get_generation() != generation || _pending_signals != 0) break;
+      instruction++;
+    }
+  }
+  return elapsed;
+}
+
+template <typename Memory, Variant Model>
+bool BasicCPU<Memory, Model>::compile_block(DecodedBlock &block) {
+  const u8 *base = reinterpret_cast<const u8 *>(this);
+  const JitLayout layout = {.pc_offset = (size_t)(reinterpret_cast<const u8 *>(&_PC) - base),
+                            .status_offset = (size_t)(reinterpret_cast<const u8 *>(&_status) - base),
+                            .cycles_offset = (size_t)(reinterpret_cast<const u8 *>(&_cycles) - base),
+                            .pending_signals_offset = (size_t)(reinterpret_cast<const u8 *>(&_pending_signals) - base),
+                            .register_offsets = {(size_t)(reinterpret_cast<const u8 *>(&_A) - base),
+                                                 (size_t)(reinterpret_cast<const u8 *>(&_X) - base),
+                                                 (size_t)(reinterpret_cast<const u8 *>(&_Y) - base),
+                                                 (size_t)(reinterpret_cast<const u8 *>(&_SP) - base)},
+                            .idle_loop_armed_offset = (size_t)(reinterpret_cast<const u8 *>(&_idle_loop_armed) - base),
+                            .idle_loop_rejected_offset = (size_t)(reinterpret_cast<const u8 *>(_idle_loop_rejected.data()) - base),
+                            .idle_loop_rejected_slots = IDLE_LOOP_REJECTED_SLOTS,
+                            .idle_loop_max_bytes = IDLE_LOOP_MAX_BYTES,
+                            .idle_loop_signal = SIGNAL_IDLE_LOOP};
+
+  JitMemory memory;
+  if constexpr (ExposesPageTables<Memory>::value) {
+    const auto tables = _bus.get_page_tables();
+    memory = {.read_pages = tables.read,
+              .write_pages = tables.write,
+              .code_pages = tables.code,
+              .dirty_pages = tables.dirty,
+              .open_bus = tables.open_bus};
+  }
+
+  std::vector<JitInstruction> instructions;
+  instructions.reserve(block.instructions.size());
+  u16 address = block.start;
+  for (const DecodedInstruction &instruction : block.instructions) {
+    JitInstruction translated = {.handler = _jit_entries[instruction.opcode],
+                                 .address = address,
+                                 .operand = instruction.operand,
+                                 .length = instruction.length,
+                                 .cycles = instruction.cycles,
+                                 .fetched = instruction.fetched,
+                                 .extra_cycle = (_instruction_table[instruction.opcode].flags & Instruction::EXTRA_CYCLE) != 0};
+    describe_for_jit(translated, instruction.opcode);
+
+    // Inline code keeps N, Z, C and V in _status, and does not count branches
+    const bool touches_flags = translated.operation != JitOperation::STORE && translated.operation != JitOperation::JUMP &&
+                               translated.reg != JitRegister::SP;
+    if ((LAZY_FLAGS && touches_flags) || (_branch_stats && translated.operation == JitOperation::BRANCH)) {
+      translated.operation = JitOperation::CALL;
+    }
+    instructions.push_back(translated);
+    address += instruction.length;
+  }
+
+  block.native = _jit->compile(layout, memory, instructions.data(), instructions.size());
+  if (block.native != nullptr) return true;
+
+  // Nothing else is taking up the arena, so this block will never fit: stop
+  // translating rather than flushing the cache over and over
+  if (_jit->is_empty()) {
+    _jit.reset();
+    return false;
+  }
+
+  // Arena is full: start over and let whatever is still hot be translated again
+  _block_cache->clear();
+  _jit->clear();
+  return true;
+}
+
+template <typename Memory, Variant Model>
+bool BasicCPU<Memory, Model>::peek_byte(const u16 address, u8 &value) const {
+  if constexpr (PeeksMemory<Memory>::value) {
+    return _bus.peek(address, value);
+  } else {
+    value = _bus.read(address);
+    return true;
+  }
+}
+
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::latch_fetched(const u8 value) {
+  if constexpr (HasOpenBus<Memory>::value) _bus.set_open_bus(value);
+}
+
+template <typename Memory, Variant Model>
+DecodedBlock *BasicCPU<Memory, Model>::decode_block(const u16 pc) {
+  auto block = std::make_unique<DecodedBlock>();
+  block->start = pc;
+
+  u16 addr = pc;
+  while (block->instructions.size() < BlockCache::MAX_BLOCK_INSTRUCTIONS) {
+    // Code only a device can supply is left to the interpreter, like unknown opcodes
+    u8 opcode = 0;
+    if (!peek_byte(addr, opcode)) break;
+    const Instruction &instruction = _instruction_table[opcode];
+    if (instruction.cycles == 0) break;
+
+    const DecodedOperation &decoded = _decoded_table[opcode];
+    const u8 length = 1 + operand_bytes(decoded.mode);
+    u16 operand = addr + 1;
+    u8 fetched = opcode;
+    if (decoded.mode != AddressingMode::IMM && length > 1) {
+      u8 low = 0;
+      u8 high = 0;
+      if (!peek_byte(addr + 1, low) || (length == 3 && !peek_byte(addr + 2, high))) break;
+      operand = low | (high << 8);
+      fetched = (length == 3) ? high : low;
+    }
+
+    block->instructions.push_back(
+        {.operand = operand, .opcode = opcode, .length = length, .cycles = instruction.cycles, .fetched = fetched});
+    addr += length;
+    if (decoded.ends_block) break;
+  }
+
+  if (block->instructions.empty()) return nullptr;
+  block->end = addr;
+
+  for (size_t i = 0; i + 1 < block->instructions.size(); i++) {
+    DecodedInstruction &first = block->instructions[i];
+    first.pair = find_pair(first.opcode, block->instructions[i + 1].opcode);
+    if (first.pair != 0) i++;  // Pairs never overlap
+  }
+
+  // Writes to any page the block came from must reach the cache
+  if constexpr (TracksCodeWrites<Memory>::value) {
+    const u8 last_page = (u16)(block->end - 1) >> 8;
+    for (u8 page = block->start >> 8;; page++) {
+      _bus.mark_code_page(page);
+      if (page == last_page) break;
+    }
+  }
+
+  return _block_cache->insert(std::move(block));
+}
+
+template <typename Memory, Variant Model>
+template <AddressingMode Mode, void (BasicCPU<Memory, Model>::*Operation)(u16), bool ExtraCycle>
+void BasicCPU<Memory, Model>::execute_addressed(BasicCPU &cpu) {
+  execute_decoded<Mode, Operation, ExtraCycle>(cpu, cpu.fetch_operand<Mode>());
+}
+
+template <typename Memory, Variant Model>
+template <void (BasicCPU<Memory, Model>::*Operation)()>
+void BasicCPU<Memory, Model>::execute_implied(BasicCPU &cpu) {
+  (cpu.*Operation)();
+}
+
+template <typename Memory, Variant Model>
+template <AddressingMode Mode, void (BasicCPU<Memory, Model>::*Operation)(u16), bool ExtraCycle>
+void BasicCPU<Memory, Model>::execute_decoded(BasicCPU &cpu, const u16 operand) {
+  (cpu.*Operation)(cpu.resolve_and_charge<Mode, ExtraCycle>(operand));
+}
+
+template <typename Memory, Variant Model>
+template <void (BasicCPU<Memory, Model>::*Operation)()>
+void BasicCPU<Memory, Model>::execute_decoded_implied(BasicCPU &cpu, const u16 /*operand*/) {
+  (cpu.*Operation)();
+}
+
+// Both instructions' bus accesses happen in the order they would one after the
+// other, each after its skipped fetch is put on the data bus (a fetch followed by
+// no access only matters for the second). The PC is already past the first
+// instruction and _cycles holds its base count, the second is accounted for here.
+// A signal raised by the first one's bus access ends the pair early, so an
+// interrupt is taken before the second instruction just as between two steps.
+template <typename Memory, Variant Model>
+template <typename BasicCPU<Memory, Model>::Pairing Kind, u8 First, u8 Second>
+bool BasicCPU<Memory, Model>::execute_pair(BasicCPU &cpu, const DecodedInstruction &first, const DecodedInstruction &second) {
+  constexpr AddressingMode FIRST_MODE = _decoded_table[First].mode;
+  constexpr AddressingMode SECOND_MODE = _decoded_table[Second].mode;
+  constexpr bool FIRST_EXTRA_CYCLE = _instruction_table[First].flags & Instruction::EXTRA_CYCLE;
+  constexpr bool SECOND_EXTRA_CYCLE = _instruction_table[Second].flags & Instruction::EXTRA_CYCLE;
+  constexpr bool FIRST_READS = Kind == Pairing::LOAD_STORE || Kind == Pairing::COMPARE_BRANCH;
+
+  // First instruction. CLC and SEC are left to the second, which only needs them as its carry in.
+  u8 value = 0;
+  if constexpr (Kind == Pairing::LOAD_STORE) {
+    cpu.latch_fetched(first.fetched);
+    cpu._A = cpu.read_byte(cpu.resolve_and_charge<FIRST_MODE, FIRST_EXTRA_CYCLE>(first.operand));
+    cpu.update_zero_and_negative_flags(cpu._A);
+  } else if constexpr (Kind == Pairing::INCREMENT_COMPARE) {
+    // The compare overwrites every flag INY sets
+    cpu._Y++;
+  } else if constexpr (Kind == Pairing::DECREMENT_BRANCH) {
+    cpu._X--;
+    cpu.update_zero_and_negative_flags(cpu._X);
+  } else if constexpr (Kind == Pairing::COMPARE_BRANCH) {
+    cpu.latch_fetched(first.fetched);
+    value = cpu.read_byte(cpu.resolve_and_charge<FIRST_MODE, FIRST_EXTRA_CYCLE>(first.operand));
+    cpu.compare(cpu._A, value);
+  }
+
+  if constexpr (FIRST_READS) {
+    if (cpu._pending_signals != 0) return false;
+  }
+  cpu._PC += second.length;
+  cpu._cycles += second.cycles;
+
+  // Second instruction
+  cpu.latch_fetched(second.fetched);
+  if constexpr (Kind == Pairing::LOAD_STORE) {
+    cpu.write_byte(cpu.resolve_and_charge<SECOND_MODE, SECOND_EXTRA_CYCLE>(second.operand), cpu._A);
+  } else if constexpr (Kind == Pairing::CLEAR_ADD) {
+    cpu.add_with_carry(cpu.read_byte(cpu.resolve_and_charge<SECOND_MODE, SECOND_EXTRA_CYCLE>(second.operand)), false);
+  } else if constexpr (Kind == Pairing::SET_SUBTRACT) {
+    cpu.subtract_with_borrow(cpu.read_byte(cpu.resolve_and_charge<SECOND_MODE, SECOND_EXTRA_CYCLE>(second.operand)), true);
+  } else if constexpr (Kind == Pairing::INCREMENT_COMPARE) {
+    cpu.compare(cpu._Y, cpu.read_byte(cpu.resolve_and_charge<SECOND_MODE, SECOND_EXTRA_CYCLE>(second.operand)));
+  } else if constexpr (Kind == Pairing::DECREMENT_BRANCH) {
+    cpu.branch(cpu._X != 0, second.operand);
+  } else if constexpr (Kind == Pairing::COMPARE_BRANCH) {
+    cpu.branch(cpu._A == value, second.operand);
+  }
+  return true;
+}
+
+#ifdef CPU_SWITCH_DISPATCH
+
+// Every opcode gets its own case calling its fused handler directly,
+// so the compiler can inline the whole instruction instead of calling through the table
+template <typename Memory, Variant Model>
+u8 BasicCPU<Memory, Model>::execute_instruction() {
+  if (_pending_signals != 0) {
+    if (_pending_signals & SIGNAL_HALT) return 0;
+    if (u8 cycles = service_interrupt()) return cycles;
+  }
+
+  u8 opcode = read_byte(_PC++);
+  set_flag(Flag::UNUSED, true);
+
+  switch (opcode) {
+#define ADDRESSED(opcode_, mnemonic_, operation_, mode_, cycles_, extra_cycle_)                \
+  case (u8)Opcode::opcode_:                                                                   \
+    _cycles = cycles_;                                                                        \
+    execute_addressed<AddressingMode::mode_, &BasicCPU::operation_, extra_cycle_>(*this);         \
+    break;
+#define IMPLIED(opcode_, mnemonic_, operation_, mode_, cycles_) \
+  case (u8)Opcode::opcode_:                                    \
+    _cycles = cycles_;                                         \
+    execute_implied<&BasicCPU::operation_>(*this);                  \
+    break;
+#include "opcodes.def"
+    default:
+      // Opcodes that differ between variants, picked at compile time
+      if constexpr (Model == Variant::CMOS_65C02) {
+        switch (opcode) {
+#include "opcodes_65c02.def"
+          default:
+            return handle_unknown_opcode(opcode);
+        }
+      } else {
+        switch (opcode) {
+#include "opcodes_nmos.def"
+          default:
+            return handle_unknown_opcode(opcode);
+        }
+      }
+  }
+#undef ADDRESSED
+#undef IMPLIED
+
+  u8 cycles = _cycles;
+  _cycles = 0;
+  return cycles;
+}
+
+#else
+
+template <typename Memory, Variant Model>
+u8 BasicCPU<Memory, Model>::execute_instruction() {
+  if (_pending_signals != 0) {
+    if (_pending_signals & SIGNAL_HALT) return 0;
+    if (u8 cycles = service_interrupt()) return cycles;
+  }
+
+  u8 opcode = read_byte(_PC++);
+  set_flag(Flag::UNUSED, true);
+
+  const auto &instruction = _instruction_table[opcode];
+  if (instruction.cycles == 0) return handle_unknown_opcode(opcode);
+
+  // Handlers add their own penalties (e.g. taken branches) on top of the base cycles
+  _cycles = instruction.cycles;
+  instruction.handler(*this);
+
+  u8 cycles = _cycles;
+  _cycles = 0;
+  return cycles;
+}
+
+#endif  // CPU_SWITCH_DISPATCH
+
+template <typename Memory, Variant Model>
+u8 BasicCPU<Memory, Model>::service_interrupt() {
+  // Only run() acts on a closed loop, everywhere else the hint is dropped
+  _pending_signals &= ~SIGNAL_IDLE_LOOP;
+
+  u16 vector;
+  if (_pending_signals & SIGNAL_NMI) {
+    _pending_signals &= ~SIGNAL_NMI;
+    vector = 0xFFFA;
+  } else if ((_pending_signals & SIGNAL_IRQ) && !get_flag(Flag::INTERRUPT_DISABLE)) {
+    // The IRQ line stays active until the device acknowledges it
+    vector = 0xFFFE;
+  } else {
+    return 0;
+  }
+
+  // Same sequence as BRK, but the current PC is pushed and B is clear in the pushed status
+  write_byte(0x0100 + _SP, (_PC >> 8) & 0xFF);
+  _SP--;
+  write_byte(0x0100 + _SP, _PC & 0xFF);
+  _SP--;
+  write_byte(0x0100 + _SP, (get_status() & ~(u8)Flag::BREAK) | (u8)Flag::UNUSED);
+  _SP--;
+  set_flag(Flag::INTERRUPT_DISABLE, true);
+  if constexpr (Model == Variant::CMOS_65C02) set_flag(Flag::DECIMAL, false);
+
+  u16 pcl = read_byte(vector);
+  u16 pch = read_byte(vector + 1);
+  _PC = (pch << 8) | pcl;
+  return 7;
+}
+
+// Kept out of execute_instruction() so the throwing path stays off the hot loop
+template <typename Memory, Variant Model>
+u8 BasicCPU<Memory, Model>::handle_unknown_opcode(const u8 opcode) {
+  switch (_fault_policy) {
+    case FaultPolicy::NOP:
+      return 2;
+    case FaultPolicy::THROW:
+      throw std::runtime_error("Unknown opcode: " + std::to_string(opcode));
+    case FaultPolicy::HOOK:
+      _PC--;
+      if (_fault_hook) {
+        if (u8 cycles = _fault_hook(*this, opcode)) return cycles;
+      }
+      break;
+    case FaultPolicy::HALT:
+      _PC--;
+      break;
+  }
+
+  // Halt with the PC left on the faulting opcode
+  _fault = Fault::UNKNOWN_OPCODE;
+  _fault_opcode = opcode;
+  _pending_signals |= SIGNAL_HALT;
+  return 0;
+}
+
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::clear_fault() {
+  _fault = Fault::NONE;
+  _fault_opcode = 0;
+  _pending_signals &= ~SIGNAL_HALT;
+}
+
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::set_nmi_line(const bool active) {
+  if (active && !_nmi_line) _pending_signals |= SIGNAL_NMI;
+  _nmi_line = active;
+}
+
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::set_irq_line(const bool active) {
+  if (active) {
+    _pending_signals |= SIGNAL_IRQ;
+  } else {
+    _pending_signals &= ~SIGNAL_IRQ;
+  }
+}
+
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::reset() {
   _A = 0;
   _X = 0;
   _Y = 0;
   _SP = 0xFF;
-  _status = (u8)Flag::UNUSED | (u8)Flag::BREAK;
+  set_status((u8)Flag::UNUSED | (u8)Flag::BREAK);
   _cycles = 0;
   _PC = 0xFFFC;
   _page_crossed = false;
+
+  // A latched NMI is lost, the lines themselves belong to the devices driving them
+  _pending_signals &= ~(SIGNAL_NMI | SIGNAL_IDLE_LOOP);
+  clear_fault();
 }
 
-// Memory operations
-u8 CPU::read_byte(const u16 address) { return _bus.read(address); }
+template <typename Memory, Variant Model>
+const InstructionInfo &BasicCPU<Memory, Model>::get_instruction_info(const u8 opcode) {
+  return INSTRUCTION_INFO<Model>[opcode];
+}
 
-void CPU::write_byte(const u16 address, const u8 value) { _bus.write(address, value); }
+// Flag operations
+template <typename Memory, Variant Model>
+u8 BasicCPU<Memory, Model>::get_status() const {
+  if constexpr (LAZY_FLAGS) {
+    constexpr u8 lazy_flags = (u8)Flag::NEGATIVE | (u8)Flag::OVERFLOW_ | (u8)Flag::ZERO | (u8)Flag::CARRY;
+    u8 status = _status & ~lazy_flags;
+    status |= get_flag(Flag::NEGATIVE) ? (u8)Flag::NEGATIVE : 0;
+    status |= get_flag(Flag::OVERFLOW_) ? (u8)Flag::OVERFLOW_ : 0;
+    status |= get_flag(Flag::ZERO) ? (u8)Flag::ZERO : 0;
+    status |= get_flag(Flag::CARRY) ? (u8)Flag::CARRY : 0;
+    return status;
+  }
+  return _status;
+}
 
-// Getters
-u8 CPU::get_accumulator() const { return _A; }
-u8 CPU::get_x() const { return _X; }
-u8 CPU::get_y() const { return _Y; }
-u16 CPU::get_pc() const { return _PC; }
-u8 CPU::get_sp() const { return _SP; }
-u8 CPU::get_status() const { return _status; }
-u8 CPU::get_remaining_cycles() const { return _cycles; }
-Instruction CPU::get_instruction(const Opcode opcode) const { return _instruction_table[(u8)opcode]; }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::set_status(const u8 status) {
+  _status = status;
 
-// Setters
-void CPU::set_sp(const u8 sp) { _SP = sp; }
-void CPU::set_pc(const u16 pc) { _PC = pc; }
-void CPU::set_status(const u8 status) { _status = status; }
+  if constexpr (LAZY_FLAGS) {
+    set_flag(Flag::NEGATIVE, (status & (u8)Flag::NEGATIVE) != 0);
+    set_flag(Flag::OVERFLOW_, (status & (u8)Flag::OVERFLOW_) != 0);
+    set_flag(Flag::ZERO, (status & (u8)Flag::ZERO) != 0);
+    set_flag(Flag::CARRY, (status & (u8)Flag::CARRY) != 0);
+  }
+}
 
-// Flag operations
-bool CPU::get_flag(Flag flag) const { return (_status & (u8)(flag)) != 0; }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::set_flag(const Flag flag, const bool value) {
+  if constexpr (LAZY_FLAGS) {
+    switch (flag) {
+      case Flag::NEGATIVE:
+        _negative_result = value ? 0x80 : 0x00;
+        return;
+      case Flag::ZERO:
+        _zero_result = value ? 0x00 : 0x01;
+        return;
+      case Flag::CARRY:
+        _carry = value;
+        return;
+      case Flag::OVERFLOW_:
+        // lhs = rhs = 0 makes V follow bit 7 of the result
+        _overflow_lhs = 0;
+        _overflow_rhs = 0;
+        _overflow_result = value ? 0x80 : 0x00;
+        return;
+      default:
+        break;
+    }
+  }
 
-void CPU::set_flag(const Flag flag, const bool value) {
   if (value) {
     _status |= (u8)(flag);
   } else {
@@ -300,64 +1113,259 @@ void CPU::set_flag(const Flag flag, const bool value) {
   }
 }
 
-void CPU::update_zero_and_negative_flags(u8 value) {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::update_zero_and_negative_flags(u8 value) {
+  if constexpr (LAZY_FLAGS) {
+    _negative_result = value;
+    _zero_result = value;
+    return;
+  }
+
   set_flag(Flag::ZERO, value == 0);
   set_flag(Flag::NEGATIVE, (value & 0x80) != 0);
 }
 
+// V is set when lhs and rhs share a sign that the result does not (rhs is already inverted for SBC)
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::update_overflow_flag(const u8 lhs, const u8 rhs, const u8 result) {
+  if constexpr (LAZY_FLAGS) {
+    _overflow_lhs = lhs;
+    _overflow_rhs = rhs;
+    _overflow_result = result;
+    return;
+  }
+
+  set_flag(Flag::OVERFLOW_, ((lhs ^ result) & (rhs ^ result) & 0x80) != 0);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// ALU
+//////////////////////////////////////////////////////////////////////////
+
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::add_with_carry(const u8 value, const bool carry) {
+  if constexpr (HAS_DECIMAL_MODE) {
+    if (get_flag(Flag::DECIMAL)) return add_decimal(value, carry);
+  }
+
+  u16 sum = (u16)_A + value + carry;
+
+  set_flag(Flag::CARRY, sum > 0xFF);
+  update_overflow_flag(_A, value, sum);
+  _A = sum;
+  update_zero_and_negative_flags(_A);
+}
+
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::subtract_with_borrow(const u8 value, const bool carry) {
+  if constexpr (HAS_DECIMAL_MODE) {
+    if (get_flag(Flag::DECIMAL)) return subtract_decimal(value, carry);
+  }
+
+  u16 sub = (u16)_A - value - (1 - (u16)carry);
+
+  set_flag(Flag::CARRY, !(sub & 0x100));
+
+  // overflow is set when operands have different signs and result sign != A sign,
+  // which is the ADC rule applied to the inverted operand
+  update_overflow_flag(_A, ~value, sub);
+
+  _A = (u8)sub;
+  update_zero_and_negative_flags(_A);
+}
+
+// BCD addition, nibble by nibble. The NMOS 6502 takes N and V from the sum before
+// the high nibble is adjusted and Z from the binary sum; the 65C02 fixes N and Z
+// and spends one more cycle on it.
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::add_decimal(const u8 value, const bool carry) {
+  const u8 binary = _A + value + carry;
+
+  u16 low = (_A & 0x0F) + (value & 0x0F) + carry;
+  if (low >= 0x0A) low = ((low + 0x06) & 0x0F) + 0x10;
+  u16 sum = (_A & 0xF0) + (value & 0xF0) + low;
+
+  update_overflow_flag(_A, value, sum);
+  update_zero_and_negative_flags(sum);
+  if (sum >= 0xA0) sum += 0x60;
+  set_flag(Flag::CARRY, sum > 0xFF);
+  _A = sum;
+
+  if constexpr (Model == Variant::CMOS_65C02) {
+    update_zero_and_negative_flags(_A);
+    _cycles++;
+  } else {
+    set_flag(Flag::ZERO, binary == 0);
+  }
+}
+
+// BCD subtraction. C and V come from the binary difference on both chips;
+// the NMOS 6502 also leaves N and Z from it, the 65C02 sets them from the result.
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::subtract_decimal(const u8 value, const bool carry) {
+  const u8 borrow = !carry;
+  const u16 binary = (u16)_A - value - borrow;
+
+  set_flag(Flag::CARRY, !(binary & 0x100));
+  update_overflow_flag(_A, ~value, binary);
+
+  const int low = (_A & 0x0F) - (value & 0x0F) - borrow;
+  if constexpr (Model == Variant::CMOS_65C02) {
+    int difference = (int)_A - value - borrow;
+    if (difference < 0) difference -= 0x60;
+    if (low < 0) difference -= 0x06;
+    _A = difference;
+    update_zero_and_negative_flags(_A);
+    _cycles++;
+  } else {
+    const int adjusted_low = (low < 0) ? ((low - 0x06) & 0x0F) - 0x10 : low;
+    int difference = (_A & 0xF0) - (value & 0xF0) + adjusted_low;
+    if (difference < 0) difference -= 0x60;
+    _A = difference;
+    update_zero_and_negative_flags(binary);
+  }
+}
+
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::compare(const u8 reg, const u8 value) {
+  u16 sub = (u16)reg - value;
+
+  set_flag(Flag::CARRY, sub <= reg);
+  update_zero_and_negative_flags(sub);
+}
+
+template <typename Memory, Variant Model>
+u8 BasicCPU<Memory, Model>::shift_left(const u8 value) {
+  set_flag(Flag::CARRY, (value & 0x80) != 0);
+  u8 result = value << 1;
+  update_zero_and_negative_flags(result);
+  return result;
+}
+
+template <typename Memory, Variant Model>
+u8 BasicCPU<Memory, Model>::shift_right(const u8 value) {
+  set_flag(Flag::CARRY, (value & 0x01) != 0);
+  u8 result = value >> 1;
+  update_zero_and_negative_flags(result);  // N always ends up clear
+  return result;
+}
+
+template <typename Memory, Variant Model>
+u8 BasicCPU<Memory, Model>::rotate_left(const u8 value) {
+  // Put the old carry flag into bit 0
+  u8 result = (value << 1) | (get_flag(Flag::CARRY) ? 0x01 : 0x00);
+  set_flag(Flag::CARRY, (value & 0x80) != 0);
+  update_zero_and_negative_flags(result);
+  return result;
+}
+
+template <typename Memory, Variant Model>
+u8 BasicCPU<Memory, Model>::rotate_right(const u8 value) {
+  // Put the old carry flag into bit 7
+  u8 result = (value >> 1) | (get_flag(Flag::CARRY) ? 0x80 : 0x00);
+  set_flag(Flag::CARRY, (value & 0x01) != 0);
+  update_zero_and_negative_flags(result);
+  return result;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // ADDRESSING MODES
 //////////////////////////////////////////////////////////////////////////
 
-u16 CPU::immediate() {
-  return _PC++;  // Return the PC then increment it
+template <typename Memory, Variant Model>
+template <AddressingMode Mode>
+u16 BasicCPU<Memory, Model>::fetch_address() {
+  return resolve_address<Mode>(fetch_operand<Mode>());
 }
 
-u16 CPU::zero_page() {
-  return read_byte(_PC++);  // Zero page address is just a single byte
+// Reads the operand bytes following the opcode. Immediate mode has nothing to
+// read ahead of time, its operand is the address of the value itself.
+template <typename Memory, Variant Model>
+template <AddressingMode Mode>
+u16 BasicCPU<Memory, Model>::fetch_operand() {
+  if constexpr (Mode == AddressingMode::IMM) {
+    return _PC++;  // Return the PC then increment it
+  } else if constexpr (operand_bytes(Mode) == 1) {
+    return read_byte(_PC++);
+  } else {
+    u16 addr_low = read_byte(_PC++);
+    u16 addr_high = read_byte(_PC++);
+    return (addr_high << 8) | addr_low;
+  }
 }
 
-u16 CPU::zero_page_x() {
-  u8 zp_addr = read_byte(_PC++);
-  return (u16)((zp_addr + _X) & 0xFF);  // Wrap around in zero page
+template <typename Memory, Variant Model>
+template <AddressingMode Mode>
+u16 BasicCPU<Memory, Model>::resolve_address(const u16 operand) {
+  if constexpr (Mode == AddressingMode::IMM) return operand;
+  if constexpr (Mode == AddressingMode::ZPG) return operand;  // Zero page address is just a single byte
+  if constexpr (Mode == AddressingMode::ZPX) return zero_page_x(operand);
+  if constexpr (Mode == AddressingMode::ZPY) return zero_page_y(operand);
+  if constexpr (Mode == AddressingMode::ABS) return operand;
+  if constexpr (Mode == AddressingMode::ABX) return absolute_x(operand);
+  if constexpr (Mode == AddressingMode::ABY) return absolute_y(operand);
+  if constexpr (Mode == AddressingMode::IND) return absolute_indirect(operand);
+  if constexpr (Mode == AddressingMode::IZX) return indirect_x(operand);
+  if constexpr (Mode == AddressingMode::IZY) return indirect_y(operand);
+  if constexpr (Mode == AddressingMode::REL) return operand;  // Signed offset, applied by the branch
+  if constexpr (Mode == AddressingMode::ZPI) return zero_page_indirect(operand);
+  if constexpr (Mode == AddressingMode::AIX) return absolute_indexed_indirect(operand);
+}
+
+// Resolves an operand and charges the page-cross cycle for operations that pay it
+template <typename Memory, Variant Model>
+template <AddressingMode Mode, bool ExtraCycle>
+u16 BasicCPU<Memory, Model>::resolve_and_charge(const u16 operand) {
+  u16 addr = resolve_address<Mode>(operand);
+
+  if (ExtraCycle && _page_crossed) {
+    _cycles++;
+    _page_crossed = false;
+  }
+  return addr;
 }
 
-u16 CPU::zero_page_y() {
-  u8 zp_addr = read_byte(_PC++);
-  return (u16)((zp_addr + _Y) & 0xFF);  // Wrap around in zero page
+template <typename Memory, Variant Model>
+u16 BasicCPU<Memory, Model>::zero_page_x(const u16 operand) {
+  return (u16)((operand + _X) & 0xFF);  // Wrap around in zero page
 }
 
-u16 CPU::absolute() {
-  u16 addr_low = read_byte(_PC++);
-  u16 addr_high = read_byte(_PC++);
-  return (addr_high << 8) | addr_low;
+template <typename Memory, Variant Model>
+u16 BasicCPU<Memory, Model>::zero_page_y(const u16 operand) {
+  return (u16)((operand + _Y) & 0xFF);  // Wrap around in zero page
 }
 
-u16 CPU::absolute_x() {
-  u16 addr_low = read_byte(_PC++);
-  u16 addr_high = read_byte(_PC++);
-  u16 base_addr = (addr_high << 8) | addr_low;
-  u16 final_addr = base_addr + _X;
+template <typename Memory, Variant Model>
+u16 BasicCPU<Memory, Model>::absolute_x(const u16 operand) {
+  u16 final_addr = operand + _X;
 
-  _page_crossed = ((base_addr & 0xFF00) != (final_addr & 0xFF00));
+  _page_crossed = ((operand & 0xFF00) != (final_addr & 0xFF00));
   return final_addr;
 }
 
-u16 CPU::absolute_indirect() {
-  // Read the 16-bit address from the two bytes following the opcode
-  u16 addr_low = read_byte(_PC++);
-  u16 addr_high = read_byte(_PC++);
-  u16 indirect_addr = (addr_high << 8) | addr_low;
+template <typename Memory, Variant Model>
+u16 BasicCPU<Memory, Model>::absolute_y(const u16 operand) {
+  u16 final_addr = operand + _Y;
 
+  _page_crossed = ((operand & 0xFF00) != (final_addr & 0xFF00));
+  return final_addr;
+}
+
+template <typename Memory, Variant Model>
+u16 BasicCPU<Memory, Model>::absolute_indirect(const u16 operand) {
   // Read the effective address from the indirect address
-  u16 effective_addr_low = read_byte(indirect_addr);
+  u16 effective_addr_low = read_byte(operand);
   u16 effective_addr_high;
 
-  // Check if the indirect address is at the page boundary
-  if ((indirect_addr & 0x00FF) == 0x00FF) {
-    effective_addr_high = read_byte(indirect_addr & 0xFF00);
+  // Check if the indirect address is at the page boundary. The NMOS chips wrap
+  // within the page; the 65C02 reads across it and spends a cycle doing so.
+  if constexpr (Model == Variant::CMOS_65C02) {
+    effective_addr_high = read_byte(operand + 1);
+    _cycles++;
+  } else if ((operand & 0x00FF) == 0x00FF) {
+    effective_addr_high = read_byte(operand & 0xFF00);
   } else {
-    effective_addr_high = read_byte(indirect_addr + 1);
+    effective_addr_high = read_byte(operand + 1);
   }
 
   // Combine the low and high bytes of the effective address
@@ -365,19 +1373,9 @@ u16 CPU::absolute_indirect() {
   return effective_addr;
 }
 
-u16 CPU::absolute_y() {
-  u16 addr_low = read_byte(_PC++);
-  u16 addr_high = read_byte(_PC++);
-  u16 base_addr = (addr_high << 8) | addr_low;
-  u16 final_addr = base_addr + _Y;
-
-  _page_crossed = ((base_addr & 0xFF00) != (final_addr & 0xFF00));
-  return final_addr;
-}
-
-u16 CPU::indirect_x() {
-  u8 zp_addr = read_byte(_PC++);
-  zp_addr += _X;  // Add X to the zero page address (with wrap)
+template <typename Memory, Variant Model>
+u16 BasicCPU<Memory, Model>::indirect_x(const u16 operand) {
+  u8 zp_addr = operand + _X;  // Add X to the zero page address (with wrap)
 
   // Read two bytes from the computed zero page address
   u16 effective_addr_low = read_byte(zp_addr);
@@ -386,8 +1384,9 @@ u16 CPU::indirect_x() {
   return (effective_addr_high << 8) | effective_addr_low;
 }
 
-u16 CPU::indirect_y() {
-  u8 zp_addr = read_byte(_PC++);
+template <typename Memory, Variant Model>
+u16 BasicCPU<Memory, Model>::indirect_y(const u16 operand) {
+  u8 zp_addr = operand;
 
   u16 effective_addr_low = read_byte(zp_addr);
   u16 effective_addr_high = read_byte(((u16)((zp_addr + 1) & 0xFF)));
@@ -400,9 +1399,26 @@ u16 CPU::indirect_y() {
   return final_addr;
 }
 
-u16 CPU::relative() {
-  u8 offset = read_byte(_PC++);
-  return offset;
+// (zp) - like (zp),Y without the index
+template <typename Memory, Variant Model>
+u16 BasicCPU<Memory, Model>::zero_page_indirect(const u16 operand) {
+  u8 zp_addr = operand;
+
+  u16 effective_addr_low = read_byte(zp_addr);
+  u16 effective_addr_high = read_byte((u16)((zp_addr + 1) & 0xFF));
+
+  return (effective_addr_high << 8) | effective_addr_low;
+}
+
+// (abs,X) - only used by JMP, the pointer may cross a page
+template <typename Memory, Variant Model>
+u16 BasicCPU<Memory, Model>::absolute_indexed_indirect(const u16 operand) {
+  u16 pointer = operand + _X;
+
+  u16 effective_addr_low = read_byte(pointer);
+  u16 effective_addr_high = read_byte(pointer + 1);
+
+  return (effective_addr_high << 8) | effective_addr_low;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -410,158 +1426,99 @@ u16 CPU::relative() {
 //////////////////////////////////////////////////////////////////////////
 
 // Load operations
-void CPU::op_lda(const u16 addr) {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_lda(const u16 addr) {
   _A = read_byte(addr);
   update_zero_and_negative_flags(_A);
 }
 
-void CPU::op_ldx(const u16 addr) {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_ldx(const u16 addr) {
   _X = read_byte(addr);
   update_zero_and_negative_flags(_X);
 }
 
-void CPU::op_ldy(const u16 addr) {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_ldy(const u16 addr) {
   _Y = read_byte(addr);
   update_zero_and_negative_flags(_Y);
 }
 
 // Store operations
-void CPU::op_sta(const u16 addr) { write_byte(addr, _A); }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_sta(const u16 addr) { write_byte(addr, _A); }
 
-void CPU::op_stx(const u16 addr) { write_byte(addr, _X); }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_stx(const u16 addr) { write_byte(addr, _X); }
 
-void CPU::op_sty(const u16 addr) { write_byte(addr, _Y); }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_sty(const u16 addr) { write_byte(addr, _Y); }
 
 // ASL (addressed version)
-void CPU::op_asl(const u16 addr) {
-  u8 value = read_byte(addr);
-  set_flag(Flag::CARRY, (value & 0x80) != 0);
-  value <<= 1;
-  write_byte(addr, value);
-  update_zero_and_negative_flags(value);
-}
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_asl(const u16 addr) { write_byte(addr, shift_left(read_byte(addr))); }
 
 // LSR (addressed version)
-void CPU::op_lsr(const u16 addr) {
-  u8 value = read_byte(addr);
-  set_flag(Flag::CARRY, (value & 0x01) != 0);
-  value >>= 1;
-  write_byte(addr, value);
-  set_flag(Flag::NEGATIVE, 0);
-  set_flag(Flag::ZERO, value == 0);
-}
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_lsr(const u16 addr) { write_byte(addr, shift_right(read_byte(addr))); }
 
 // ROL
-void CPU::op_rol(const u16 addr) {
-  u8 value = read_byte(addr);
-  bool carry_bit = (value & 0x80) != 0;
-  value <<= 1;
-
-  // Put the old carry flag into bit 0
-  if (get_flag(Flag::CARRY)) {
-    value |= 0x01;
-  }
-
-  set_flag(Flag::CARRY, carry_bit);
-  write_byte(addr, value);
-  update_zero_and_negative_flags(value);
-}
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_rol(const u16 addr) { write_byte(addr, rotate_left(read_byte(addr))); }
 
 // ROR
-void CPU::op_ror(const u16 addr) {
-  u8 value = read_byte(addr);
-  bool carry_bit = (value & 0x01) != 0;
-  value >>= 1;
-
-  // Put the old carry flag into bit 7
-  if (get_flag(Flag::CARRY)) {
-    value |= 0x80;
-  }
-
-  set_flag(Flag::CARRY, carry_bit);
-  write_byte(addr, value);
-  update_zero_and_negative_flags(value);
-}
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_ror(const u16 addr) { write_byte(addr, rotate_right(read_byte(addr))); }
 
 // Arithmetic operations
 // ADC
-void CPU::op_adc(const u16 addr) {
-  u16 value = (u16)read_byte(addr);
-  u16 sum = (u16)_A + value + get_flag(Flag::CARRY);
-
-  set_flag(Flag::CARRY, sum > 0xFF);
-  bool overflow = ((_A ^ sum) & (value ^ sum) & 0x80) != 0;
-  set_flag(Flag::OVERFLOW_, overflow);
-  _A = sum;
-  update_zero_and_negative_flags(_A);
-}
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_adc(const u16 addr) { add_with_carry(read_byte(addr), get_flag(Flag::CARRY)); }
 
 // SBC
-void CPU::op_sbc(const u16 addr) {
-  u16 value = (u16)read_byte(addr);
-  u16 sub = (u16)_A - value - (1 - (u16)get_flag(Flag::CARRY));
-
-  set_flag(Flag::CARRY, !(sub & 0x100));
-
-  // overflow is set when operands have different signs and result sign != A sign
-  bool overflow = ((_A ^ value) & 0x80) && ((_A ^ sub) & 0x80);
-  set_flag(Flag::OVERFLOW_, overflow);
-
-  _A = (u8)sub;
-  update_zero_and_negative_flags(_A);
-}
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_sbc(const u16 addr) { subtract_with_borrow(read_byte(addr), get_flag(Flag::CARRY)); }
 
 // CMP
-void CPU::op_cmp(const u16 addr) {
-  u16 value = (u16)read_byte(addr);
-  u16 sub = (u16)_A - value;
-
-  set_flag(Flag::CARRY, sub <= _A);
-  update_zero_and_negative_flags(sub);
-}
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_cmp(const u16 addr) { compare(_A, read_byte(addr)); }
 
 // CPX
-void CPU::op_cpx(const u16 addr) {
-  u16 value = (u16)read_byte(addr);
-  u16 sub = (u16)_X - value;
-
-  set_flag(Flag::CARRY, sub <= _X);
-  update_zero_and_negative_flags(sub);
-}
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_cpx(const u16 addr) { compare(_X, read_byte(addr)); }
 
 // CPY
-void CPU::op_cpy(const u16 addr) {
-  u16 value = (u16)read_byte(addr);
-  u16 sub = (u16)_Y - value;
-
-  set_flag(Flag::CARRY, sub <= _Y);
-  update_zero_and_negative_flags(sub);
-}
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_cpy(const u16 addr) { compare(_Y, read_byte(addr)); }
 
 // Logical operations
 // AND
-void CPU::op_and(const u16 addr) {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_and(const u16 addr) {
   u8 value = read_byte(addr);
   _A &= value;
   update_zero_and_negative_flags(_A);
 }
 
 // EOR - Exculive OR
-void CPU::op_eor(const u16 addr) {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_eor(const u16 addr) {
   u8 value = read_byte(addr);
   _A ^= value;
   update_zero_and_negative_flags(_A);
 }
 
 // ORA
-void CPU::op_ora(const u16 addr) {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_ora(const u16 addr) {
   u8 value = read_byte(addr);
   _A |= value;
   update_zero_and_negative_flags(_A);
 }
 
 // BIT
-void CPU::op_bit(const u16 addr) {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_bit(const u16 addr) {
   u8 value = read_byte(addr);
   u8 result = _A & value;
   set_flag(Flag::NEGATIVE, (value & 0x80) != 0);
@@ -570,262 +1527,368 @@ void CPU::op_bit(const u16 addr) {
 }
 
 // Increment/Decrement operations
-void CPU::op_inc(const u16 addr) {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_inc(const u16 addr) {
   u8 value = read_byte(addr);
   write_byte(addr, value + 1);
   update_zero_and_negative_flags(value + 1);
 }
 
-void CPU::op_dec(const u16 addr) {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_dec(const u16 addr) {
   u8 value = read_byte(addr);
   write_byte(addr, value - 1);
   update_zero_and_negative_flags(value - 1);
 }
 
 // Branching operations
-// BCC - Branch on Carry Clear
-void CPU::op_bcc(const u16 offset) {
-  if (get_flag(Flag::CARRY) == false) {
-    int8_t signed_offset = static_cast<int8_t>(offset);
-    u16 old_page = _PC & 0xFF00;
-    _PC += signed_offset;
-    _cycles++;
-    if ((_PC & 0xFF00) != old_page) {
-      _cycles++;
-    }
-  }
+template <typename Memory, Variant Model>
+template <u8 Code>
+void BasicCPU<Memory, Model>::op_branch(const u16 offset) {
+  constexpr BranchCondition condition = BRANCH_CONDITIONS[Code >> 5];
+  branch(get_flag(condition.flag) == condition.expected, offset);
 }
 
-void CPU::op_bcs(const u16 offset) {
-  if (get_flag(Flag::CARRY) == true) {
-    int8_t signed_offset = static_cast<int8_t>(offset);
-    u16 old_page = _PC & 0xFF00;
-    _PC += signed_offset;
-    _cycles++;
-    if ((_PC & 0xFF00) != old_page) {
-      _cycles++;
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::branch(const bool taken, const u16 offset) {
+  if (_branch_stats) {
+    BranchStats &stats = (*_branch_stats)[(u16)(_PC - 2)];  // The operand is already fetched
+    if (taken) {
+      stats.taken++;
+    } else {
+      stats.not_taken++;
     }
   }
+  if (taken) take_branch(offset);
 }
 
-void CPU::op_beq(const u16 offset) {
-  if (get_flag(Flag::ZERO) == true) {
-    int8_t signed_offset = static_cast<int8_t>(offset);
-    u16 old_page = _PC & 0xFF00;
-    _PC += signed_offset;
-    _cycles++;
-    if ((_PC & 0xFF00) != old_page) {
-      _cycles++;
-    }
+// One cycle for taking the branch, another if it lands on a different page
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::take_branch(const u16 offset) {
+  const u16 target = _PC + static_cast<int8_t>(offset);
+  _cycles += ((target ^ _PC) & 0xFF00) ? 2 : 1;
+  if ((u16)(_PC - target) <= IDLE_LOOP_MAX_BYTES && _idle_loop_armed && !is_idle_loop_rejected(target)) {
+    _pending_signals |= SIGNAL_IDLE_LOOP;
   }
+  _PC = target;
 }
 
-void CPU::op_bmi(const u16 offset) {
-  if (get_flag(Flag::NEGATIVE) == true) {
-    int8_t signed_offset = static_cast<int8_t>(offset);
-    u16 old_page = _PC & 0xFF00;
-    _PC += signed_offset;
-    _cycles++;
-    if ((_PC & 0xFF00) != old_page) {
-      _cycles++;
-    }
+// Control-Flow operations
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_jmp(const u16 addr) {
+  if ((u16)(_PC - addr) <= IDLE_LOOP_MAX_BYTES && _idle_loop_armed && !is_idle_loop_rejected(addr)) {
+    _pending_signals |= SIGNAL_IDLE_LOOP;
   }
+  _PC = addr;
 }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_jsr(u16 addr) {
+  _PC--;
+  // Push return address to stack - high byte first, then low byte
+  write_byte(0x0100 + _SP, (_PC >> 8) & 0xFF);  // High byte
+  _SP--;
+  write_byte(0x0100 + _SP, _PC & 0xFF);  // Low byte
+  _SP--;
 
-void CPU::op_bne(const u16 offset) {
-  if (get_flag(Flag::ZERO) == false) {
-    int8_t signed_offset = static_cast<int8_t>(offset);
-    u16 old_page = _PC & 0xFF00;
-    _PC += signed_offset;
-    _cycles++;
-    if ((_PC & 0xFF00) != old_page) {
-      _cycles++;
-    }
-  }
+  // Set program counter to subroutine address
+  _PC = addr;
 }
 
-void CPU::op_bpl(const u16 offset) {
-  if (get_flag(Flag::NEGATIVE) == false) {
-    int8_t signed_offset = static_cast<int8_t>(offset);
-    u16 old_page = _PC & 0xFF00;
-    _PC += signed_offset;
-    _cycles++;
-    if ((_PC & 0xFF00) != old_page) {
-      _cycles++;
-    }
-  }
+//////////////////////////////////////////////////////////////////////////
+// UNDOCUMENTED OPERATIONS (stable NMOS opcodes outside the official set)
+//////////////////////////////////////////////////////////////////////////
+
+// LAX - LDA and LDX at once
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_lax(const u16 addr) {
+  _A = read_byte(addr);
+  _X = _A;
+  update_zero_and_negative_flags(_A);
 }
 
-void CPU::op_bvc(const u16 offset) {
-  if (get_flag(Flag::OVERFLOW_) == false) {
-    int8_t signed_offset = static_cast<int8_t>(offset);
-    u16 old_page = _PC & 0xFF00;
-    _PC += signed_offset;
-    _cycles++;
-    if ((_PC & 0xFF00) != old_page) {
-      _cycles++;
-    }
-  }
+// SAX - Store A AND X, flags untouched
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_sax(const u16 addr) { write_byte(addr, _A & _X); }
+
+// DCP - DEC then CMP
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_dcp(const u16 addr) {
+  u8 value = read_byte(addr) - 1;
+  write_byte(addr, value);
+  compare(_A, value);
 }
 
-void CPU::op_bvs(const u16 offset) {
-  if (get_flag(Flag::OVERFLOW_) == true) {
-    int8_t signed_offset = static_cast<int8_t>(offset);
-    u16 old_page = _PC & 0xFF00;
-    _PC += signed_offset;
-    _cycles++;
-    if ((_PC & 0xFF00) != old_page) {
-      _cycles++;
-    }
-  }
+// ISC - INC then SBC
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_isc(const u16 addr) {
+  u8 value = read_byte(addr) + 1;
+  write_byte(addr, value);
+  subtract_with_borrow(value, get_flag(Flag::CARRY));
 }
 
-// Control-Flow operations
-void CPU::op_jmp(const u16 addr) { _PC = addr; }
-void CPU::op_jsr(u16 addr) {
-  _PC--;
-  // Push return address to stack - high byte first, then low byte
-  write_byte(0x0100 + _SP, (_PC >> 8) & 0xFF);  // High byte
-  _SP--;
-  write_byte(0x0100 + _SP, _PC & 0xFF);  // Low byte
-  _SP--;
+// SLO - ASL then ORA
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_slo(const u16 addr) {
+  u8 value = shift_left(read_byte(addr));
+  write_byte(addr, value);
+  _A |= value;
+  update_zero_and_negative_flags(_A);
+}
 
-  // Set program counter to subroutine address
-  _PC = addr;
+// RLA - ROL then AND
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_rla(const u16 addr) {
+  u8 value = rotate_left(read_byte(addr));
+  write_byte(addr, value);
+  _A &= value;
+  update_zero_and_negative_flags(_A);
+}
+
+// SRE - LSR then EOR
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_sre(const u16 addr) {
+  u8 value = shift_right(read_byte(addr));
+  write_byte(addr, value);
+  _A ^= value;
+  update_zero_and_negative_flags(_A);
+}
+
+// RRA - ROR then ADC, the carry out of the rotate feeds the addition
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_rra(const u16 addr) {
+  u8 value = rotate_right(read_byte(addr));
+  write_byte(addr, value);
+  add_with_carry(value, get_flag(Flag::CARRY));
+}
+
+// ANC - AND, then bit 7 is copied into C
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_anc(const u16 addr) {
+  _A &= read_byte(addr);
+  update_zero_and_negative_flags(_A);
+  set_flag(Flag::CARRY, (_A & 0x80) != 0);
+}
+
+// ALR - AND then LSR A
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_alr(const u16 addr) { _A = shift_right(_A & read_byte(addr)); }
+
+// ARR - AND then ROR A, but C comes from bit 6 of the result and V from bit 6 XOR bit 5
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_arr(const u16 addr) {
+  _A = ((_A & read_byte(addr)) >> 1) | (get_flag(Flag::CARRY) ? 0x80 : 0x00);
+  update_zero_and_negative_flags(_A);
+  set_flag(Flag::CARRY, (_A & 0x40) != 0);
+  set_flag(Flag::OVERFLOW_, (((_A >> 6) ^ (_A >> 5)) & 0x01) != 0);
+}
+
+// AXS - X = (A AND X) - operand, flags set like CMP
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_axs(const u16 addr) {
+  u8 value = read_byte(addr);
+  u8 masked = _A & _X;
+  set_flag(Flag::CARRY, masked >= value);
+  _X = masked - value;
+  update_zero_and_negative_flags(_X);
+}
+
+// Multi-byte NOPs still perform the read
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_nop_read(const u16 addr) { read_byte(addr); }
+
+//////////////////////////////////////////////////////////////////////////
+// 65C02 OPERATIONS (only listed in opcodes_65c02.def)
+//////////////////////////////////////////////////////////////////////////
+
+// BIT #imm only sets Z, there is no memory operand for N and V to come from
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_bit_imm(const u16 addr) { set_flag(Flag::ZERO, (_A & read_byte(addr)) == 0); }
+
+// STZ - Store Zero
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_stz(const u16 addr) { write_byte(addr, 0); }
+
+// TSB - Z from A AND M, then set the bits of A in M
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_tsb(const u16 addr) {
+  u8 value = read_byte(addr);
+  set_flag(Flag::ZERO, (_A & value) == 0);
+  write_byte(addr, value | _A);
+}
+
+// TRB - Z from A AND M, then clear the bits of A in M
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_trb(const u16 addr) {
+  u8 value = read_byte(addr);
+  set_flag(Flag::ZERO, (_A & value) == 0);
+  write_byte(addr, value & ~_A);
 }
 
+// BRA - Branch Always
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_bra(const u16 offset) { branch(true, offset); }
+
 //////////////////////////////////////////////////////////////////////////
 // IMPLIED OPERATIONS (operations that don't need an address)
 //////////////////////////////////////////////////////////////////////////
 
 // NOP
-void CPU::op_nop() { return; }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_nop() { return; }
 // Transfer operations
-void CPU::op_tax() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_tax() {
   _X = _A;
   update_zero_and_negative_flags(_X);
 }
 
-void CPU::op_tay() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_tay() {
   _Y = _A;
   update_zero_and_negative_flags(_Y);
 }
 
-void CPU::op_txa() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_txa() {
   _A = _X;
   update_zero_and_negative_flags(_A);
 }
 
-void CPU::op_tsx() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_tsx() {
   _X = _SP;
   update_zero_and_negative_flags(_X);
 }
 
-void CPU::op_txs() { _SP = _X; }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_txs() { _SP = _X; }
 
-void CPU::op_tya() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_tya() {
   _A = _Y;
   update_zero_and_negative_flags(_A);
 }
 
 // Stack operations
-void CPU::op_pha() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_pha() {
   write_byte(0x0100 + _SP, _A);
   _SP--;
 }
 
-void CPU::op_php() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_php() {
   // When pushing the status register, set bits a4 and 5 (B flag and unused flag)
-  write_byte(0x0100 + _SP, _status | 0x30);
+  write_byte(0x0100 + _SP, get_status() | 0x30);
   _SP--;
 }
 
-void CPU::op_pla() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_pla() {
   _SP++;
   _A = read_byte(0x0100 + _SP);
   update_zero_and_negative_flags(_A);
 }
 
-void CPU::op_plp() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_plp() {
   _SP++;
   uint8_t pulled_status = read_byte(0x0100 + _SP);
   uint8_t break_flag = _status & 0x10;
 
   // Set the status register with the pulled value
   // but preserve the Break flag and force Unused flag set
-  _status = (pulled_status & ~0x10) | break_flag | 0x20;
+  set_status((pulled_status & ~0x10) | break_flag | 0x20);
 }
 
-// ASL, LSR, ROL accumulator operations
-void CPU::op_asl_acc() {
-  set_flag(Flag::CARRY, (_A & 0x80) != 0);
-  _A <<= 1;
-  update_zero_and_negative_flags(_A);
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_phx() {
+  write_byte(0x0100 + _SP, _X);
+  _SP--;
 }
 
-void CPU::op_lsr_acc() {
-  set_flag(Flag::CARRY, (_A & 0x01) != 0);
-  _A >>= 1;
-  set_flag(Flag::NEGATIVE, 0);
-  set_flag(Flag::ZERO, _A == 0);
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_phy() {
+  write_byte(0x0100 + _SP, _Y);
+  _SP--;
 }
 
-void CPU::op_rol_acc() {
-  bool carry_bit = (_A & 0x80) != 0;
-  _A <<= 1;
-
-  // Put the old carry flag into bit 0
-  if (get_flag(Flag::CARRY)) {
-    _A |= 0x01;
-  }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_plx() {
+  _SP++;
+  _X = read_byte(0x0100 + _SP);
+  update_zero_and_negative_flags(_X);
+}
 
-  set_flag(Flag::CARRY, carry_bit);
-  update_zero_and_negative_flags(_A);
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_ply() {
+  _SP++;
+  _Y = read_byte(0x0100 + _SP);
+  update_zero_and_negative_flags(_Y);
 }
 
-void CPU::op_ror_acc() {
-  bool carry_bit = (_A & 0x01) != 0;
-  _A >>= 1;
+// ASL, LSR, ROL accumulator operations
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_asl_acc() { _A = shift_left(_A); }
 
-  // Put the old carry flag into bit 7
-  if (get_flag(Flag::CARRY)) {
-    _A |= 0x80;
-  }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_lsr_acc() { _A = shift_right(_A); }
 
-  set_flag(Flag::CARRY, carry_bit);
-  update_zero_and_negative_flags(_A);
-}
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_rol_acc() { _A = rotate_left(_A); }
+
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_ror_acc() { _A = rotate_right(_A); }
 
 // Increment/Decrement operations
 // INX
-void CPU::op_inx() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_inx() {
   _X = _X + 1;
   update_zero_and_negative_flags(_X);
 }
 
 // INY
-void CPU::op_iny() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_iny() {
   _Y = _Y + 1;
   update_zero_and_negative_flags(_Y);
 }
 
 // DEX
-void CPU::op_dex() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_dex() {
   _X = (_X - 1) & 0xFF;
   update_zero_and_negative_flags(_X);
 }
 
 // DEY
-void CPU::op_dey() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_dey() {
   _Y = (_Y - 1) & 0xFF;
   update_zero_and_negative_flags(_Y);
 }
 
+// INC A
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_inc_acc() {
+  _A = _A + 1;
+  update_zero_and_negative_flags(_A);
+}
+
+// DEC A
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_dec_acc() {
+  _A = _A - 1;
+  update_zero_and_negative_flags(_A);
+}
+
 // Control-Flow operations
-void CPU::op_brk() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_brk() {
   u16 pc_plus_two = _PC + 1;
   //  Save original status for flag preservation
-  u8 original_status = _status;
+  u8 original_status = get_status();
   //  Set interrupt disable flag
   set_flag(Flag::INTERRUPT_DISABLE, true);
   //  Push PCH (high byte)
@@ -844,26 +1907,29 @@ void CPU::op_brk() {
   set_flag(Flag::BREAK, false);
 
   // Restore other flags (except interrupt disable)
-  _status = (_status & (u8)Flag::INTERRUPT_DISABLE) | (original_status & ~((u8)Flag::INTERRUPT_DISABLE | (u8)Flag::BREAK));
+  set_status((get_status() & (u8)Flag::INTERRUPT_DISABLE) | (original_status & ~((u8)Flag::INTERRUPT_DISABLE | (u8)Flag::BREAK)));
+  // The 65C02 also leaves decimal mode on the way into the handler
+  if constexpr (Model == Variant::CMOS_65C02) set_flag(Flag::DECIMAL, false);
   // Load interrupt vector
   u16 low_byte = read_byte(0xFFFE);
   u16 high_byte = read_byte(0xFFFF);
   _PC = (high_byte << 8) | low_byte;
 }
 
-void CPU::op_rti() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_rti() {
   // Pushed status last so first to get out
   u8 status = read_byte(0x0100 + ++_SP);
   // By the specification the PCL is pushed then PCH
   u8 pc_low = read_byte(0x0100 + ++_SP);
   u8 pc_high = read_byte(0x0100 + ++_SP);
 
-  _status = status;
-  _status &= ~(u8)Flag::BREAK;
+  set_status(status & ~(u8)Flag::BREAK);
   _PC = (u16)pc_low | (u16)pc_high << 8;
 }
 
-void CPU::op_rts() {
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_rts() {
   // Load the program counter from the stack
   u8 pc_low = read_byte(0x0100 + ++_SP);
   u8 pc_high = read_byte(0x0100 + ++_SP);
@@ -872,12 +1938,26 @@ void CPU::op_rts() {
 }
 
 // Flag operations
-void CPU::op_clc() { set_flag(Flag::CARRY, false); }
-void CPU::op_cld() { set_flag(Flag::DECIMAL, false); }
-void CPU::op_cli() { set_flag(Flag::INTERRUPT_DISABLE, false); }
-void CPU::op_clv() { set_flag(Flag::OVERFLOW_, false); }
-void CPU::op_sec() { set_flag(Flag::CARRY, true); }
-void CPU::op_sed() { set_flag(Flag::DECIMAL, true); }
-void CPU::op_sei() { set_flag(Flag::INTERRUPT_DISABLE, true); }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_clc() { set_flag(Flag::CARRY, false); }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_cld() { set_flag(Flag::DECIMAL, false); }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_cli() { set_flag(Flag::INTERRUPT_DISABLE, false); }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_clv() { set_flag(Flag::OVERFLOW_, false); }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_sec() { set_flag(Flag::CARRY, true); }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_sed() { set_flag(Flag::DECIMAL, true); }
+template <typename Memory, Variant Model>
+void BasicCPU<Memory, Model>::op_sei() { set_flag(Flag::INTERRUPT_DISABLE, true); }
+
+template class BasicCPU<Bus>;
+template class BasicCPU<Addressable>;
+template class BasicCPU<Bus, Variant::NMOS_6502>;
+template class BasicCPU<Bus, Variant::CMOS_65C02>;
+template class BasicCPU<FlatBus>;
+template class BasicCPU<FlatBus, Variant::NMOS_6502>;
 
 }  // namespace nes
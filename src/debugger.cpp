@@ -9,201 +9,20 @@ namespace nes {
 static Debugger* g_debugger = nullptr;
 
 void print_disassembled_instruction(const DisassembledInstruction& instruction);
-Debugger::Debugger(CPU& cpu, Bus& bus)
+Debugger::Debugger(DebuggerCPU& cpu, Bus& bus)
   : _cpu(cpu)
   , _bus(bus)
   , _running(false)
   , _instruction_count(0)
   , _cycle_count(0) {
   g_debugger = this;
+  _bus.set_memory_watcher(this);
+}
 
-  init_addressing_mode_table();
-}
-
-void Debugger::init_addressing_mode_table() {
-  _addressing_mode_table.fill("IMP");
-
-  // Load/Store operations
-  // LDA
-  _addressing_mode_table[(u8)Opcode::LDA_IMM] = "IMM";
-  _addressing_mode_table[(u8)Opcode::LDA_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::LDA_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::LDA_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::LDA_ABX] = "ABX";
-  _addressing_mode_table[(u8)Opcode::LDA_ABY] = "ABY";
-  _addressing_mode_table[(u8)Opcode::LDA_IZX] = "IZX";
-  _addressing_mode_table[(u8)Opcode::LDA_IZY] = "IZY";
-
-  // LDX
-  _addressing_mode_table[(u8)Opcode::LDX_IMM] = "IMM";
-  _addressing_mode_table[(u8)Opcode::LDX_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::LDX_ZPY] = "ZPY";
-  _addressing_mode_table[(u8)Opcode::LDX_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::LDX_ABY] = "ABY";
-
-  // LDY
-  _addressing_mode_table[(u8)Opcode::LDY_IMM] = "IMM";
-  _addressing_mode_table[(u8)Opcode::LDY_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::LDY_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::LDY_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::LDY_ABX] = "ABX";
-
-  // STA
-  _addressing_mode_table[(u8)Opcode::STA_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::STA_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::STA_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::STA_ABX] = "ABX";
-  _addressing_mode_table[(u8)Opcode::STA_ABY] = "ABY";
-  _addressing_mode_table[(u8)Opcode::STA_IZX] = "IZX";
-  _addressing_mode_table[(u8)Opcode::STA_IZY] = "IZY";
-
-  // STX
-  _addressing_mode_table[(u8)Opcode::STX_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::STX_ZPY] = "ZPY";
-  _addressing_mode_table[(u8)Opcode::STX_ABS] = "ABS";
-
-  // STY
-  _addressing_mode_table[(u8)Opcode::STY_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::STY_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::STY_ABS] = "ABS";
-
-  // Arithmetic operations
-  // ADC
-  _addressing_mode_table[(u8)Opcode::ADC_IMM] = "IMM";
-  _addressing_mode_table[(u8)Opcode::ADC_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::ADC_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::ADC_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::ADC_ABX] = "ABX";
-  _addressing_mode_table[(u8)Opcode::ADC_ABY] = "ABY";
-  _addressing_mode_table[(u8)Opcode::ADC_IZX] = "IZX";
-  _addressing_mode_table[(u8)Opcode::ADC_IZY] = "IZY";
-
-  // SBC
-  _addressing_mode_table[(u8)Opcode::SBC_IMM] = "IMM";
-  _addressing_mode_table[(u8)Opcode::SBC_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::SBC_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::SBC_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::SBC_ABX] = "ABX";
-  _addressing_mode_table[(u8)Opcode::SBC_ABY] = "ABY";
-  _addressing_mode_table[(u8)Opcode::SBC_IZX] = "IZX";
-  _addressing_mode_table[(u8)Opcode::SBC_IZY] = "IZY";
-
-  // CMP
-  _addressing_mode_table[(u8)Opcode::CMP_IMM] = "IMM";
-  _addressing_mode_table[(u8)Opcode::CMP_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::CMP_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::CMP_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::CMP_ABX] = "ABX";
-  _addressing_mode_table[(u8)Opcode::CMP_ABY] = "ABY";
-  _addressing_mode_table[(u8)Opcode::CMP_IZX] = "IZX";
-  _addressing_mode_table[(u8)Opcode::CMP_IZY] = "IZY";
-
-  // CPX
-  _addressing_mode_table[(u8)Opcode::CPX_IMM] = "IMM";
-  _addressing_mode_table[(u8)Opcode::CPX_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::CPX_ABS] = "ABS";
-
-  // CPY
-  _addressing_mode_table[(u8)Opcode::CPY_IMM] = "IMM";
-  _addressing_mode_table[(u8)Opcode::CPY_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::CPY_ABS] = "ABS";
-
-  // Logical operations
-  // AND
-  _addressing_mode_table[(u8)Opcode::AND_IMM] = "IMM";
-  _addressing_mode_table[(u8)Opcode::AND_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::AND_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::AND_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::AND_ABX] = "ABX";
-  _addressing_mode_table[(u8)Opcode::AND_ABY] = "ABY";
-  _addressing_mode_table[(u8)Opcode::AND_IZX] = "IZX";
-  _addressing_mode_table[(u8)Opcode::AND_IZY] = "IZY";
-
-  // ORA
-  _addressing_mode_table[(u8)Opcode::ORA_IMM] = "IMM";
-  _addressing_mode_table[(u8)Opcode::ORA_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::ORA_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::ORA_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::ORA_ABX] = "ABX";
-  _addressing_mode_table[(u8)Opcode::ORA_ABY] = "ABY";
-  _addressing_mode_table[(u8)Opcode::ORA_IZX] = "IZX";
-  _addressing_mode_table[(u8)Opcode::ORA_IZY] = "IZY";
-
-  // EOR
-  _addressing_mode_table[(u8)Opcode::EOR_IMM] = "IMM";
-  _addressing_mode_table[(u8)Opcode::EOR_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::EOR_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::EOR_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::EOR_ABX] = "ABX";
-  _addressing_mode_table[(u8)Opcode::EOR_ABY] = "ABY";
-  _addressing_mode_table[(u8)Opcode::EOR_IZX] = "IZX";
-  _addressing_mode_table[(u8)Opcode::EOR_IZY] = "IZY";
-
-  // BIT
-  _addressing_mode_table[(u8)Opcode::BIT_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::BIT_ABS] = "ABS";
-
-  // Shifts and rotates
-  // ASL
-  _addressing_mode_table[(u8)Opcode::ASL_ACC] = "ACC";
-  _addressing_mode_table[(u8)Opcode::ASL_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::ASL_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::ASL_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::ASL_ABX] = "ABX";
-
-  // LSR
-  _addressing_mode_table[(u8)Opcode::LSR_ACC] = "ACC";
-  _addressing_mode_table[(u8)Opcode::LSR_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::LSR_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::LSR_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::LSR_ABX] = "ABX";
-
-  // ROL
-  _addressing_mode_table[(u8)Opcode::ROL_ACC] = "ACC";
-  _addressing_mode_table[(u8)Opcode::ROL_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::ROL_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::ROL_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::ROL_ABX] = "ABX";
-
-  // ROR
-  _addressing_mode_table[(u8)Opcode::ROR_ACC] = "ACC";
-  _addressing_mode_table[(u8)Opcode::ROR_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::ROR_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::ROR_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::ROR_ABX] = "ABX";
-
-  // Increments and decrement
-  // INC
-  _addressing_mode_table[(u8)Opcode::INC_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::INC_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::INC_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::INC_ABX] = "ABX";
-
-  // DEC
-  _addressing_mode_table[(u8)Opcode::DEC_ZPG] = "ZPG";
-  _addressing_mode_table[(u8)Opcode::DEC_ZPX] = "ZPX";
-  _addressing_mode_table[(u8)Opcode::DEC_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::DEC_ABX] = "ABX";
-
-  // INX, DEX, INY, DEY are iplied
-
-  // Control flow
-  // JMP
-  _addressing_mode_table[(u8)Opcode::JMP_ABS] = "ABS";
-  _addressing_mode_table[(u8)Opcode::JMP_IND] = "IND";
-
-  // JSR
-  _addressing_mode_table[(u8)Opcode::JSR_ABS] = "ABS";
-
-  // Branches
-  _addressing_mode_table[(u8)Opcode::BCC_REL] = "REL";
-  _addressing_mode_table[(u8)Opcode::BCS_REL] = "REL";
-  _addressing_mode_table[(u8)Opcode::BEQ_REL] = "REL";
-  _addressing_mode_table[(u8)Opcode::BMI_REL] = "REL";
-  _addressing_mode_table[(u8)Opcode::BNE_REL] = "REL";
-  _addressing_mode_table[(u8)Opcode::BPL_REL] = "REL";
-  _addressing_mode_table[(u8)Opcode::BVC_REL] = "REL";
-  _addressing_mode_table[(u8)Opcode::BVS_REL] = "REL";
+Debugger::~Debugger() {
+  clear_watchpoints();
+  _bus.set_memory_watcher(nullptr);
+  if (g_debugger == this) g_debugger = nullptr;
 }
 
 // Execute one instruction
@@ -212,13 +31,18 @@ void Debugger::step() {
   u16 current_pc = _cpu.get_pc();
 
   // Check if current instruction is BRK (0x00)
-  u8 opcode = _bus.read(current_pc);
+  u8 opcode = peek(current_pc);
+
+  _watch_hits.clear();
+  const u8 cycles = _cpu.step_instruction();
 
-  do {
-    _cpu.clock();
-    _cycle_count++;
-  } while (_cpu.get_remaining_cycles() > 0);
+  // The CPU halted on an unknown opcode, nothing ran
+  if (cycles == 0) {
+    stop();
+    return;
+  }
 
+  _cycle_count += cycles;
   _instruction_count++;
 
   // Stop if we executed a BRK instruction
@@ -231,6 +55,16 @@ void Debugger::step() {
 #endif
   }
 
+  // Stop if the instruction touched a watchpoint
+  if (!_watch_hits.empty()) {
+    stop();
+
+// Notify JavaScript
+#ifdef __EMSCRIPTEN__
+    EM_ASM({ window.dispatchEvent(new CustomEvent('nes-watchpoint-hit')); });
+#endif
+  }
+
   check_breakpoints();
 }
 
@@ -261,6 +95,63 @@ std::vector<u16> Debugger::get_breakpoints() const {
   return breakpoints;
 }
 
+// Watchpoint methods
+void Debugger::add_watchpoint(u16 address, u8 types) {
+  if (types == 0) {
+    remove_watchpoint(address);
+    return;
+  }
+  const bool added = _watchpoints.find(address) == _watchpoints.end();
+  _watchpoints[address] = types;
+  if (added && _watchpoints_per_page[address >> 8]++ == 0) _bus.watch_page(address >> 8, true);
+}
+
+void Debugger::remove_watchpoint(u16 address) {
+  if (_watchpoints.erase(address) == 0) return;
+  if (--_watchpoints_per_page[address >> 8] == 0) _bus.watch_page(address >> 8, false);
+}
+
+void Debugger::clear_watchpoints() {
+  for (auto& wp : _watchpoints) {
+    _watchpoints_per_page[wp.first >> 8] = 0;
+    _bus.watch_page(wp.first >> 8, false);
+  }
+  _watchpoints.clear();
+}
+
+bool Debugger::has_watchpoint(u16 address) const { return _watchpoints.find(address) != _watchpoints.end(); }
+const std::vector<WatchHit>& Debugger::get_watch_hits() const { return _watch_hits; }
+
+void Debugger::memory_read(u16 address, u8 value) {
+  if (_inspecting) return;
+  auto wp = _watchpoints.find(address);
+  if (wp != _watchpoints.end() && (wp->second & (u8)WatchType::READ)) record_hit(address, WatchType::READ, value, value);
+}
+
+void Debugger::memory_written(u16 address, u8 old_value, u8 value) {
+  if (_inspecting) return;
+  auto wp = _watchpoints.find(address);
+  if (wp == _watchpoints.end()) return;
+  if (wp->second & (u8)WatchType::WRITE) {
+    record_hit(address, WatchType::WRITE, old_value, value);
+  } else if ((wp->second & (u8)WatchType::CHANGE) && old_value != value) {
+    record_hit(address, WatchType::CHANGE, old_value, value);
+  }
+}
+
+void Debugger::record_hit(u16 address, WatchType type, u8 old_value, u8 value) {
+  _watch_hits.push_back({address, type, old_value, value});
+}
+
+u8 Debugger::peek(u16 address) const {
+  const u8 open_bus = _bus.get_open_bus();
+  _inspecting = true;
+  const u8 value = _bus.read(address);
+  _inspecting = false;
+  _bus.set_open_bus(open_bus);
+  return value;
+}
+
 // State inspection methods
 u8 Debugger::get_register_a() const { return _cpu.get_accumulator(); }
 u8 Debugger::get_register_x() const { return _cpu.get_x(); }
@@ -272,35 +163,56 @@ u8 Debugger::get_status_flag(Flag flag) const { return _cpu.get_flag(flag) ? 1 :
 void Debugger::set_pc(u16 address) { _cpu.set_pc(address); }
 
 // Memory access methods
-u8 Debugger::read_memory(u16 address) const { return _bus.read(address); }
-void Debugger::write_memory(u16 address, u8 value) { _bus.write(address, value); }
+u8 Debugger::read_memory(u16 address) const { return peek(address); }
+
+void Debugger::write_memory(u16 address, u8 value) {
+  const u8 open_bus = _bus.get_open_bus();
+  _inspecting = true;
+  _bus.write(address, value);
+  _inspecting = false;
+  _bus.set_open_bus(open_bus);
+}
 
 std::vector<u8> Debugger::read_memory_range(u16 start, u16 end) const {
-  std::vector<u8> memory;
-  for (u16 addr = start; addr <= end; addr++) {
-    memory.push_back(read_memory(addr));
-  }
+  if (end < start) return {};
+  std::vector<u8> memory((size_t)end - start + 1);
+  _inspecting = true;
+  _bus.read_block(start, memory.data(), memory.size());
+  _inspecting = false;
   return memory;
 }
 
+u8 Debugger::get_open_bus() const { return _bus.get_open_bus(); }
+
 std::vector<u8> Debugger::get_stack() const {
   u8 sp = get_register_sp();
   return read_memory_range(0x0100 + sp + 1, 0x01FF);  // Stack is from 0x0100 to 0x01FF
 }
 
+std::vector<u8> Debugger::fetch_dirty_pages() {
+  const auto dirty = _bus.fetch_dirty_pages();
+  std::vector<u8> pages;
+  for (size_t page = 0; page < dirty.size(); page++) {
+    if (dirty[page]) pages.push_back(page);
+  }
+  return pages;
+}
+
 u64 Debugger::get_instruction_count() const { return _instruction_count; }
 u64 Debugger::get_cycle_count() const { return _cycle_count; }
+void Debugger::set_branch_stats_enabled(bool enabled) { _cpu.set_branch_stats_enabled(enabled); }
+BranchStats Debugger::get_branch_stats(u16 address) const { return _cpu.get_branch_stats(address); }
 
 // Get the number of bytes for a specific opcode
 u8 Debugger::get_instruction_bytes(u8 opcode) const {
-  std::string addr_mode = _addressing_mode_table[opcode];
+  std::string addr_mode = DebuggerCPU::get_instruction_info(opcode).mode;
 
   if (addr_mode == "IMP" || addr_mode == "ACC") {
     return 1;  // Just the opcode
   } else if (addr_mode == "IMM" || addr_mode == "ZPG" || addr_mode == "ZPX" || addr_mode == "ZPY" || addr_mode == "IZX" ||
-             addr_mode == "IZY" || addr_mode == "REL") {
+             addr_mode == "IZY" || addr_mode == "REL" || addr_mode == "ZPI") {
     return 2;  // Opcode + 1 byte operand
-  } else if (addr_mode == "ABS" || addr_mode == "ABX" || addr_mode == "ABY" || addr_mode == "IND") {
+  } else if (addr_mode == "ABS" || addr_mode == "ABX" || addr_mode == "ABY" || addr_mode == "IND" || addr_mode == "AIX") {
     return 3;  // Opcode + 2 byte operand
   }
 
@@ -316,11 +228,9 @@ DisassembledInstruction Debugger::disassemble_instruction(u16 address) const {
   result.opcode = opcode;
 
   const auto& instruction = _cpu.get_instruction((Opcode)opcode);
-  const char* name = instruction.name;
-  result.mnemonic = (name != nullptr && name[0] != '\0') ? name : "???";
+  result.mnemonic = DebuggerCPU::get_instruction_info(opcode).mnemonic;
   result.cycles = instruction.cycles;
 
-  std::string addr_mode = _addressing_mode_table[opcode];
   u8 bytes = get_instruction_bytes(opcode);
   result.bytes = bytes;
 
@@ -391,7 +301,7 @@ std::vector<DisassembledInstruction> Debugger::disassemble_around_pc(int instruc
 
       // Skip invalid opcodes by treating them as 1-byte
       const auto& instruction = _cpu.get_instruction((Opcode)opcode);
-      if (instruction.name == nullptr || instruction.name[0] == '\0' || instruction.cycles == 0) {
+      if (instruction.cycles == 0) {
         continue;  // Skip to next address
       }
 
@@ -405,8 +315,9 @@ std::vector<DisassembledInstruction> Debugger::disassemble_around_pc(int instruc
   }
 
   std::vector<u16> before_addresses;
+  const size_t wanted_before = (instructions_before > 0) ? (size_t)instructions_before : 0;
   u16 current = pc;
-  while (before_addresses.size() < instructions_before && current > scan_start) {
+  while (before_addresses.size() < wanted_before && current > scan_start) {
     bool found = false;
 
     for (u16 addr = current - 3; addr < current; addr++) {
@@ -414,7 +325,7 @@ std::vector<DisassembledInstruction> Debugger::disassemble_around_pc(int instruc
         u8 opcode = read_memory(addr);
 
         const auto& instruction = _cpu.get_instruction((Opcode)opcode);
-        if (instruction.name == nullptr || instruction.name[0] == '\0' || instruction.cycles == 0) {
+        if (instruction.cycles == 0) {
           continue;  // Skip invalid opcodes
         }
 
@@ -471,8 +382,7 @@ void Debugger::check_breakpoints() {
 
 std::string Debugger::format_instruction(u8 opcode, u16 operand, u8 bytes, u16 instruction_addr) const {
   std::stringstream ss;
-  const auto& instruction = _cpu.get_instruction((Opcode)opcode);
-  std::string mnemonic = (instruction.name != nullptr && instruction.name[0] != '\0') ? instruction.name : "???";
+  std::string mnemonic = DebuggerCPU::get_instruction_info(opcode).mnemonic;
 
   // Start with the mnemonic - NO SPACE for immediate mode
   if (opcode == 0xA2 || opcode == 0xA9) {
@@ -488,7 +398,7 @@ std::string Debugger::format_instruction(u8 opcode, u16 operand, u8 bytes, u16 i
   } else if (opcode == 0xA9) {  // LDA #imm
     addr_mode = "IMM";
   } else {
-    addr_mode = _addressing_mode_table[opcode];
+    addr_mode = DebuggerCPU::get_instruction_info(opcode).mode;
   }
 
   // For modes other than implied and immediate opcodes that we've already handled,
@@ -529,7 +439,7 @@ std::string Debugger::format_instruction(u8 opcode, u16 operand, u8 bytes, u16 i
   return ss.str();
 }
 
-std::string Debugger::address_mode_string(u8 opcode) const { return _addressing_mode_table[opcode]; }
+std::string Debugger::address_mode_string(u8 opcode) const { return DebuggerCPU::get_instruction_info(opcode).mode; }
 
 void print_disassembled_instruction(const DisassembledInstruction& instruction) {
   std::cout << "Address:   0x" << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << instruction.address << std::dec
@@ -597,6 +507,24 @@ EMSCRIPTEN_EXPORT void debugger_clear_breakpoints() {
   }
 }
 
+EMSCRIPTEN_EXPORT void debugger_add_watchpoint(u16 address, u8 types) {
+  if (g_debugger) {
+    g_debugger->add_watchpoint(address, types);
+  }
+}
+
+EMSCRIPTEN_EXPORT void debugger_remove_watchpoint(u16 address) {
+  if (g_debugger) {
+    g_debugger->remove_watchpoint(address);
+  }
+}
+
+EMSCRIPTEN_EXPORT void debugger_clear_watchpoints() {
+  if (g_debugger) {
+    g_debugger->clear_watchpoints();
+  }
+}
+
 EMSCRIPTEN_EXPORT u8 debugger_get_register_a() {
   if (g_debugger) {
     return g_debugger->get_register_a();
@@ -653,12 +581,32 @@ EMSCRIPTEN_EXPORT u8 debugger_read_memory(u16 address) {
   return 0;
 }
 
+EMSCRIPTEN_EXPORT u8 debugger_get_open_bus() {
+  if (g_debugger) {
+    return g_debugger->get_open_bus();
+  }
+  return 0;
+}
+
 EMSCRIPTEN_EXPORT void debugger_write_memory(u16 address, u8 value) {
   if (g_debugger) {
     g_debugger->write_memory(address, value);
   }
 }
 
+// One bit per page, page 0 in bit 0 of the first byte, so the memory view
+// only redraws what changed since the last call
+EMSCRIPTEN_EXPORT u8* debugger_fetch_dirty_pages() {
+  static std::array<u8, Bus::PAGE_COUNT / 8> bitmap;
+  bitmap.fill(0);
+  if (g_debugger) {
+    for (u8 page : g_debugger->fetch_dirty_pages()) {
+      bitmap[page >> 3] |= 1 << (page & 0x07);
+    }
+  }
+  return bitmap.data();
+}
+
 EMSCRIPTEN_EXPORT u64 debugger_get_instruction_count() {
   if (g_debugger) {
     return g_debugger->get_instruction_count();
@@ -0,0 +1,62 @@
+#include "../include/flat_bus.h"
+#include <algorithm>
+#include <cstring>
+
+namespace nes {
+
+void FlatBus::read_block(u16 address, u8 *data, size_t length) const {
+  while (length > 0) {
+    const size_t chunk = std::min(length, SIZE - address);
+    std::memcpy(data, _memory.data() + address, chunk);
+    address += chunk;
+    data += chunk;
+    length -= chunk;
+  }
+}
+
+void FlatBus::write_block(u16 address, const u8 *data, size_t length) {
+  while (length > 0) {
+    const size_t chunk = std::min(length, PAGE_SIZE - (address & 0xFF));
+    std::memcpy(_memory.data() + address, data, chunk);
+    if (_code_pages[address >> 8]) {
+      for (size_t i = 0; i < chunk; i++) {
+        notify_code_write(address + i);
+      }
+    }
+    address += chunk;
+    data += chunk;
+    length -= chunk;
+  }
+}
+
+void FlatBus::fill(u16 address, u8 value, size_t length) {
+  while (length > 0) {
+    const size_t chunk = std::min(length, PAGE_SIZE - (address & 0xFF));
+    std::memset(_memory.data() + address, value, chunk);
+    if (_code_pages[address >> 8]) {
+      for (size_t i = 0; i < chunk; i++) {
+        notify_code_write(address + i);
+      }
+    }
+    address += chunk;
+    length -= chunk;
+  }
+}
+
+void FlatBus::add_code_write_listener(CodeWriteListener *listener) { _code_write_listeners.push_back(listener); }
+
+void FlatBus::remove_code_write_listener(CodeWriteListener *listener) {
+  _code_write_listeners.erase(std::remove(_code_write_listeners.begin(), _code_write_listeners.end(), listener),
+                              _code_write_listeners.end());
+
+  // Nobody is caching code any more, writes can skip the check
+  if (_code_write_listeners.empty()) _code_pages.fill(false);
+}
+
+void FlatBus::notify_code_write(u16 address) {
+  for (CodeWriteListener *listener : _code_write_listeners) {
+    listener->code_written(address);
+  }
+}
+
+}  // namespace nes
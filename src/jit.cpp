@@ -0,0 +1,423 @@
+#include "../include/jit.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace nes {
+
+#if defined(__x86_64__) && defined(__linux__)
+
+namespace {
+
+// Just enough of an x86-64 assembler for the block template below
+class Emitter {
+ public:
+  std::vector<u8> code;
+
+  void bytes(std::initializer_list<u8> values) { code.insert(code.end(), values); }
+  void imm8(u8 value) { code.push_back(value); }
+  void imm16(u16 value) { append(&value, sizeof(value)); }
+  void imm32(u32 value) { append(&value, sizeof(value)); }
+  void imm64(u64 value) { append(&value, sizeof(value)); }
+  void address(const void *pointer) { imm64((u64)(uintptr_t)pointer); }
+
+  // ModRM and disp32 for [rbx + offset], reg is the ModRM reg field
+  void cpu_field(u8 reg, size_t offset) {
+    imm8(0x80 | (reg << 3) | 0x03);
+    imm32((u32)offset);
+  }
+
+  // Emits a rel32 jump with a placeholder target, returns where to patch it
+  size_t jump(std::initializer_list<u8> opcode) {
+    bytes(opcode);
+    imm32(0);
+    return code.size() - 4;
+  }
+
+  void patch_to_here(size_t position) {
+    u32 rel = (u32)(code.size() - (position + 4));
+    std::memcpy(&code[position], &rel, sizeof(rel));
+  }
+
+ private:
+  void append(const void *value, size_t size) {
+    const u8 *data = static_cast<const u8 *>(value);
+    code.insert(code.end(), data, data + size);
+  }
+};
+
+// ModRM reg fields
+constexpr u8 EAX = 0;
+constexpr u8 ECX = 1;
+constexpr u8 ESI = 6;
+
+// Inline code for one instruction, with the handler call as its fallback
+class InstructionEmitter {
+ public:
+  InstructionEmitter(Emitter &e, const JitLayout &layout, const JitMemory &memory)
+    : _e(e), _layout(layout), _memory(memory) {}
+
+  // Returns whether anything but the budget has to be checked afterwards
+  bool emit(const JitInstruction &instruction) {
+    if (_memory.open_bus != nullptr) {
+      _e.bytes({0xC6, 0x45, 0x00});  // mov byte [rbp], fetched
+      _e.imm8(instruction.fetched);
+    }
+    _e.bytes({0x66, 0x81, 0x83});  // add word [rbx + pc], length
+    _e.imm32((u32)_layout.pc_offset);
+    _e.imm16(instruction.length);
+
+    switch (instruction.operation) {
+      case JitOperation::LOAD:
+      case JitOperation::STORE:
+        if (_memory.read_pages == nullptr) break;
+        emit_access(instruction);
+        return true;
+      case JitOperation::TRANSFER:
+        add_cycles(instruction.cycles);
+        load_register(EAX, instruction.index);
+        _e.bytes({0x88});  // mov [rbx + reg], al
+        _e.cpu_field(EAX, register_offset(instruction.reg));
+        if (instruction.reg != JitRegister::SP) update_zero_and_negative();
+        return false;
+      case JitOperation::INCREMENT:
+      case JitOperation::DECREMENT:
+        add_cycles(instruction.cycles);
+        _e.bytes({0xFE});  // inc/dec byte [rbx + reg]
+        _e.cpu_field(instruction.operation == JitOperation::INCREMENT ? 0 : 1, register_offset(instruction.reg));
+        load_register(EAX, instruction.reg);
+        update_zero_and_negative();
+        return false;
+      case JitOperation::SET_FLAG:
+        add_cycles(instruction.cycles);
+        _e.bytes({0x80});  // or byte [rbx + status], flag
+        _e.cpu_field(1, _layout.status_offset);
+        _e.imm8(instruction.flag);
+        return false;
+      case JitOperation::CLEAR_FLAG:
+        add_cycles(instruction.cycles);
+        _e.bytes({0x80});  // and byte [rbx + status], ~flag
+        _e.cpu_field(4, _layout.status_offset);
+        _e.imm8((u8)~instruction.flag);
+        return false;
+      case JitOperation::BRANCH: {
+        // One cycle for taking the branch, another if it lands on a different page
+        const u16 next = instruction.address + instruction.length;
+        const u16 target = next + static_cast<int8_t>(instruction.operand);
+        add_cycles(instruction.cycles);
+        _e.bytes({0xF6});  // test byte [rbx + status], flag
+        _e.cpu_field(0, _layout.status_offset);
+        _e.imm8(instruction.flag);
+        const size_t not_taken = _e.jump({0x0F, (u8)(instruction.expected ? 0x84 : 0x85)});  // jz/jnz not_taken
+        set_pc(target);
+        add_cycles(((target ^ next) & 0xFF00) ? 2 : 1);
+        signal_idle_loop(next, target);
+        _e.patch_to_here(not_taken);
+        return false;
+      }
+      case JitOperation::JUMP:
+        add_cycles(instruction.cycles);
+        set_pc(instruction.operand);
+        signal_idle_loop(instruction.address + instruction.length, instruction.operand);
+        return false;
+      case JitOperation::CALL:
+        break;
+    }
+
+    call_handler(instruction);
+    return true;
+  }
+
+ private:
+  Emitter &_e;
+  const JitLayout &_layout;
+  const JitMemory &_memory;
+
+  size_t register_offset(JitRegister reg) const { return _layout.register_offsets[(size_t)reg]; }
+
+  void add_cycles(u8 cycles) {
+    _e.bytes({0x49, 0x83, 0xC4});  // add r12, cycles
+    _e.imm8(cycles);
+  }
+
+  void set_pc(u16 pc) {
+    _e.bytes({0x66, 0xC7});  // mov word [rbx + pc], pc
+    _e.cpu_field(0, _layout.pc_offset);
+    _e.imm16(pc);
+  }
+
+  // Same test as the interpreter's jumps, only the part known now is done at compile time
+  void signal_idle_loop(u16 next, u16 target) {
+    if ((u16)(next - target) > _layout.idle_loop_max_bytes) return;
+    _e.bytes({0x80});  // cmp byte [rbx + armed], 0
+    _e.cpu_field(7, _layout.idle_loop_armed_offset);
+    _e.imm8(0);
+    const size_t disarmed = _e.jump({0x0F, 0x84});  // je done
+    _e.bytes({0x81});                               // cmp dword [rbx + rejected slot], target
+    _e.cpu_field(7, _layout.idle_loop_rejected_offset + (target % _layout.idle_loop_rejected_slots) * sizeof(u32));
+    _e.imm32(target);
+    const size_t rejected = _e.jump({0x0F, 0x84});  // je done
+    _e.bytes({0x80});                               // or byte [rbx + pending interrupts], signal
+    _e.cpu_field(1, _layout.pending_signals_offset);
+    _e.imm8(_layout.idle_loop_signal);
+    _e.patch_to_here(disarmed);
+    _e.patch_to_here(rejected);
+  }
+
+  // movzx r32, byte [rbx + reg]
+  void load_register(u8 destination, JitRegister reg) {
+    _e.bytes({0x0F, 0xB6});
+    _e.cpu_field(destination, register_offset(reg));
+  }
+
+  // Sets N and Z from al, clobbers ecx and edx
+  void update_zero_and_negative() {
+    _e.bytes({0x0F, 0xB6, 0xC8});  // movzx ecx, al
+    _e.bytes({0x80, 0xE1, 0x80});  // and cl, N
+    _e.bytes({0x84, 0xC0});        // test al, al
+    _e.bytes({0x0F, 0x94, 0xC2});  // sete dl
+    _e.bytes({0x00, 0xD2});        // add dl, dl (Z)
+    _e.bytes({0x08, 0xD1});        // or cl, dl
+    _e.bytes({0x80});              // and byte [rbx + status], ~(N | Z)
+    _e.cpu_field(4, _layout.status_offset);
+    _e.imm8((u8)~((u8)Flag::NEGATIVE | (u8)Flag::ZERO));
+    _e.bytes({0x08});  // or [rbx + status], cl
+    _e.cpu_field(ECX, _layout.status_offset);
+  }
+
+  // Stores al into the data bus latch
+  void latch_al() {
+    if (_memory.open_bus != nullptr) _e.bytes({0x88, 0x45, 0x00});  // mov [rbp], al
+  }
+
+  void call_handler(const JitInstruction &instruction) {
+    _e.bytes({0x80});  // or byte [rbx + status], UNUSED
+    _e.cpu_field(1, _layout.status_offset);
+    _e.imm8((u8)Flag::UNUSED);
+    _e.bytes({0xC6});  // mov byte [rbx + cycles], base cycles
+    _e.cpu_field(0, _layout.cycles_offset);
+    _e.imm8(instruction.cycles);
+
+    _e.bytes({0x48, 0x89, 0xDF});  // mov rdi, rbx
+    _e.bytes({0xBE});              // mov esi, operand
+    _e.imm32(instruction.operand);
+    _e.bytes({0x48, 0xB8});  // mov rax, handler
+    _e.address(reinterpret_cast<const void *>(instruction.handler));
+    _e.bytes({0xFF, 0xD0});  // call rax
+
+    _e.bytes({0x0F, 0xB6});  // movzx eax, byte [rbx + cycles]
+    _e.cpu_field(EAX, _layout.cycles_offset);
+    _e.bytes({0x49, 0x01, 0xC4});  // add r12, rax
+    _e.bytes({0xC6});              // mov byte [rbx + cycles], 0
+    _e.cpu_field(0, _layout.cycles_offset);
+    _e.imm8(0);
+  }
+
+  // LOAD or STORE through the page tables. Pages that are not plain memory
+  // (devices, watched pages) and stores into code pages take the handler.
+  void emit_access(const JitInstruction &instruction) {
+    const bool load = instruction.operation == JitOperation::LOAD;
+    std::vector<size_t> slow;
+
+    if (instruction.addressing == JitAddressing::FIXED) {
+      const u8 page = instruction.operand >> 8;
+      const u32 offset = instruction.operand & 0xFF;
+      if (!load) {
+        _e.bytes({0xA0});  // movabs al, [code_pages + page]
+        _e.address(&_memory.code_pages[page]);
+        _e.bytes({0x84, 0xC0});                      // test al, al
+        slow.push_back(_e.jump({0x0F, 0x85}));       // jnz slow
+      }
+      _e.bytes({0x48, 0xA1});  // movabs rax, [pages + page]
+      _e.address(load ? (const void *)&_memory.read_pages[page] : (const void *)&_memory.write_pages[page]);
+      _e.bytes({0x48, 0x85, 0xC0});           // test rax, rax
+      slow.push_back(_e.jump({0x0F, 0x84}));  // jz slow
+      add_cycles(instruction.cycles);
+      if (load) {
+        _e.bytes({0x0F, 0xB6, 0x80});  // movzx eax, byte [rax + offset]
+        _e.imm32(offset);
+      } else {
+        load_register(ECX, instruction.reg);
+        _e.bytes({0x88, 0x88});  // mov [rax + offset], cl
+        _e.imm32(offset);
+        _e.bytes({0x89, 0xC8});  // mov eax, ecx
+        latch_al();
+        if (_memory.dirty_pages != nullptr) {
+          _e.bytes({0xB0, 0x01});  // mov al, 1
+          _e.bytes({0xA2});        // movabs [dirty_pages + page], al
+          _e.address(&_memory.dirty_pages[page]);
+        }
+      }
+    } else {
+      load_register(ECX, instruction.index);
+      const bool extra_cycle = load && instruction.extra_cycle;
+      if (instruction.addressing == JitAddressing::ZERO_PAGE_INDEXED) {
+        _e.bytes({0x80, 0xC1});  // add cl, operand
+        _e.imm8((u8)instruction.operand);
+      } else {
+        _e.bytes({0x81, 0xC1});  // add ecx, operand
+        _e.imm32(instruction.operand);
+        if (extra_cycle) {
+          _e.bytes({0x31, 0xF6});  // xor esi, esi
+          _e.bytes({0x89, 0xC8});  // mov eax, ecx
+          _e.bytes({0x35});        // xor eax, operand
+          _e.imm32(instruction.operand);
+          _e.bytes({0xC1, 0xE8, 0x08});        // shr eax, 8
+          _e.bytes({0x40, 0x0F, 0x95, 0xC6});  // setnz sil (page crossed)
+        }
+        _e.bytes({0x0F, 0xB7, 0xC9});  // movzx ecx, cx
+      }
+      _e.bytes({0x89, 0xCA});        // mov edx, ecx
+      _e.bytes({0xC1, 0xEA, 0x08});  // shr edx, 8
+
+      if (!load) {
+        _e.bytes({0x48, 0xB8});  // mov rax, code_pages
+        _e.address(_memory.code_pages);
+        _e.bytes({0x80, 0x3C, 0x10, 0x00});     // cmp byte [rax + rdx], 0
+        slow.push_back(_e.jump({0x0F, 0x85}));  // jne slow
+      }
+      _e.bytes({0x48, 0xB8});  // mov rax, pages
+      _e.address(load ? (const void *)_memory.read_pages : (const void *)_memory.write_pages);
+      _e.bytes({0x48, 0x8B, 0x04, 0xD0});     // mov rax, [rax + rdx * 8]
+      _e.bytes({0x48, 0x85, 0xC0});           // test rax, rax
+      slow.push_back(_e.jump({0x0F, 0x84}));  // jz slow
+      add_cycles(instruction.cycles);
+      _e.bytes({0x0F, 0xB6, 0xC9});  // movzx ecx, cl
+      if (load) {
+        _e.bytes({0x0F, 0xB6, 0x04, 0x08});  // movzx eax, byte [rax + rcx]
+        if (extra_cycle) _e.bytes({0x49, 0x01, 0xF4});  // add r12, rsi
+      } else {
+        load_register(ESI, instruction.reg);
+        _e.bytes({0x40, 0x88, 0x34, 0x08});  // mov [rax + rcx], sil
+        _e.bytes({0x89, 0xF0});              // mov eax, esi
+        latch_al();
+        if (_memory.dirty_pages != nullptr) {
+          _e.bytes({0x48, 0xB8});  // mov rax, dirty_pages
+          _e.address(_memory.dirty_pages);
+          _e.bytes({0xC6, 0x04, 0x10, 0x01});  // mov byte [rax + rdx], 1
+        }
+      }
+    }
+
+    if (load) {
+      latch_al();
+      _e.bytes({0x88});  // mov [rbx + reg], al
+      _e.cpu_field(EAX, register_offset(instruction.reg));
+      update_zero_and_negative();
+    }
+
+    const size_t done = _e.jump({0xE9});  // jmp done
+    for (size_t position : slow) {
+      _e.patch_to_here(position);
+    }
+    call_handler(instruction);
+    _e.patch_to_here(done);
+  }
+};
+
+}  // namespace
+
+JitCompiler::JitCompiler() {
+  void *arena = mmap(nullptr, ARENA_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (arena != MAP_FAILED) _arena = static_cast<u8 *>(arena);
+}
+
+JitCompiler::~JitCompiler() {
+  if (_arena != nullptr) munmap(_arena, ARENA_SIZE);
+}
+
+// Register use inside a block:
+//   rbx = cpu, r12 = elapsed, r13 = budget, r14 = generation pointer, r15d = generation on entry,
+//   rbp = data bus latch
+// eax, ecx, edx and esi are scratch for the inline instructions.
+JitBlockFunction JitCompiler::compile(const JitLayout &layout, const JitMemory &memory, const JitInstruction *instructions,
+                                      size_t count) {
+  if (_arena == nullptr) return nullptr;
+
+  Emitter e;
+  InstructionEmitter instruction_emitter(e, layout, memory);
+  std::vector<size_t> exits;
+
+  // Prologue: six pushes and eight bytes keep the stack 16-byte aligned for the handler calls
+  e.bytes({0x55});                    // push rbp
+  e.bytes({0x53});                    // push rbx
+  e.bytes({0x41, 0x54});              // push r12
+  e.bytes({0x41, 0x55});              // push r13
+  e.bytes({0x41, 0x56});              // push r14
+  e.bytes({0x41, 0x57});              // push r15
+  e.bytes({0x48, 0x89, 0xFB});        // mov rbx, rdi
+  e.bytes({0x49, 0x89, 0xF4});        // mov r12, rsi
+  e.bytes({0x49, 0x89, 0xD5});        // mov r13, rdx
+  e.bytes({0x49, 0x89, 0xCE});        // mov r14, rcx
+  e.bytes({0x45, 0x8B, 0x3E});        // mov r15d, [r14]
+  e.bytes({0x48, 0x83, 0xEC, 0x08});  // sub rsp, 8
+  e.bytes({0x48, 0xBD});              // mov rbp, open_bus
+  e.address(memory.open_bus);
+
+  // Handlers set it again before each call, inline instructions never clear it
+  e.bytes({0x80});  // or byte [rbx + status], UNUSED
+  e.cpu_field(1, layout.status_offset);
+  e.imm8((u8)Flag::UNUSED);
+
+  for (size_t i = 0; i < count; i++) {
+    const bool may_signal = instruction_emitter.emit(instructions[i]);
+
+    if (i + 1 < count) {
+      e.bytes({0x4D, 0x39, 0xEC});            // cmp r12, r13
+      exits.push_back(e.jump({0x0F, 0x83}));  // jae exit
+
+      // Only a handler can write code or raise a signal
+      if (may_signal) {
+        e.bytes({0x45, 0x39, 0x3E});            // cmp [r14], r15d
+        exits.push_back(e.jump({0x0F, 0x85}));  // jne exit
+        e.bytes({0x80, 0xBB});                  // cmp byte [rbx + pending interrupts], 0
+        e.imm32((u32)layout.pending_signals_offset);
+        e.imm8(0);
+        exits.push_back(e.jump({0x0F, 0x85}));  // jne exit
+      }
+    }
+  }
+
+  for (size_t exit : exits) {
+    e.patch_to_here(exit);
+  }
+  e.bytes({0x4C, 0x89, 0xE0});        // mov rax, r12
+  e.bytes({0x48, 0x83, 0xC4, 0x08});  // add rsp, 8
+  e.bytes({0x41, 0x5F});              // pop r15
+  e.bytes({0x41, 0x5E});              // pop r14
+  e.bytes({0x41, 0x5D});              // pop r13
+  e.bytes({0x41, 0x5C});              // pop r12
+  e.bytes({0x5B});                    // pop rbx
+  e.bytes({0x5D});                    // pop rbp
+  e.bytes({0xC3});                    // ret
+
+  if (_used + e.code.size() > ARENA_SIZE) return nullptr;
+
+  // Never writable and executable at the same time
+  if (mprotect(_arena, ARENA_SIZE, PROT_READ | PROT_WRITE) != 0) return nullptr;
+  u8 *entry = _arena + _used;
+  std::memcpy(entry, e.code.data(), e.code.size());
+  _used += (e.code.size() + 15) & ~(size_t)15;
+  if (mprotect(_arena, ARENA_SIZE, PROT_READ | PROT_EXEC) != 0) return nullptr;
+
+  return reinterpret_cast<JitBlockFunction>(entry);
+}
+
+#else
+
+JitCompiler::JitCompiler() {}
+
+JitCompiler::~JitCompiler() {}
+
+JitBlockFunction JitCompiler::compile(const JitLayout &layout, const JitMemory &memory, const JitInstruction *instructions,
+                                      size_t count) {
+  return nullptr;
+}
+
+#endif
+
+}  // namespace nes
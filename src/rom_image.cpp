@@ -0,0 +1,76 @@
+#include "../include/rom_image.h"
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nes {
+
+RomImage::RomImage(std::vector<u8> bytes)
+  : _bytes(std::move(bytes)), _data(_bytes.data()), _size(_bytes.size()) {}
+
+RomImage::~RomImage() { release(); }
+
+// A moved vector keeps its buffer, so _data stays valid either way
+RomImage::RomImage(RomImage &&other) noexcept
+  : _bytes(std::move(other._bytes)), _data(other._data), _size(other._size), _mapped(other._mapped) {
+  other._data = nullptr;
+  other._size = 0;
+  other._mapped = false;
+}
+
+RomImage &RomImage::operator=(RomImage &&other) noexcept {
+  if (this != &other) {
+    release();
+    _bytes = std::move(other._bytes);
+    _data = other._data;
+    _size = other._size;
+    _mapped = other._mapped;
+    other._data = nullptr;
+    other._size = 0;
+    other._mapped = false;
+  }
+  return *this;
+}
+
+RomImage RomImage::open(const std::string &path) {
+#if defined(__unix__) || defined(__APPLE__)
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return RomImage();
+
+  RomImage image;
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    void *mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) {
+      image._data = static_cast<const u8 *>(mapping);
+      image._size = (size_t)info.st_size;
+      image._mapped = true;
+    }
+  }
+  ::close(fd);  // The mapping keeps the file alive
+  if (image._mapped) return image;
+#endif
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return RomImage();
+  return RomImage(std::vector<u8>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()));
+}
+
+void RomImage::release() {
+#if defined(__unix__) || defined(__APPLE__)
+  if (_mapped) munmap(const_cast<u8 *>(_data), _size);
+#endif
+  _bytes.clear();
+  _data = nullptr;
+  _size = 0;
+  _mapped = false;
+}
+
+}  // namespace nes
@@ -0,0 +1,34 @@
+#include "../include/scheduler.h"
+
+namespace nes {
+
+Scheduler::EventId Scheduler::schedule(const u64 cycle, Callback callback) {
+  const EventId id = _next_id++;
+  _queue.push({.cycle = cycle, .id = id});
+  _callbacks.emplace(id, std::move(callback));
+  return id;
+}
+
+void Scheduler::cancel(const EventId id) { _callbacks.erase(id); }
+
+u64 Scheduler::get_next_event_cycle() {
+  // Drop cancelled events lazily as they reach the top
+  while (!_queue.empty() && _callbacks.count(_queue.top().id) == 0) {
+    _queue.pop();
+  }
+  return _queue.empty() ? NO_EVENT : _queue.top().cycle;
+}
+
+void Scheduler::dispatch_due_events() {
+  while (get_next_event_cycle() <= _cycle) {
+    const EventId id = _queue.top().id;
+    _queue.pop();
+
+    auto it = _callbacks.find(id);
+    Callback callback = std::move(it->second);
+    _callbacks.erase(it);
+    callback();
+  }
+}
+
+}  // namespace nes
@@ -7,7 +7,7 @@
 #endif
 
 nes::Bus g_bus;
-nes::CPU g_cpu(g_bus);
+nes::DebuggerCPU g_cpu(g_bus);
 nes::Debugger g_debugger(g_cpu, g_bus);
 
 #ifdef __EMSCRIPTEN__
@@ -0,0 +1,294 @@
+#include <gtest/gtest.h>
+#include "../include/bus.h"
+#include "../include/cpu.h"
+#include "types.h"
+
+class CPU65C02Test : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    cpu.reset();
+    cpu.set_pc(0x0200);
+  }
+
+  void load(nes::u16 address, std::initializer_list<nes::u8> bytes) {
+    bus.write_block(address, bytes.begin(), bytes.size());
+  }
+
+  nes::Bus bus;
+  nes::CPU65C02 cpu{bus};
+};
+
+TEST_F(CPU65C02Test, zero_page_indirect_load_and_store) {
+  load(0x0010, {0x34, 0x03});  // Pointer to $0334
+  bus.write(0x0334, 0x5A);
+  load(0x0200, {(nes::u8)nes::Opcode::LDA_ZPI, 0x10, (nes::u8)nes::Opcode::STA_ZPI, 0x12});
+  load(0x0012, {0x00, 0x04});  // Pointer to $0400
+
+  EXPECT_EQ(cpu.step_instruction(), 5);
+  EXPECT_EQ(cpu.get_accumulator(), 0x5A);
+  EXPECT_EQ(cpu.step_instruction(), 5);
+  EXPECT_EQ(bus.read(0x0400), 0x5A);
+}
+
+TEST_F(CPU65C02Test, zero_page_indirect_pointer_wraps_in_zero_page) {
+  load(0x00FF, {0x00});
+  bus.write(0x0000, 0x03);
+  bus.write(0x0300, 0x77);
+  load(0x0200, {(nes::u8)nes::Opcode::LDA_ZPI, 0xFF});
+
+  cpu.step_instruction();
+  EXPECT_EQ(cpu.get_accumulator(), 0x77);
+}
+
+TEST_F(CPU65C02Test, bit_immediate_only_sets_zero) {
+  load(0x0200, {(nes::u8)nes::Opcode::LDA_IMM, 0x0F, (nes::u8)nes::Opcode::BIT_IMM, 0xC0});
+
+  cpu.step_instruction();
+  cpu.set_flag(nes::Flag::NEGATIVE, true);
+  cpu.set_flag(nes::Flag::OVERFLOW_, false);
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::ZERO));
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::NEGATIVE));
+  EXPECT_FALSE(cpu.get_flag(nes::Flag::OVERFLOW_));
+}
+
+TEST_F(CPU65C02Test, bit_indexed_sets_negative_and_overflow) {
+  bus.write(0x0015, 0xC0);
+  load(0x0200, {(nes::u8)nes::Opcode::LDX_IMM, 0x05, (nes::u8)nes::Opcode::LDA_IMM, 0xFF, (nes::u8)nes::Opcode::BIT_ZPX, 0x10});
+
+  cpu.step_instruction();
+  cpu.step_instruction();
+  EXPECT_EQ(cpu.step_instruction(), 4);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::NEGATIVE));
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::OVERFLOW_));
+  EXPECT_FALSE(cpu.get_flag(nes::Flag::ZERO));
+}
+
+TEST_F(CPU65C02Test, inc_and_dec_accumulator) {
+  load(0x0200, {(nes::u8)nes::Opcode::LDA_IMM, 0xFF, (nes::u8)nes::Opcode::INC_ACC, (nes::u8)nes::Opcode::DEC_ACC});
+
+  cpu.step_instruction();
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.get_accumulator(), 0x00);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::ZERO));
+
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.get_accumulator(), 0xFF);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::NEGATIVE));
+}
+
+TEST_F(CPU65C02Test, stz_stores_zero) {
+  load(0x0010, {0x11, 0x22});
+  load(0x0300, {0x33, 0x44});
+  load(0x0200, {(nes::u8)nes::Opcode::LDX_IMM, 0x01,
+                (nes::u8)nes::Opcode::STZ_ZPG, 0x10,
+                (nes::u8)nes::Opcode::STZ_ZPX, 0x10,
+                (nes::u8)nes::Opcode::STZ_ABS, 0x00, 0x03,
+                (nes::u8)nes::Opcode::STZ_ABX, 0x00, 0x03});
+
+  cpu.step_instruction();
+  EXPECT_EQ(cpu.step_instruction(), 3);
+  EXPECT_EQ(cpu.step_instruction(), 4);
+  EXPECT_EQ(cpu.step_instruction(), 4);
+  EXPECT_EQ(cpu.step_instruction(), 5);
+  EXPECT_EQ(bus.read(0x0010), 0x00);
+  EXPECT_EQ(bus.read(0x0011), 0x00);
+  EXPECT_EQ(bus.read(0x0300), 0x00);
+  EXPECT_EQ(bus.read(0x0301), 0x00);
+}
+
+TEST_F(CPU65C02Test, tsb_and_trb_set_and_clear_bits) {
+  bus.write(0x0010, 0x30);
+  load(0x0200, {(nes::u8)nes::Opcode::LDA_IMM, 0x0C,
+                (nes::u8)nes::Opcode::TSB_ZPG, 0x10,
+                (nes::u8)nes::Opcode::TRB_ZPG, 0x10});
+
+  cpu.step_instruction();
+  EXPECT_EQ(cpu.step_instruction(), 5);
+  EXPECT_EQ(bus.read(0x0010), 0x3C);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::ZERO));  // $0C AND $30
+
+  EXPECT_EQ(cpu.step_instruction(), 5);
+  EXPECT_EQ(bus.read(0x0010), 0x30);
+  EXPECT_FALSE(cpu.get_flag(nes::Flag::ZERO));  // $0C AND $3C
+  EXPECT_EQ(cpu.get_accumulator(), 0x0C);
+}
+
+TEST_F(CPU65C02Test, push_and_pull_x_and_y) {
+  load(0x0200, {(nes::u8)nes::Opcode::LDX_IMM, 0x80,
+                (nes::u8)nes::Opcode::LDY_IMM, 0x00,
+                (nes::u8)nes::Opcode::PHX_IMP,
+                (nes::u8)nes::Opcode::PHY_IMP,
+                (nes::u8)nes::Opcode::PLX_IMP,
+                (nes::u8)nes::Opcode::PLY_IMP});
+  const nes::u8 sp = cpu.get_sp();
+
+  cpu.step_instruction();
+  cpu.step_instruction();
+  EXPECT_EQ(cpu.step_instruction(), 3);
+  EXPECT_EQ(cpu.step_instruction(), 3);
+  EXPECT_EQ(cpu.get_sp(), (nes::u8)(sp - 2));
+
+  // Pulled in reverse, so X and Y swap
+  EXPECT_EQ(cpu.step_instruction(), 4);
+  EXPECT_EQ(cpu.get_x(), 0x00);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::ZERO));
+  EXPECT_EQ(cpu.step_instruction(), 4);
+  EXPECT_EQ(cpu.get_y(), 0x80);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::NEGATIVE));
+  EXPECT_EQ(cpu.get_sp(), sp);
+}
+
+TEST_F(CPU65C02Test, bra_always_branches) {
+  load(0x0200, {(nes::u8)nes::Opcode::BRA_REL, 0x10});
+  EXPECT_EQ(cpu.step_instruction(), 3);
+  EXPECT_EQ(cpu.get_pc(), 0x0212);
+
+  // Into another page costs one more cycle
+  cpu.set_pc(0x02F0);
+  load(0x02F0, {(nes::u8)nes::Opcode::BRA_REL, 0x20});
+  EXPECT_EQ(cpu.step_instruction(), 4);
+  EXPECT_EQ(cpu.get_pc(), 0x0312);
+}
+
+TEST_F(CPU65C02Test, jmp_absolute_indexed_indirect) {
+  load(0x0304, {0x00, 0x05});  // Table entry 2 points at $0500
+  load(0x0200, {(nes::u8)nes::Opcode::LDX_IMM, 0x04, (nes::u8)nes::Opcode::JMP_AIX, 0x00, 0x03});
+
+  cpu.step_instruction();
+  EXPECT_EQ(cpu.step_instruction(), 6);
+  EXPECT_EQ(cpu.get_pc(), 0x0500);
+}
+
+TEST_F(CPU65C02Test, jmp_indirect_reads_across_the_page) {
+  bus.write(0x03FF, 0x00);
+  bus.write(0x0400, 0x05);
+  bus.write(0x0300, 0x06);  // Where the NMOS 6502 would take the high byte from
+  load(0x0200, {(nes::u8)nes::Opcode::JMP_IND, 0xFF, 0x03});
+
+  EXPECT_EQ(cpu.step_instruction(), 6);
+  EXPECT_EQ(cpu.get_pc(), 0x0500);
+}
+
+TEST_F(CPU65C02Test, nmos_jmp_indirect_keeps_the_page_wrap) {
+  nes::CPU6502 nmos{bus};
+  nmos.set_pc(0x0200);
+  bus.write(0x03FF, 0x00);
+  bus.write(0x0400, 0x05);
+  bus.write(0x0300, 0x06);
+  load(0x0200, {(nes::u8)nes::Opcode::JMP_IND, 0xFF, 0x03});
+
+  EXPECT_EQ(nmos.step_instruction(), 5);
+  EXPECT_EQ(nmos.get_pc(), 0x0600);
+}
+
+TEST_F(CPU65C02Test, brk_clears_decimal_mode) {
+  cpu.set_flag(nes::Flag::DECIMAL, true);
+  load(0x0200, {(nes::u8)nes::Opcode::BRK_IMP, 0x00});
+
+  cpu.step_instruction();
+  EXPECT_FALSE(cpu.get_flag(nes::Flag::DECIMAL));
+  EXPECT_TRUE(bus.read(0x0100 + (nes::u8)(cpu.get_sp() + 1)) & (nes::u8)nes::Flag::DECIMAL);
+}
+
+TEST_F(CPU65C02Test, irq_clears_decimal_mode) {
+  cpu.set_flag(nes::Flag::DECIMAL, true);
+  cpu.set_flag(nes::Flag::INTERRUPT_DISABLE, false);
+  cpu.set_irq_line(true);
+
+  EXPECT_EQ(cpu.step_instruction(), 7);
+  EXPECT_FALSE(cpu.get_flag(nes::Flag::DECIMAL));
+}
+
+TEST_F(CPU65C02Test, every_opcode_is_defined) {
+  for (int opcode = 0; opcode < 0x100; opcode++) {
+    EXPECT_NE(cpu.get_instruction((nes::Opcode)opcode).cycles, 0) << "opcode " << opcode;
+  }
+}
+
+TEST_F(CPU65C02Test, undefined_opcodes_are_nops) {
+  struct Case {
+    nes::u8 opcode;
+    nes::u8 length;
+    nes::u8 cycles;
+  };
+  // LAX zp on the NMOS parts, one byte here
+  const Case cases[] = {{0xA7, 1, 1}, {0x03, 1, 1}, {0xCB, 1, 1}, {0xDB, 1, 1}, {0xFF, 1, 1},
+                        {0x02, 2, 2}, {0xE2, 2, 2}, {0x44, 2, 3}, {0x54, 2, 4}, {0xF4, 2, 4},
+                        {0x5C, 3, 8}, {0xDC, 3, 4}, {0xFC, 3, 4}};
+  for (const Case &test : cases) {
+    cpu.set_pc(0x0200);
+    const nes::u8 a = cpu.get_accumulator();
+    const nes::u8 status = cpu.get_status();
+    load(0x0200, {test.opcode, 0x10, 0x20});
+
+    EXPECT_EQ(cpu.step_instruction(), test.cycles) << "opcode " << (int)test.opcode;
+    EXPECT_EQ(cpu.get_pc(), 0x0200 + test.length) << "opcode " << (int)test.opcode;
+    EXPECT_EQ(cpu.get_accumulator(), a);
+    EXPECT_EQ(cpu.get_status(), status);
+    EXPECT_EQ(cpu.get_fault(), nes::Fault::NONE);
+  }
+  EXPECT_STREQ(nes::CPU65C02::get_instruction_info(0xDC).mode, "ABS");
+}
+
+TEST_F(CPU65C02Test, shift_absolute_indexed_only_pays_for_page_crossing) {
+  load(0x0200, {(nes::u8)nes::Opcode::LDX_IMM, 0x05,
+                (nes::u8)nes::Opcode::ASL_ABX, 0x10, 0x03,
+                (nes::u8)nes::Opcode::LDX_IMM, 0x20,
+                (nes::u8)nes::Opcode::ROR_ABX, 0xF0, 0x03});
+  bus.write(0x0315, 0x81);
+
+  cpu.step_instruction();
+  EXPECT_EQ(cpu.step_instruction(), 6);
+  EXPECT_EQ(bus.read(0x0315), 0x02);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::CARRY));
+
+  cpu.step_instruction();
+  EXPECT_EQ(cpu.step_instruction(), 7);
+  EXPECT_EQ(cpu.get_pc(), 0x020A);
+
+  // The NMOS parts always take the extra cycle
+  EXPECT_EQ(nes::CPU(bus).get_instruction(nes::Opcode::ASL_ABX).cycles, 7);
+  EXPECT_EQ(cpu.get_instruction(nes::Opcode::LSR_ABX).cycles, 6);
+}
+
+TEST_F(CPU65C02Test, instruction_info_follows_the_variant) {
+  EXPECT_STREQ(nes::CPU65C02::get_instruction_info(0x80).mnemonic, "BRA");
+  EXPECT_STREQ(nes::CPU65C02::get_instruction_info(0xB2).mode, "ZPI");
+  EXPECT_STREQ(nes::CPU::get_instruction_info(0x80).mnemonic, "NOP");
+  EXPECT_STREQ(nes::CPU::get_instruction_info(0xB2).mnemonic, "???");
+}
+
+TEST_F(CPU65C02Test, block_cache_matches_interpreter) {
+  // Walks a table through (zp), looping with BRA and leaving through JMP (abs,X)
+  //   0200  LDX #$04
+  //   0202  LDA ($10)
+  //   0204  INC $10
+  //   0206  STZ $20
+  //   0208  DEX
+  //   0209  BEQ $020D
+  //   020B  BRA $0202
+  //   020D  JMP ($0300,X)
+  load(0x0010, {0x00, 0x04});
+  load(0x0400, {1, 2, 3, 4});
+  load(0x0300, {0x00, 0x05});  // X is 0 by the time the JMP runs
+  load(0x0200, {(nes::u8)nes::Opcode::LDX_IMM, 0x04,
+                (nes::u8)nes::Opcode::LDA_ZPI, 0x10,
+                (nes::u8)nes::Opcode::INC_ZPG, 0x10,
+                (nes::u8)nes::Opcode::STZ_ZPG, 0x20,
+                (nes::u8)nes::Opcode::DEX_IMP,
+                (nes::u8)nes::Opcode::BEQ_REL, 0x02,
+                (nes::u8)nes::Opcode::BRA_REL, 0xF5,
+                (nes::u8)nes::Opcode::JMP_AIX, 0x00, 0x03});
+
+  nes::u64 cycles = 0;
+  while (cpu.get_pc() != 0x0500) cycles += cpu.step_instruction();
+  const nes::u8 a = cpu.get_accumulator();
+
+  cpu.set_pc(0x0200);
+  bus.write(0x0010, 0x00);
+  ASSERT_TRUE(cpu.set_block_cache_enabled(true));
+  EXPECT_EQ(cpu.run(cycles), cycles);
+  EXPECT_EQ(cpu.get_pc(), 0x0500);
+  EXPECT_EQ(cpu.get_accumulator(), a);
+}
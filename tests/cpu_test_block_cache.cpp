@@ -0,0 +1,445 @@
+#include "cpu_test_base.h"
+
+class CPUBlockCacheTest : public CPUTestBase {
+ protected:
+  void SetUp() override {
+    cpu.reset();
+    cpu.set_pc(0x0200);
+    ASSERT_TRUE(cpu.set_block_cache_enabled(true));
+  }
+
+  void load(nes::u16 address, std::initializer_list<nes::u8> bytes) {
+    bus.write_block(address, bytes.begin(), bytes.size());
+  }
+};
+
+TEST_F(CPUBlockCacheTest, only_enabled_on_memory_that_reports_code_writes) {
+  nes::DynamicCPU dynamic_cpu{bus};
+  EXPECT_FALSE(dynamic_cpu.set_block_cache_enabled(true));
+  EXPECT_FALSE(dynamic_cpu.is_block_cache_enabled());
+
+  EXPECT_TRUE(cpu.is_block_cache_enabled());
+  EXPECT_FALSE(cpu.set_block_cache_enabled(false));
+}
+
+TEST_F(CPUBlockCacheTest, run_stops_at_instruction_boundary_inside_block) {
+  for (nes::u16 addr = 0x0200; addr < 0x0210; addr++) {
+    bus.write(addr, (nes::u8)(nes::Opcode::INX_IMP));
+  }
+
+  EXPECT_EQ(cpu.run(5), 6);
+  EXPECT_EQ(cpu.get_x(), 3);
+  EXPECT_EQ(cpu.get_pc(), 0x0203);
+  EXPECT_EQ(cpu.get_remaining_cycles(), 0);
+
+  // Entering the middle of an already cached run of code
+  EXPECT_EQ(cpu.run(4), 4);
+  EXPECT_EQ(cpu.get_x(), 5);
+  EXPECT_EQ(cpu.get_pc(), 0x0205);
+}
+
+TEST_F(CPUBlockCacheTest, cached_loop_matches_interpreter) {
+  // Copy loop: LDA $0300,X / STA $0400,X / INX / CPX #$10 / BNE
+  load(0x0200, {(nes::u8)(nes::Opcode::LDX_IMM), 0x00,
+                (nes::u8)(nes::Opcode::LDA_ABX), 0xF8, 0x02,
+                (nes::u8)(nes::Opcode::STA_ABX), 0x00, 0x04,
+                (nes::u8)(nes::Opcode::INX_IMP),
+                (nes::u8)(nes::Opcode::CPX_IMM), 0x10,
+                (nes::u8)(nes::Opcode::BNE_REL), 0xF5});
+  for (nes::u8 i = 0; i < 0x10; i++) {
+    bus.write(0x02F8 + i, 0xA0 + i);
+  }
+
+  nes::CPU interpreter{bus};
+  interpreter.set_pc(0x0200);
+
+  // $02F8,X crosses into page $03 half way through, so the penalty must still apply
+  nes::u64 cycles = 0;
+  while (interpreter.get_pc() != 0x020D) {
+    cycles += interpreter.step_instruction();
+  }
+  EXPECT_EQ(cpu.run(cycles), cycles);
+  EXPECT_EQ(cpu.get_pc(), interpreter.get_pc());
+  EXPECT_EQ(cpu.get_x(), 0x10);
+  EXPECT_EQ(cpu.get_accumulator(), interpreter.get_accumulator());
+  EXPECT_EQ(cpu.get_status(), interpreter.get_status());
+  EXPECT_EQ(bus.read(0x0400 + 0x0F), 0xAF);
+}
+
+TEST_F(CPUBlockCacheTest, self_modifying_code_invalidates_running_block) {
+  // 0200 LDA #$01 / INC $0201 / JMP $0200, each pass loads one more than the last
+  load(0x0200, {(nes::u8)(nes::Opcode::LDA_IMM), 0x01,
+                (nes::u8)(nes::Opcode::INC_ABS), 0x01, 0x02,
+                (nes::u8)(nes::Opcode::JMP_ABS), 0x00, 0x02});
+
+  EXPECT_EQ(cpu.run(11), 11);
+  EXPECT_EQ(cpu.get_accumulator(), 0x01);
+  EXPECT_EQ(cpu.run(11), 11);
+  EXPECT_EQ(cpu.get_accumulator(), 0x02);
+  EXPECT_EQ(cpu.run(11), 11);
+  EXPECT_EQ(cpu.get_accumulator(), 0x03);
+}
+
+TEST_F(CPUBlockCacheTest, bus_write_invalidates_cached_block) {
+  load(0x0200, {(nes::u8)(nes::Opcode::LDA_IMM), 0x11,
+                (nes::u8)(nes::Opcode::JMP_ABS), 0x00, 0x02});
+
+  cpu.run(5);
+  EXPECT_EQ(cpu.get_accumulator(), 0x11);
+
+  bus.write(0x0201, 0x22);
+  cpu.run(5);
+  EXPECT_EQ(cpu.get_accumulator(), 0x22);
+
+  // $0A01 mirrors $0201
+  bus.write(0x0A01, 0x33);
+  cpu.run(5);
+  EXPECT_EQ(cpu.get_accumulator(), 0x33);
+}
+
+TEST_F(CPUBlockCacheTest, data_writes_next_to_code_keep_running) {
+  // 0200 INX / STX $0280 / JMP $0200, with the data on the code page
+  load(0x0200, {(nes::u8)(nes::Opcode::INX_IMP),
+                (nes::u8)(nes::Opcode::STX_ABS), 0x80, 0x02,
+                (nes::u8)(nes::Opcode::JMP_ABS), 0x00, 0x02});
+
+  EXPECT_EQ(cpu.run(9 * 4), 9 * 4);
+  EXPECT_EQ(cpu.get_x(), 4);
+  EXPECT_EQ(bus.read(0x0280), 4);
+  EXPECT_EQ(cpu.get_pc(), 0x0200);
+}
+
+TEST_F(CPUBlockCacheTest, jit_matches_interpreter) {
+  if (!cpu.set_jit_enabled(true)) GTEST_SKIP() << "JIT not supported on this platform";
+
+  // 0200 LDX #$00 / 0202 INY / TYA / ADC #$03 / STA $0300,X / INX / BNE $0202
+  load(0x0200, {(nes::u8)(nes::Opcode::LDX_IMM), 0x00,
+                (nes::u8)(nes::Opcode::INY_IMP),
+                (nes::u8)(nes::Opcode::TYA_IMP),
+                (nes::u8)(nes::Opcode::ADC_IMM), 0x03,
+                (nes::u8)(nes::Opcode::STA_ABX), 0x00, 0x03,
+                (nes::u8)(nes::Opcode::INX_IMP),
+                (nes::u8)(nes::Opcode::BNE_REL), 0xF5});
+
+  nes::CPU interpreter{bus};
+  interpreter.set_pc(0x0200);
+
+  // Stop part way through so the budget check inside translated code is exercised
+  for (nes::u64 budget : {100, 1001, 2500}) {
+    EXPECT_EQ(cpu.run(budget), interpreter.run(budget));
+    EXPECT_EQ(cpu.get_pc(), interpreter.get_pc());
+    EXPECT_EQ(cpu.get_accumulator(), interpreter.get_accumulator());
+    EXPECT_EQ(cpu.get_x(), interpreter.get_x());
+    EXPECT_EQ(cpu.get_y(), interpreter.get_y());
+    EXPECT_EQ(cpu.get_status(), interpreter.get_status());
+  }
+}
+
+TEST_F(CPUBlockCacheTest, jit_self_modifying_code_falls_back) {
+  if (!cpu.set_jit_enabled(true)) GTEST_SKIP() << "JIT not supported on this platform";
+
+  // 0200 LDA #$01 / INC $0201 / JMP $0200, rewritten on every pass
+  load(0x0200, {(nes::u8)(nes::Opcode::LDA_IMM), 0x01,
+                (nes::u8)(nes::Opcode::INC_ABS), 0x01, 0x02,
+                (nes::u8)(nes::Opcode::JMP_ABS), 0x00, 0x02});
+
+  EXPECT_EQ(cpu.run(11 * 40), 11 * 40);
+  EXPECT_EQ(cpu.get_accumulator(), 40);
+
+  // A hot, translated block is still dropped by an outside write
+  load(0x0300, {(nes::u8)(nes::Opcode::INX_IMP),
+                (nes::u8)(nes::Opcode::JMP_ABS), 0x00, 0x03});
+  cpu.set_pc(0x0300);
+  cpu.run(5 * 40);
+  bus.write(0x0300, (nes::u8)(nes::Opcode::DEX_IMP));
+  const nes::u8 x = cpu.get_x();
+  cpu.run(5 * 10);
+  EXPECT_EQ(cpu.get_x(), (nes::u8)(x - 10));
+}
+
+TEST_F(CPUBlockCacheTest, jit_inline_instructions_match_interpreter) {
+  nes::Bus reference_bus;
+  nes::CPU reference{reference_bus};
+  if (!cpu.set_jit_enabled(true)) GTEST_SKIP() << "JIT not supported on this platform";
+
+  // 0200 TSX / TXS / LDX #$00
+  // 0204 LDA $02F0,X / STA $0500,X / LDY $F8,X / STY $40,X / TXA / TAY / DEY / INY / SEC / CLC
+  //      INX / CPX #$20 / BCC $0204 / JMP $0200
+  const std::initializer_list<nes::u8> program = {
+      (nes::u8)(nes::Opcode::TSX_IMP),
+      (nes::u8)(nes::Opcode::TXS_IMP),
+      (nes::u8)(nes::Opcode::LDX_IMM), 0x00,
+      (nes::u8)(nes::Opcode::LDA_ABX), 0xF0, 0x02,  // Crosses into page $03 from X = $10
+      (nes::u8)(nes::Opcode::STA_ABX), 0x00, 0x05,
+      (nes::u8)(nes::Opcode::LDY_ZPX), 0xF8,  // Wraps around the zero page from X = $08
+      (nes::u8)(nes::Opcode::STY_ZPX), 0x40,
+      (nes::u8)(nes::Opcode::TXA_IMP),
+      (nes::u8)(nes::Opcode::TAY_IMP),
+      (nes::u8)(nes::Opcode::DEY_IMP),
+      (nes::u8)(nes::Opcode::INY_IMP),
+      (nes::u8)(nes::Opcode::SEC_IMP),
+      (nes::u8)(nes::Opcode::CLC_IMP),
+      (nes::u8)(nes::Opcode::INX_IMP),
+      (nes::u8)(nes::Opcode::CPX_IMM), 0x20,
+      (nes::u8)(nes::Opcode::BCC_REL), 0xEB,
+      (nes::u8)(nes::Opcode::JMP_ABS), 0x00, 0x02};
+  for (nes::Bus *memory : {&bus, &reference_bus}) {
+    memory->write_block(0x0200, program.begin(), program.size());
+    for (nes::u16 i = 0; i < 0x20; i++) {
+      memory->write(0x02F0 + i, 0x70 + i);
+      memory->write((nes::u8)(0xF8 + i), 0x80 - i);
+    }
+    memory->fetch_dirty_pages();
+  }
+  reference.set_pc(0x0200);
+
+  // The loop is entered once per pass, so later passes run translated code
+  nes::u64 cycles = 0;
+  while (cycles < 20000) {
+    cycles += reference.step_instruction();
+  }
+  EXPECT_EQ(cpu.run(20000), cycles);
+  EXPECT_EQ(cpu.get_pc(), reference.get_pc());
+  EXPECT_EQ(cpu.get_accumulator(), reference.get_accumulator());
+  EXPECT_EQ(cpu.get_x(), reference.get_x());
+  EXPECT_EQ(cpu.get_y(), reference.get_y());
+  EXPECT_EQ(cpu.get_sp(), reference.get_sp());
+  EXPECT_EQ(cpu.get_status(), reference.get_status());
+  for (nes::u16 address = 0x0000; address < 0x0100; address++) {
+    EXPECT_EQ(bus.read(address), reference_bus.read(address)) << address;
+  }
+  for (nes::u16 address = 0x0500; address < 0x0520; address++) {
+    EXPECT_EQ(bus.read(address), reference_bus.read(address)) << address;
+  }
+  EXPECT_EQ(bus.fetch_dirty_pages(), reference_bus.fetch_dirty_pages());
+}
+
+TEST_F(CPUBlockCacheTest, jit_inline_store_into_code_invalidates_block) {
+  if (!cpu.set_jit_enabled(true)) GTEST_SKIP() << "JIT not supported on this platform";
+
+  // 0200 LDA #$00 / INX / STX $0201 / JMP $0200, each pass loads the X the last one stored
+  load(0x0200, {(nes::u8)(nes::Opcode::LDA_IMM), 0x00,
+                (nes::u8)(nes::Opcode::INX_IMP),
+                (nes::u8)(nes::Opcode::STX_ABS), 0x01, 0x02,
+                (nes::u8)(nes::Opcode::JMP_ABS), 0x00, 0x02});
+
+  EXPECT_EQ(cpu.run(11 * 40), 11 * 40);
+  EXPECT_EQ(cpu.get_x(), 40);
+  EXPECT_EQ(cpu.get_accumulator(), 39);
+  EXPECT_EQ(bus.read(0x0201), 40);
+}
+
+TEST_F(CPUBlockCacheTest, paired_instructions_match_interpreter_at_every_budget) {
+  // 0200 LDX #$03 / LDY #$00
+  // 0204 CLC / ADC $0300,Y / SEC / SBC #$01 / LDA $02FF,X / STA $0400,Y
+  // 0211 INY / CPY #$02 / CMP #$A2 / BEQ $021A / LDA #$00
+  // 021A DEX / BNE $0204 / JMP $021D
+  const std::initializer_list<nes::u8> program = {
+      (nes::u8)(nes::Opcode::LDX_IMM), 0x03,
+      (nes::u8)(nes::Opcode::LDY_IMM), 0x00,
+      (nes::u8)(nes::Opcode::CLC_IMP),
+      (nes::u8)(nes::Opcode::ADC_ABY), 0x00, 0x03,
+      (nes::u8)(nes::Opcode::SEC_IMP),
+      (nes::u8)(nes::Opcode::SBC_IMM), 0x01,
+      (nes::u8)(nes::Opcode::LDA_ABX), 0xFF, 0x02,
+      (nes::u8)(nes::Opcode::STA_ABY), 0x00, 0x04,
+      (nes::u8)(nes::Opcode::INY_IMP),
+      (nes::u8)(nes::Opcode::CPY_IMM), 0x02,
+      (nes::u8)(nes::Opcode::CMP_IMM), 0xA2,
+      (nes::u8)(nes::Opcode::BEQ_REL), 0x02,
+      (nes::u8)(nes::Opcode::LDA_IMM), 0x00,
+      (nes::u8)(nes::Opcode::DEX_IMP),
+      (nes::u8)(nes::Opcode::BNE_REL), 0xE7,
+      (nes::u8)(nes::Opcode::JMP_ABS), 0x1D, 0x02};
+  const std::initializer_list<nes::u8> data = {0xA0, 0xA1, 0xA2, 0xA3};
+
+  // Every budget, so some runs stop between the two halves of a pair
+  for (nes::u64 budget = 1; budget <= 120; budget++) {
+    nes::Bus blocks_bus;
+    nes::Bus reference_bus;
+    nes::CPU blocks{blocks_bus};
+    nes::CPU reference{reference_bus};
+    for (nes::Bus *memory : {&blocks_bus, &reference_bus}) {
+      memory->write_block(0x0200, program.begin(), program.size());
+      memory->write_block(0x0300, data.begin(), data.size());
+    }
+    ASSERT_TRUE(blocks.set_block_cache_enabled(true));
+    blocks.set_idle_loop_skip_enabled(false);
+    blocks.set_branch_stats_enabled(true);
+    reference.set_branch_stats_enabled(true);
+    blocks.set_pc(0x0200);
+    reference.set_pc(0x0200);
+
+    nes::u64 cycles = 0;
+    while (cycles < budget) {
+      cycles += reference.step_instruction();
+    }
+    EXPECT_EQ(blocks.run(budget), cycles) << "budget " << budget;
+    EXPECT_EQ(blocks.get_pc(), reference.get_pc()) << "budget " << budget;
+    EXPECT_EQ(blocks.get_accumulator(), reference.get_accumulator()) << "budget " << budget;
+    EXPECT_EQ(blocks.get_x(), reference.get_x()) << "budget " << budget;
+    EXPECT_EQ(blocks.get_y(), reference.get_y()) << "budget " << budget;
+    EXPECT_EQ(blocks.get_status(), reference.get_status()) << "budget " << budget;
+    for (nes::u16 address = 0x0400; address < 0x0404; address++) {
+      EXPECT_EQ(blocks_bus.read(address), reference_bus.read(address)) << "budget " << budget;
+    }
+    for (nes::u16 branch : {0x0217, 0x021B}) {
+      EXPECT_EQ(blocks.get_branch_stats(branch).taken, reference.get_branch_stats(branch).taken);
+      EXPECT_EQ(blocks.get_branch_stats(branch).not_taken, reference.get_branch_stats(branch).not_taken);
+    }
+  }
+}
+
+TEST_F(CPUBlockCacheTest, interrupt_raised_inside_pair_comes_before_its_second_half) {
+  // Every read of $5000 pulls NMI, so the NMI has to be taken between the halves of both pairs
+  class NmiOnRead final : public nes::Addressable {
+   public:
+    nes::u8 read(nes::u16) const override {
+      cpu->trigger_nmi();
+      return 0x42;
+    }
+    void write(nes::u16, nes::u8) override {}
+    bool handles_address(nes::u16 address) const override { return (address >> 8) == 0x50; }
+    nes::CPU *cpu = nullptr;
+  };
+
+  // 0200 LDA $5000 / STA $10 / CMP $5000 / BEQ $0200 / JMP $0200, NMI handler at 0300 is RTI
+  const std::initializer_list<nes::u8> program = {
+      (nes::u8)(nes::Opcode::LDA_ABS), 0x00, 0x50,
+      (nes::u8)(nes::Opcode::STA_ZPG), 0x10,
+      (nes::u8)(nes::Opcode::CMP_ABS), 0x00, 0x50,
+      (nes::u8)(nes::Opcode::BEQ_REL), 0xF6,
+      (nes::u8)(nes::Opcode::JMP_ABS), 0x00, 0x02};
+  const std::initializer_list<nes::u8> vector = {0x00, 0x03};
+
+  for (nes::u64 budget = 1; budget <= 100; budget++) {
+    nes::Bus blocks_bus;
+    nes::Bus reference_bus;
+    nes::CPU blocks{blocks_bus};
+    nes::CPU reference{reference_bus};
+    NmiOnRead blocks_device;
+    NmiOnRead reference_device;
+    blocks_device.cpu = &blocks;
+    reference_device.cpu = &reference;
+    blocks_bus.map_device(0x50, &blocks_device);
+    reference_bus.map_device(0x50, &reference_device);
+    for (nes::Bus *memory : {&blocks_bus, &reference_bus}) {
+      memory->write_block(0x0200, program.begin(), program.size());
+      memory->write(0x0300, (nes::u8)(nes::Opcode::RTI_IMP));
+      memory->write_block(0xFFFA, vector.begin(), vector.size());
+    }
+    ASSERT_TRUE(blocks.set_block_cache_enabled(true));
+    blocks.set_jit_enabled(false);
+    blocks.set_idle_loop_skip_enabled(false);
+    blocks.set_pc(0x0200);
+    reference.set_pc(0x0200);
+
+    nes::u64 cycles = 0;
+    while (cycles < budget) {
+      cycles += reference.step_instruction();
+    }
+    EXPECT_EQ(blocks.run(budget), cycles) << "budget " << budget;
+    EXPECT_EQ(blocks.get_pc(), reference.get_pc()) << "budget " << budget;
+    EXPECT_EQ(blocks.get_sp(), reference.get_sp()) << "budget " << budget;
+    EXPECT_EQ(blocks.get_status(), reference.get_status()) << "budget " << budget;
+    EXPECT_EQ(blocks_bus.read(0x0010), reference_bus.read(0x0010)) << "budget " << budget;
+    for (nes::u16 address = 0x01FA; address <= 0x01FF; address++) {
+      EXPECT_EQ(blocks_bus.read(address), reference_bus.read(address)) << "budget " << budget;
+    }
+  }
+}
+
+TEST_F(CPUBlockCacheTest, open_bus_matches_interpreter) {
+  // Nothing is mapped at $5000-$53FF, so each load there reads the last byte of its own operand
+  // 0200 LDA #$77 / LDA $5000 / STA $0300 / CLC / ADC $5100 / LDX $5200 / CMP $5300 / BEQ $0200 / JMP $0200
+  const std::initializer_list<nes::u8> program = {
+      (nes::u8)(nes::Opcode::LDA_IMM), 0x77,
+      (nes::u8)(nes::Opcode::LDA_ABS), 0x00, 0x50,
+      (nes::u8)(nes::Opcode::STA_ABS), 0x00, 0x03,
+      (nes::u8)(nes::Opcode::CLC_IMP),
+      (nes::u8)(nes::Opcode::ADC_ABS), 0x00, 0x51,
+      (nes::u8)(nes::Opcode::LDX_ABS), 0x00, 0x52,
+      (nes::u8)(nes::Opcode::CMP_ABS), 0x00, 0x53,
+      (nes::u8)(nes::Opcode::BEQ_REL), 0xEC,
+      (nes::u8)(nes::Opcode::JMP_ABS), 0x00, 0x02};
+
+  for (nes::u64 budget : {6, 10, 16, 20, 24, 28, 400}) {
+    nes::Bus blocks_bus;
+    nes::Bus reference_bus;
+    nes::CPU blocks{blocks_bus};
+    nes::CPU reference{reference_bus};
+    ASSERT_TRUE(blocks.set_block_cache_enabled(true));
+    blocks_bus.write_block(0x0200, program.begin(), program.size());
+    reference_bus.write_block(0x0200, program.begin(), program.size());
+    blocks.set_pc(0x0200);
+    reference.set_pc(0x0200);
+
+    nes::u64 cycles = 0;
+    while (cycles < budget) {
+      cycles += reference.step_instruction();
+    }
+    EXPECT_EQ(blocks.run(budget), cycles) << "budget " << budget;
+    EXPECT_EQ(blocks.get_pc(), reference.get_pc()) << "budget " << budget;
+    EXPECT_EQ(blocks.get_accumulator(), reference.get_accumulator()) << "budget " << budget;
+    EXPECT_EQ(blocks.get_x(), reference.get_x()) << "budget " << budget;
+    EXPECT_EQ(blocks.get_status(), reference.get_status()) << "budget " << budget;
+    EXPECT_EQ(blocks_bus.get_open_bus(), reference_bus.get_open_bus()) << "budget " << budget;
+    EXPECT_EQ(blocks_bus.read(0x0300), reference_bus.read(0x0300)) << "budget " << budget;
+  }
+
+  // LDA $5000 right after LDA #$77 reads $50 either way
+  nes::CPU interpreter{bus};
+  load(0x0200, program);
+  interpreter.set_pc(0x0200);
+  interpreter.step_instruction();
+  interpreter.step_instruction();
+  EXPECT_EQ(interpreter.get_accumulator(), 0x50);
+  EXPECT_EQ(cpu.run(6), 6);
+  EXPECT_EQ(cpu.get_accumulator(), 0x50);
+}
+
+TEST_F(CPUBlockCacheTest, decoding_ahead_leaves_latch_and_devices_alone) {
+  // A device page holding code is read once per executed fetch, never ahead of it
+  class CountingRom final : public nes::Addressable {
+   public:
+    nes::u8 read(nes::u16 address) const override {
+      reads++;
+      return (address == 0x6000) ? (nes::u8)(nes::Opcode::NOP_IMP) : (nes::u8)(nes::Opcode::JMP_ABS);
+    }
+    void write(nes::u16 /*address*/, nes::u8 /*value*/) override {}
+    bool handles_address(nes::u16 /*address*/) const override { return true; }
+    mutable int reads = 0;
+  };
+  CountingRom rom;
+  bus.map_device(0x60, &rom);
+
+  // 0200 LDA #$42 / INX / INX / JMP $6000, and $6000 NOP / JMP $4C4C
+  load(0x0200, {(nes::u8)(nes::Opcode::LDA_IMM), 0x42,
+                (nes::u8)(nes::Opcode::INX_IMP),
+                (nes::u8)(nes::Opcode::INX_IMP),
+                (nes::u8)(nes::Opcode::JMP_ABS), 0x00, 0x60});
+  EXPECT_EQ(cpu.run(2 + 2 + 2), 6);
+  EXPECT_EQ(bus.get_open_bus(), (nes::u8)(nes::Opcode::INX_IMP));
+  EXPECT_EQ(rom.reads, 0);
+
+  EXPECT_EQ(cpu.run(3 + 2), 5);
+  EXPECT_EQ(cpu.get_pc(), 0x6001);
+  EXPECT_EQ(rom.reads, 1);
+}
+
+TEST_F(CPUBlockCacheTest, paired_decimal_addition_keeps_65c02_cycle) {
+  // 0200 SED / LDA #$28 / CLC / ADC #$19 / JMP $0200, the 65C02 spends a cycle on the adjust
+  nes::CPU65C02 cmos{bus};
+  ASSERT_TRUE(cmos.set_block_cache_enabled(true));
+  load(0x0200, {(nes::u8)(nes::Opcode::SED_IMP),
+                (nes::u8)(nes::Opcode::LDA_IMM), 0x28,
+                (nes::u8)(nes::Opcode::CLC_IMP),
+                (nes::u8)(nes::Opcode::ADC_IMM), 0x19,
+                (nes::u8)(nes::Opcode::JMP_ABS), 0x00, 0x02});
+  cmos.set_pc(0x0200);
+
+  EXPECT_EQ(cmos.run(2 + 2 + 2 + 3 + 3), 12);
+  EXPECT_EQ(cmos.get_accumulator(), 0x47);
+  EXPECT_FALSE(cmos.get_flag(nes::Flag::CARRY));
+  EXPECT_EQ(cmos.get_pc(), 0x0200);
+}
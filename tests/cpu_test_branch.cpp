@@ -648,3 +648,55 @@ TEST_F(CPUBranchTest, bvc_bvs_consecutive_branches) {
   execute_cycles(3);
   EXPECT_EQ(cpu.get_pc(), 0x1322);
 }
+
+TEST_F(CPUBranchTest, branch_stats_are_empty_while_disabled) {
+  execute_bcc_instruction(0x10, false);
+  cpu.step_instruction();
+
+  EXPECT_FALSE(cpu.is_branch_stats_enabled());
+  EXPECT_EQ(cpu.get_branch_stats(0x1000).taken, 0u);
+  EXPECT_EQ(cpu.get_branch_stats(0x1000).not_taken, 0u);
+}
+
+TEST_F(CPUBranchTest, branch_stats_count_each_outcome_per_address) {
+  // LDX #$03, DEX, BNE -3: taken twice, then falls through
+  cpu.set_pc(0x1000);
+  bus.write(0x1000, static_cast<nes::u8>(nes::Opcode::LDX_IMM));
+  bus.write(0x1001, 0x03);
+  bus.write(0x1002, static_cast<nes::u8>(nes::Opcode::DEX_IMP));
+  bus.write(0x1003, static_cast<nes::u8>(nes::Opcode::BNE_REL));
+  bus.write(0x1004, 0xFD);
+  cpu.set_branch_stats_enabled(true);
+
+  // LDX (2) + 2 taken loops (2 + 3) + final DEX/BNE not taken (2 + 2)
+  EXPECT_EQ(cpu.run(16), 16);
+  EXPECT_EQ(cpu.get_pc(), 0x1005);
+  EXPECT_EQ(cpu.get_branch_stats(0x1003).taken, 2u);
+  EXPECT_EQ(cpu.get_branch_stats(0x1003).not_taken, 1u);
+  EXPECT_EQ(cpu.get_branch_stats(0x1002).taken, 0u);
+
+  cpu.clear_branch_stats();
+  EXPECT_EQ(cpu.get_branch_stats(0x1003).taken, 0u);
+}
+
+TEST_F(CPUBranchTest, branch_conditions_follow_opcode_bits) {
+  // Each branch is taken exactly when its flag matches bit 5 of the opcode
+  const nes::Opcode branches[] = {nes::Opcode::BPL_REL, nes::Opcode::BMI_REL, nes::Opcode::BVC_REL, nes::Opcode::BVS_REL,
+                                  nes::Opcode::BCC_REL, nes::Opcode::BCS_REL, nes::Opcode::BNE_REL, nes::Opcode::BEQ_REL};
+  const nes::Flag flags[] = {nes::Flag::NEGATIVE, nes::Flag::OVERFLOW_, nes::Flag::CARRY, nes::Flag::ZERO};
+
+  for (nes::Opcode branch : branches) {
+    const nes::u8 opcode = static_cast<nes::u8>(branch);
+    for (bool value : {false, true}) {
+      cpu.reset();
+      cpu.set_pc(0x1000);
+      cpu.set_flag(flags[opcode >> 6], value);
+      bus.write(0x1000, opcode);
+      bus.write(0x1001, 0x10);
+
+      const bool taken = value == ((opcode & 0x20) != 0);
+      EXPECT_EQ(cpu.step_instruction(), taken ? 3 : 2) << (int)opcode;
+      EXPECT_EQ(cpu.get_pc(), taken ? 0x1012 : 0x1002) << (int)opcode;
+    }
+  }
+}
@@ -0,0 +1,322 @@
+#include "cpu_test_base.h"
+
+// Device recording what reaches it, to check which pages are handed over
+class RecordingDevice final : public nes::Addressable {
+ public:
+  nes::u8 read(nes::u16 address) const override {
+    last_read = address;
+    return 0x5A;
+  }
+  void write(nes::u16 address, nes::u8 value) override {
+    last_write = address;
+    last_value = value;
+  }
+  bool handles_address(nes::u16 /*address*/) const override { return true; }
+
+  mutable nes::u16 last_read = 0;
+  nes::u16 last_write = 0;
+  nes::u8 last_value = 0;
+};
+
+class CPUBusTest : public CPUTestBase {};
+
+TEST_F(CPUBusTest, ram_is_mirrored_up_to_1fff) {
+  bus.write(0x0123, 0x42);
+  EXPECT_EQ(bus.read(0x0923), 0x42);
+  EXPECT_EQ(bus.read(0x1123), 0x42);
+  EXPECT_EQ(bus.read(0x1923), 0x42);
+
+  bus.write(0x1FFF, 0x99);
+  EXPECT_EQ(bus.read(0x07FF), 0x99);
+}
+
+TEST_F(CPUBusTest, only_vectors_are_backed_above_ram) {
+  bus.write(0x2000, 0x11);
+  bus.write(0x8000, 0x22);
+  bus.write(0xFFF9, 0x33);
+  bus.write(0xFFFA, 0x44);
+  bus.write(0xFFFC, 0x55);
+  bus.write(0xFFFF, 0x66);
+
+  EXPECT_EQ(bus.read(0xFFFA), 0x44);
+  EXPECT_EQ(bus.read(0xFFFC), 0x55);
+  EXPECT_EQ(bus.read_word(0xFFFE), 0x6600);
+
+  // Everything else is open bus and reads the last value on the data lines
+  EXPECT_EQ(bus.read(0x2000), 0x66);
+  bus.write(0x0000, 0x77);
+  EXPECT_EQ(bus.read(0x8000), 0x77);
+  EXPECT_EQ(bus.read(0xFFF9), 0x77);
+  EXPECT_EQ(bus.get_open_bus(), 0x77);
+}
+
+TEST_F(CPUBusTest, open_bus_reads_last_operand_byte) {
+  // LDA $5000 leaves $50 on the bus from its own operand
+  bus.write(0x0200, (nes::u8)(nes::Opcode::LDA_ABS));
+  bus.write(0x0201, 0x00);
+  bus.write(0x0202, 0x50);
+  cpu.set_pc(0x0200);
+  cpu.step_instruction();
+  EXPECT_EQ(cpu.get_accumulator(), 0x50);
+
+  // Bulk reads leave the latch alone
+  std::array<nes::u8, 4> data{};
+  bus.read_block(0x01FE, data.data(), data.size());
+  EXPECT_EQ(data[2], (nes::u8)(nes::Opcode::LDA_ABS));
+  EXPECT_EQ(bus.get_open_bus(), 0x50);
+}
+
+TEST_F(CPUBusTest, read_only_memory_page_drops_writes) {
+  std::array<nes::u8, nes::Bus::PAGE_SIZE> rom{};
+  rom[0x10] = 0xEA;
+  bus.map_memory(0x80, rom.data(), nullptr);
+
+  EXPECT_EQ(bus.read(0x8010), 0xEA);
+  bus.write(0x8010, 0x00);
+  EXPECT_EQ(bus.read(0x8010), 0xEA);
+  EXPECT_FALSE(bus.has_read_side_effects(0x8010));
+
+  bus.unmap(0x80);
+  EXPECT_EQ(bus.read(0x8010), 0xEA);  // Open bus, still the last value read
+}
+
+TEST_F(CPUBusTest, device_page_gets_every_access) {
+  RecordingDevice device;
+  bus.map_device(0x20, &device);
+
+  EXPECT_EQ(bus.read(0x2002), 0x5A);
+  EXPECT_EQ(device.last_read, 0x2002);
+  bus.write(0x20FF, 0x80);
+  EXPECT_EQ(device.last_write, 0x20FF);
+  EXPECT_EQ(device.last_value, 0x80);
+
+  // Device registers may change on read, RAM does not
+  EXPECT_TRUE(bus.has_read_side_effects(0x2002));
+  EXPECT_FALSE(bus.has_read_side_effects(0x0002));
+  EXPECT_EQ(bus.read(0x2100), 0x80);  // Open bus, the last value written
+}
+
+TEST_F(CPUBusTest, cpu_runs_from_mapped_memory) {
+  // C000 LDA #$37 / STA $10
+  std::array<nes::u8, nes::Bus::PAGE_SIZE> rom{};
+  rom[0x00] = (nes::u8)(nes::Opcode::LDA_IMM);
+  rom[0x01] = 0x37;
+  rom[0x02] = (nes::u8)(nes::Opcode::STA_ZPG);
+  rom[0x03] = 0x10;
+  bus.map_memory(0xC0, rom.data(), nullptr);
+  cpu.set_pc(0xC000);
+
+  EXPECT_EQ(cpu.run(5), 5);
+  EXPECT_EQ(bus.read(0x0010), 0x37);
+  EXPECT_EQ(cpu.get_pc(), 0xC004);
+}
+
+// Registers at $2000-$2007, mirrored every 8 bytes like the PPU
+class MirroredRegisters final : public nes::Addressable {
+ public:
+  nes::u8 read(nes::u16 address) const override { return registers[address & 0x07]; }
+  void write(nes::u16 address, nes::u8 value) override { registers[address & 0x07] = value; }
+  bool handles_address(nes::u16 address) const override { return address >= 0x2000 && address <= 0x3FFF; }
+
+  std::array<nes::u8, 8> registers{};
+};
+
+TEST_F(CPUBusTest, map_attaches_device_to_whole_pages) {
+  MirroredRegisters ppu;
+  bus.map({0x2000, 0x3FFF}, ppu);
+
+  bus.write(0x2006, 0x21);
+  EXPECT_EQ(ppu.registers[6], 0x21);
+  EXPECT_EQ(bus.read(0x3FFE), 0x21);
+  EXPECT_EQ(bus.read(0x4000), 0x21);  // Open bus
+}
+
+TEST_F(CPUBusTest, map_splits_partly_covered_pages) {
+  RecordingDevice apu;
+  RecordingDevice expansion;
+  bus.map({0x4000, 0x4017}, apu);
+  bus.map({0x4020, 0x40FF}, expansion);
+
+  EXPECT_EQ(bus.read(0x4015), 0x5A);
+  EXPECT_EQ(apu.last_read, 0x4015);
+  EXPECT_EQ(bus.read(0x4018), 0x5A);  // Still unmapped in between, open bus
+  bus.write(0x4020, 0x01);
+  EXPECT_EQ(expansion.last_write, 0x4020);
+  EXPECT_EQ(apu.last_write, 0x0000);
+}
+
+TEST_F(CPUBusTest, map_keeps_memory_around_small_device) {
+  RecordingDevice device;
+  bus.write(0x0300, 0x11);
+  bus.write(0x0311, 0x22);
+  bus.map({0x0310, 0x0310}, device);
+
+  EXPECT_EQ(bus.read(0x0300), 0x11);
+  EXPECT_EQ(bus.read(0x0311), 0x22);
+  EXPECT_EQ(bus.read(0x0310), 0x5A);
+  bus.write(0x0312, 0x33);
+  EXPECT_EQ(bus.read(0x0B12), 0x33);  // The RAM mirror sees it too
+
+  // Mapping the whole page again drops the split
+  bus.unmap(0x03);
+  bus.write(0x0000, 0x01);
+  EXPECT_EQ(bus.read(0x0310), 0x01);  // Open bus, not the device
+}
+
+TEST_F(CPUBusTest, map_only_covers_addresses_the_device_handles) {
+  MirroredRegisters ppu;
+  bus.map({0x1F00, 0x20FF}, ppu);
+
+  bus.write(0x1F00, 0x44);
+  EXPECT_EQ(bus.read(0x0700), 0x44);  // Still RAM
+  bus.write(0x2001, 0x55);
+  EXPECT_EQ(bus.read(0x20F9), 0x55);
+}
+
+TEST_F(CPUBusTest, block_access_crosses_pages_and_mappings) {
+  RecordingDevice device;
+  bus.map_device(0x20, &device);
+
+  std::array<nes::u8, 0x300> data;
+  for (size_t i = 0; i < data.size(); i++) data[i] = (nes::u8)i;
+  bus.write_block(0x1E80, data.data(), data.size());
+  EXPECT_EQ(bus.read(0x0680), 0x00);  // $1E80 mirrors $0680
+  EXPECT_EQ(bus.read(0x07FF), 0x7F);
+  EXPECT_EQ(device.last_write, 0x20FF);
+  EXPECT_EQ(device.last_value, 0x7F);
+
+  std::array<nes::u8, 0x300> read_back{};
+  bus.read_block(0x1E80, read_back.data(), read_back.size());
+  EXPECT_EQ(read_back[0x17F], 0x7F);
+  EXPECT_EQ(read_back[0x180], 0x5A);  // From the device
+  EXPECT_EQ(read_back[0x280], 0x7F);  // Unmapped, open bus from the last read
+
+  // Wraps from $FFFF to $0000
+  bus.fill(0xFFFE, 0xEE, 4);
+  EXPECT_EQ(bus.read(0xFFFE), 0xEE);
+  EXPECT_EQ(bus.read(0x0000), 0xEE);
+  EXPECT_EQ(bus.read(0x0001), 0xEE);
+  EXPECT_EQ(bus.read(0x0002), 0x00);
+}
+
+TEST_F(CPUBusTest, block_writes_reach_block_cache) {
+  ASSERT_TRUE(cpu.set_block_cache_enabled(true));
+  const nes::u8 first[] = {(nes::u8)(nes::Opcode::LDA_IMM), 0x11, (nes::u8)(nes::Opcode::JMP_ABS), 0x00, 0x02};
+  bus.write_block(0x0200, first, sizeof(first));
+  cpu.set_pc(0x0200);
+  cpu.run(5);
+  EXPECT_EQ(cpu.get_accumulator(), 0x11);
+
+  bus.fill(0x0A01, 0x22, 1);  // Through a mirror
+  cpu.run(5);
+  EXPECT_EQ(cpu.get_accumulator(), 0x22);
+}
+
+// Watcher recording the last access it was told about
+class RecordingWatcher final : public nes::MemoryWatcher {
+ public:
+  void memory_read(nes::u16 address, nes::u8 value) override {
+    reads++;
+    last_address = address;
+    last_value = value;
+  }
+  void memory_written(nes::u16 address, nes::u8 old_value, nes::u8 value) override {
+    writes++;
+    last_address = address;
+    last_old_value = old_value;
+    last_value = value;
+  }
+
+  int reads = 0;
+  int writes = 0;
+  nes::u16 last_address = 0;
+  nes::u8 last_old_value = 0;
+  nes::u8 last_value = 0;
+};
+
+TEST_F(CPUBusTest, watched_pages_report_accesses) {
+  RecordingWatcher watcher;
+  bus.set_memory_watcher(&watcher);
+  bus.write(0x0210, 0x11);
+  bus.watch_page(0x02, true);
+  EXPECT_TRUE(bus.has_read_side_effects(0x0210));
+
+  bus.write(0x0210, 0x22);
+  EXPECT_EQ(watcher.writes, 1);
+  EXPECT_EQ(watcher.last_address, 0x0210);
+  EXPECT_EQ(watcher.last_old_value, 0x11);
+  EXPECT_EQ(bus.read(0x0210), 0x22);
+  EXPECT_EQ(watcher.reads, 1);
+
+  // Other pages, mirrors included, stay on the direct path
+  EXPECT_EQ(bus.read(0x0A10), 0x22);
+  bus.write(0x0310, 0x33);
+  EXPECT_EQ(watcher.reads, 1);
+  EXPECT_EQ(watcher.writes, 1);
+
+  // A watch outlives remapping, and device pages are watched too
+  RecordingDevice device;
+  bus.map_device(0x02, &device);
+  EXPECT_EQ(bus.read(0x0280), 0x5A);
+  EXPECT_EQ(device.last_read, 0x0280);
+  EXPECT_EQ(watcher.reads, 2);
+  bus.write(0x0281, 0x44);
+  EXPECT_EQ(device.last_value, 0x44);
+  EXPECT_EQ(watcher.writes, 2);
+
+  bus.watch_page(0x02, false);
+  bus.read(0x0280);
+  EXPECT_EQ(watcher.reads, 2);
+  EXPECT_FALSE(bus.is_page_watched(0x02));
+}
+
+#ifdef BUS_DIRTY_PAGES
+TEST_F(CPUBusTest, dirty_pages_are_fetched_and_cleared) {
+  std::array<nes::u8, 2 * nes::Bus::PAGE_SIZE> memory{};
+  bus.map_memory(0x30, memory.data(), memory.data());
+  bus.map_memory(0x31, memory.data() + nes::Bus::PAGE_SIZE, memory.data() + nes::Bus::PAGE_SIZE);
+  bus.fetch_dirty_pages();  // Mapped at construction and above
+
+  bus.write(0x0A10, 0x01);
+  const nes::u8 data[3] = {1, 2, 3};
+  bus.write_block(0x30FF, data, sizeof(data));
+  auto dirty = bus.fetch_dirty_pages();
+  EXPECT_EQ(dirty.count(), 4u + 2u);
+  for (nes::u8 page : {0x02, 0x0A, 0x12, 0x1A, 0x30, 0x31}) {
+    EXPECT_TRUE(dirty[page]) << (int)page;
+  }
+  EXPECT_TRUE(bus.fetch_dirty_pages().none());
+
+  // Reads leave pages clean, remapping dirties them
+  bus.read(0x0200);
+  RecordingDevice device;
+  bus.map_device(0x40, &device);
+  dirty = bus.fetch_dirty_pages();
+  EXPECT_EQ(dirty.count(), 1u);
+  EXPECT_TRUE(dirty[0x40]);
+}
+
+TEST_F(CPUBusTest, dropped_writes_leave_pages_clean) {
+  std::array<nes::u8, nes::Bus::PAGE_SIZE> rom{};
+  RecordingDevice device;
+  RecordingDevice registers;
+  bus.map_memory(0x80, rom.data(), nullptr);
+  bus.map_memory(0x90, rom.data(), nullptr, &registers);
+  bus.map({0x4000, 0x4017}, device);
+  bus.fetch_dirty_pages();
+
+  // ROM, mapper registers behind ROM, open bus and the unmapped part of a split page
+  const nes::u8 data[2] = {1, 2};
+  bus.write(0x8000, 0x01);
+  bus.write_block(0x80FF, data, sizeof(data));
+  bus.fill(0x9000, 0x02, 4);
+  bus.write(0x4018, 0x03);
+  EXPECT_EQ(registers.last_write, 0x9003);
+  EXPECT_TRUE(bus.fetch_dirty_pages().none());
+
+  bus.write(0x4017, 0x04);
+  auto dirty = bus.fetch_dirty_pages();
+  EXPECT_EQ(dirty.count(), 1u);
+  EXPECT_TRUE(dirty[0x40]);
+}
+#endif
@@ -0,0 +1,242 @@
+#include <cstdio>
+#include <fstream>
+#include "../include/cartridge.h"
+#include "cpu_test_base.h"
+
+class CPUCartridgeTest : public CPUTestBase {
+ protected:
+  // iNES image whose 8KB PRG banks and 1KB CHR banks are filled with their own number
+  static std::vector<nes::u8> make_image(nes::u8 mapper, nes::u8 prg_16k_banks, nes::u8 chr_8k_banks, nes::u8 flags6 = 0) {
+    std::vector<nes::u8> image = {'N', 'E', 'S', 0x1A, prg_16k_banks, chr_8k_banks, (nes::u8)((mapper << 4) | flags6),
+                                  (nes::u8)(mapper & 0xF0), 0, 0, 0, 0, 0, 0, 0, 0};
+    for (size_t bank = 0; bank < prg_16k_banks * 2u; bank++) {
+      image.insert(image.end(), nes::Cartridge::PRG_SLOT_SIZE, (nes::u8)bank);
+    }
+    for (size_t bank = 0; bank < chr_8k_banks * 8u; bank++) {
+      image.insert(image.end(), nes::Cartridge::CHR_SLOT_SIZE, (nes::u8)(0x80 + bank));
+    }
+    return image;
+  }
+
+  std::unique_ptr<nes::Cartridge> insert(std::vector<nes::u8> image) {
+    auto cartridge = nes::Cartridge::load(std::move(image));
+    if (cartridge != nullptr) cartridge->insert(bus);
+    return cartridge;
+  }
+
+  // MMC1 registers are written one bit at a time, low bit first
+  void write_mmc1(nes::u16 address, nes::u8 value) {
+    for (int bit = 0; bit < 5; bit++) {
+      bus.write(address, (value >> bit) & 0x01);
+    }
+  }
+};
+
+TEST_F(CPUCartridgeTest, rejects_bad_images) {
+  auto image = make_image(0, 1, 1);
+  image[3] = 0x00;
+  EXPECT_EQ(nes::Cartridge::load(image), nullptr);
+
+  image = make_image(0, 2, 1);
+  image.resize(image.size() - 1);  // Truncated CHR
+  EXPECT_EQ(nes::Cartridge::load(image), nullptr);
+
+  EXPECT_EQ(nes::Cartridge::load(make_image(7, 2, 0)), nullptr);  // AxROM is not supported
+  EXPECT_EQ(nes::Cartridge::load_file("/nonexistent/file.nes"), nullptr);
+}
+
+TEST_F(CPUCartridgeTest, parses_nes2_header) {
+  auto image = make_image(0, 1, 1, 0x01);
+  image[7] |= 0x08;  // NES 2.0
+  image[8] = 0x21;   // Submapper 2, mapper bits 8-11 = 1
+  image[10] = 0x77;  // 8KB of PRG RAM and 8KB of battery-backed PRG NVRAM
+
+  nes::CartridgeHeader header;
+  ASSERT_TRUE(nes::Cartridge::parse_header(image.data(), image.size(), header));
+  EXPECT_TRUE(header.nes2);
+  EXPECT_EQ(header.mapper, 0x100);
+  EXPECT_EQ(header.submapper, 2);
+  EXPECT_EQ(header.prg_rom_size, 16 * 1024u);
+  EXPECT_EQ(header.chr_rom_size, 8 * 1024u);
+  EXPECT_EQ(header.prg_ram_size, 16 * 1024u);
+  EXPECT_EQ(header.mirroring, nes::Mirroring::VERTICAL);
+
+  // iNES headers signed by old tools only keep the low mapper nibble
+  image = make_image(0x41, 2, 1);
+  std::copy_n("DiskDude!", 9, image.begin() + 7);
+  ASSERT_TRUE(nes::Cartridge::parse_header(image.data(), image.size(), header));
+  EXPECT_FALSE(header.nes2);
+  EXPECT_EQ(header.mapper, 1);
+}
+
+TEST_F(CPUCartridgeTest, nrom_128_is_mirrored_and_read_only) {
+  auto cartridge = insert(make_image(0, 1, 1));
+  ASSERT_NE(cartridge, nullptr);
+
+  EXPECT_EQ(bus.read(0x8000), 0);
+  EXPECT_EQ(bus.read(0xA000), 1);
+  EXPECT_EQ(bus.read(0xC000), 0);
+  EXPECT_EQ(bus.read(0xFFFF), 1);
+  bus.write(0x8000, 0x55);
+  EXPECT_EQ(bus.read(0x8000), 0);
+
+  // PRG RAM is plain memory
+  bus.write(0x6123, 0x42);
+  EXPECT_EQ(bus.read(0x6123), 0x42);
+  EXPECT_EQ(cartridge->read(0x6123), 0x42);
+  EXPECT_EQ(cartridge->read_chr(0x1C00), 0x87);
+}
+
+TEST_F(CPUCartridgeTest, chr_ram_when_image_has_no_chr) {
+  auto cartridge = insert(make_image(0, 2, 0));
+  ASSERT_NE(cartridge, nullptr);
+
+  cartridge->write_chr(0x1234, 0x99);
+  EXPECT_EQ(cartridge->read_chr(0x1234), 0x99);
+}
+
+TEST_F(CPUCartridgeTest, uxrom_switches_16k_at_8000) {
+  auto cartridge = insert(make_image(2, 8, 0));
+  ASSERT_NE(cartridge, nullptr);
+
+  EXPECT_EQ(bus.read(0x8000), 0);
+  EXPECT_EQ(bus.read(0xC000), 14);
+  bus.write(0x8000, 3);
+  EXPECT_EQ(bus.read(0x8000), 6);
+  EXPECT_EQ(bus.read(0xA000), 7);
+  EXPECT_EQ(bus.read(0xE000), 15);
+}
+
+TEST_F(CPUCartridgeTest, cnrom_switches_chr) {
+  auto cartridge = insert(make_image(3, 2, 4));
+  ASSERT_NE(cartridge, nullptr);
+
+  bus.write(0xFFF0, 2);
+  EXPECT_EQ(cartridge->read_chr(0x0000), 0x80 + 16);
+  EXPECT_EQ(cartridge->read_chr(0x1FFF), 0x80 + 23);
+  EXPECT_EQ(bus.read(0x8000), 0);
+}
+
+TEST_F(CPUCartridgeTest, mmc1_serial_registers) {
+  auto cartridge = insert(make_image(1, 8, 2));
+  ASSERT_NE(cartridge, nullptr);
+
+  // Powers up with the last 16KB fixed at $C000
+  EXPECT_EQ(bus.read(0xC000), 14);
+
+  write_mmc1(0xE000, 5);
+  EXPECT_EQ(bus.read(0x8000), 10);
+  EXPECT_EQ(bus.read(0xC000), 14);
+
+  // Control: vertical mirroring, first bank fixed at $8000, 4KB CHR banks
+  write_mmc1(0x8000, 0x1A);
+  EXPECT_EQ(cartridge->get_mirroring(), nes::Mirroring::VERTICAL);
+  EXPECT_EQ(bus.read(0x8000), 0);
+  EXPECT_EQ(bus.read(0xC000), 10);
+
+  write_mmc1(0xC000, 3);
+  EXPECT_EQ(cartridge->read_chr(0x1000), 0x80 + 12);
+
+  // A write with bit 7 set drops a half-written value
+  bus.write(0xE000, 1);
+  bus.write(0xE000, 0x80);
+  write_mmc1(0xE000, 2);
+  EXPECT_EQ(bus.read(0x8000), 4);
+}
+
+TEST_F(CPUCartridgeTest, mmc3_banks_and_irq) {
+  auto cartridge = insert(make_image(4, 8, 8));
+  ASSERT_NE(cartridge, nullptr);
+
+  bus.write(0x8000, 6);
+  bus.write(0x8001, 3);
+  bus.write(0x8000, 7);
+  bus.write(0x8001, 5);
+  EXPECT_EQ(bus.read(0x8000), 3);
+  EXPECT_EQ(bus.read(0xA000), 5);
+  EXPECT_EQ(bus.read(0xC000), 14);
+  EXPECT_EQ(bus.read(0xE000), 15);
+
+  // PRG mode 1 swaps $8000 and $C000, CHR inversion puts the 2KB banks on top
+  bus.write(0x8000, 0xC0 | 2);
+  bus.write(0x8001, 9);
+  EXPECT_EQ(bus.read(0x8000), 14);
+  EXPECT_EQ(bus.read(0xC000), 3);
+  EXPECT_EQ(cartridge->read_chr(0x0000), 0x80 + 9);
+  EXPECT_EQ(cartridge->read_chr(0x1000), 0x80 + 0);
+
+  bus.write(0xA000, 1);
+  EXPECT_EQ(cartridge->get_mirroring(), nes::Mirroring::HORIZONTAL);
+
+  // IRQ after latch + 1 scanlines: the first clock reloads the counter
+  bus.write(0xC000, 2);
+  bus.write(0xC001, 0);
+  bus.write(0xE001, 0);
+  for (int line = 0; line < 2; line++) {
+    cartridge->clock_scanline();
+    EXPECT_FALSE(cartridge->irq_pending());
+  }
+  cartridge->clock_scanline();
+  EXPECT_TRUE(cartridge->irq_pending());
+  bus.write(0xE000, 0);
+  EXPECT_FALSE(cartridge->irq_pending());
+
+  // Write-protected PRG RAM keeps reading
+  bus.write(0x6000, 0x12);
+  bus.write(0xA001, 0xC0);
+  bus.write(0x6000, 0x34);
+  EXPECT_EQ(bus.read(0x6000), 0x12);
+  bus.write(0xA001, 0x00);
+  EXPECT_EQ(bus.read(0x6000), 0x00);
+}
+
+TEST_F(CPUCartridgeTest, bank_switch_drops_cached_code) {
+  // Each 16KB bank starts with LDA #bank / STA $8000 / JMP $8000, run from
+  // the switched window so every pass lands in the bank it just selected
+  auto image = make_image(2, 4, 0);
+  for (nes::u8 bank = 0; bank < 4; bank++) {
+    const size_t start = nes::Cartridge::HEADER_SIZE + bank * 2 * nes::Cartridge::PRG_SLOT_SIZE;
+    const nes::u8 code[] = {(nes::u8)(nes::Opcode::LDA_IMM), (nes::u8)((bank + 1) & 0x03),
+                            (nes::u8)(nes::Opcode::STA_ABS), 0x00, 0x80,
+                            (nes::u8)(nes::Opcode::JMP_ABS), 0x00, 0x80};
+    std::copy(std::begin(code), std::end(code), image.begin() + start);
+  }
+  auto cartridge = insert(image);
+  ASSERT_NE(cartridge, nullptr);
+  ASSERT_TRUE(cpu.set_block_cache_enabled(true));
+  cpu.set_pc(0x8000);
+
+  for (nes::u8 pass = 1; pass <= 6; pass++) {
+    EXPECT_EQ(cpu.run(2 + 4 + 3), 9u);
+    EXPECT_EQ(cpu.get_accumulator(), pass & 0x03);
+    EXPECT_EQ(cpu.get_pc(), 0x8000);
+  }
+}
+
+TEST_F(CPUCartridgeTest, load_file_maps_rom_without_copying) {
+  const std::string path = ::testing::TempDir() + "cpu_test_cartridge.nes";
+  {
+    const auto image = make_image(2, 4, 0);
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(image.data()), image.size());
+  }
+
+  auto cartridge = nes::Cartridge::load_file(path);
+  ASSERT_NE(cartridge, nullptr);
+  EXPECT_EQ(cartridge->get_image().is_mapped(), nes::RomImage::CAN_MAP_FILES);
+  cartridge->insert(bus);
+  bus.write(0x8000, 2);
+  EXPECT_EQ(bus.read(0x8000), 4);
+  EXPECT_EQ(bus.read(0xFFFF), 7);
+
+  // The image is still readable once moved
+  nes::RomImage image = nes::RomImage::open(path);
+  const nes::u8 *data = image.data();
+  nes::RomImage moved = std::move(image);
+  EXPECT_TRUE(image.empty());
+  EXPECT_EQ(moved.data(), data);
+  EXPECT_EQ(moved.data()[3], 0x1A);
+
+  std::remove(path.c_str());
+  EXPECT_TRUE(nes::RomImage::open(path).empty());
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "../include/debugger.h"
+
+// Built on DebuggerCPU so the suite follows DEBUGGER_DYNAMIC_BUS
+class CPUDebuggerTest : public ::testing::Test {
+ protected:
+  void SetUp() override { cpu.reset(); }
+
+  void load_program(nes::u16 address, std::initializer_list<nes::u8> program) {
+    const std::vector<nes::u8> bytes(program);
+    bus.write_block(address, bytes.data(), bytes.size());
+    cpu.set_pc(address);
+  }
+
+  nes::Bus bus;
+  nes::DebuggerCPU cpu{bus};
+  nes::Debugger debugger{cpu, bus};
+};
+
+TEST_F(CPUDebuggerTest, write_watchpoint_stops_after_the_store) {
+  // LDA #$42 / STA $0300 / NOP
+  load_program(0x0200, {(nes::u8)(nes::Opcode::LDA_IMM), 0x42, (nes::u8)(nes::Opcode::STA_ABS), 0x00, 0x03,
+                        (nes::u8)(nes::Opcode::NOP_IMP)});
+  debugger.add_watchpoint(0x0300, (nes::u8)nes::WatchType::WRITE);
+  EXPECT_TRUE(bus.is_page_watched(0x03));
+
+  debugger.run();
+  debugger.step();
+  EXPECT_TRUE(debugger.is_running());
+  debugger.step();
+  EXPECT_FALSE(debugger.is_running());
+  ASSERT_EQ(debugger.get_watch_hits().size(), 1u);
+  const nes::WatchHit &hit = debugger.get_watch_hits()[0];
+  EXPECT_EQ(hit.address, 0x0300);
+  EXPECT_EQ(hit.type, nes::WatchType::WRITE);
+  EXPECT_EQ(hit.old_value, 0x00);
+  EXPECT_EQ(hit.value, 0x42);
+
+  // Cleared on the next step
+  debugger.step();
+  EXPECT_TRUE(debugger.get_watch_hits().empty());
+}
+
+TEST_F(CPUDebuggerTest, change_watchpoint_ignores_same_value) {
+  // LDA #$00 / STA $0300 / LDA #$07 / STA $0300
+  load_program(0x0200, {(nes::u8)(nes::Opcode::LDA_IMM), 0x00, (nes::u8)(nes::Opcode::STA_ABS), 0x00, 0x03,
+                        (nes::u8)(nes::Opcode::LDA_IMM), 0x07, (nes::u8)(nes::Opcode::STA_ABS), 0x00, 0x03});
+  debugger.add_watchpoint(0x0300, (nes::u8)nes::WatchType::CHANGE);
+
+  debugger.step();
+  debugger.step();
+  EXPECT_TRUE(debugger.get_watch_hits().empty());
+  debugger.step();
+  debugger.step();
+  ASSERT_EQ(debugger.get_watch_hits().size(), 1u);
+  EXPECT_EQ(debugger.get_watch_hits()[0].type, nes::WatchType::CHANGE);
+  EXPECT_EQ(debugger.get_watch_hits()[0].value, 0x07);
+}
+
+TEST_F(CPUDebuggerTest, read_watchpoint_ignores_debugger_reads) {
+  // LDA $0300
+  load_program(0x0200, {(nes::u8)(nes::Opcode::LDA_ABS), 0x00, 0x03});
+  debugger.add_watchpoint(0x0300, (nes::u8)nes::WatchType::READ);
+  debugger.add_watchpoint(0x0301, (nes::u8)nes::WatchType::READ);
+
+  debugger.write_memory(0x0300, 0x99);
+  EXPECT_EQ(debugger.read_memory(0x0300), 0x99);
+  debugger.step();
+  ASSERT_EQ(debugger.get_watch_hits().size(), 1u);
+  EXPECT_EQ(debugger.get_watch_hits()[0].type, nes::WatchType::READ);
+  EXPECT_EQ(debugger.get_watch_hits()[0].value, 0x99);
+
+  // The page stays watched until its last watchpoint goes
+  debugger.remove_watchpoint(0x0300);
+  EXPECT_TRUE(bus.is_page_watched(0x03));
+  debugger.remove_watchpoint(0x0301);
+  EXPECT_FALSE(bus.is_page_watched(0x03));
+}
+
+TEST_F(CPUDebuggerTest, inspecting_memory_keeps_open_bus) {
+  bus.write(0x0000, 0x3C);
+  EXPECT_EQ(debugger.get_open_bus(), 0x3C);
+
+  EXPECT_EQ(debugger.read_memory(0x0200), 0x00);
+  debugger.write_memory(0x0201, 0x99);
+  debugger.disassemble_range(0x0200, 0x0210);
+  EXPECT_EQ(debugger.get_open_bus(), 0x3C);
+  EXPECT_EQ(bus.read(0x5000), 0x3C);
+}
@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include <type_traits>
+#include "../include/bus.h"
+#include "../include/cpu.h"
+#include "types.h"
+
+// The same ADC/SBC cases run on every variant, with the expectations that
+// differ between chips looked up from the CPU type
+template <typename CPUType>
+class CPUDecimalTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    cpu.reset();
+    cpu.set_pc(0x0200);
+  }
+
+  // Loads A, sets C and D, then runs ADC/SBC #value and returns its cycles
+  nes::u8 execute(nes::Opcode opcode, nes::u8 a, nes::u8 value, bool carry, bool decimal) {
+    bus.write(0x0200, (nes::u8)nes::Opcode::LDA_IMM);
+    bus.write(0x0201, a);
+    bus.write(0x0202, (nes::u8)(carry ? nes::Opcode::SEC_IMP : nes::Opcode::CLC_IMP));
+    bus.write(0x0203, (nes::u8)(decimal ? nes::Opcode::SED_IMP : nes::Opcode::CLD_IMP));
+    bus.write(0x0204, (nes::u8)opcode);
+    bus.write(0x0205, value);
+
+    cpu.step_instruction();
+    cpu.step_instruction();
+    cpu.step_instruction();
+    return cpu.step_instruction();
+  }
+
+  static constexpr bool HAS_DECIMAL = !std::is_same_v<CPUType, nes::CPU>;
+  static constexpr bool IS_65C02 = std::is_same_v<CPUType, nes::CPU65C02>;
+
+  nes::Bus bus;
+  CPUType cpu{bus};
+};
+
+using CPUVariants = ::testing::Types<nes::CPU, nes::CPU6502, nes::CPU65C02>;
+TYPED_TEST_SUITE(CPUDecimalTest, CPUVariants);
+
+TYPED_TEST(CPUDecimalTest, binary_adc_is_the_same_on_every_variant) {
+  EXPECT_EQ(this->execute(nes::Opcode::ADC_IMM, 0x50, 0x50, false, false), 2);
+  EXPECT_EQ(this->cpu.get_accumulator(), 0xA0);
+  EXPECT_FALSE(this->cpu.get_flag(nes::Flag::CARRY));
+  EXPECT_TRUE(this->cpu.get_flag(nes::Flag::OVERFLOW_));
+  EXPECT_TRUE(this->cpu.get_flag(nes::Flag::NEGATIVE));
+}
+
+TYPED_TEST(CPUDecimalTest, binary_sbc_is_the_same_on_every_variant) {
+  EXPECT_EQ(this->execute(nes::Opcode::SBC_IMM, 0x10, 0x20, true, false), 2);
+  EXPECT_EQ(this->cpu.get_accumulator(), 0xF0);
+  EXPECT_FALSE(this->cpu.get_flag(nes::Flag::CARRY));
+  EXPECT_TRUE(this->cpu.get_flag(nes::Flag::NEGATIVE));
+}
+
+TYPED_TEST(CPUDecimalTest, adc_basic_addition) {
+  const nes::u8 cycles = this->execute(nes::Opcode::ADC_IMM, 0x15, 0x27, false, true);
+
+  // 15 + 27 = 42 in BCD, the 2A03 adds in binary
+  EXPECT_EQ(this->cpu.get_accumulator(), this->HAS_DECIMAL ? 0x42 : 0x3C);
+  EXPECT_FALSE(this->cpu.get_flag(nes::Flag::CARRY));
+  EXPECT_EQ(cycles, this->IS_65C02 ? 3 : 2);
+}
+
+TYPED_TEST(CPUDecimalTest, adc_addition_with_carry_in_and_out) {
+  this->execute(nes::Opcode::ADC_IMM, 0x58, 0x46, true, true);
+
+  // 58 + 46 + 1 = 105 in BCD, 0x58 + 0x46 + 1 = 0x9F in binary
+  if (this->HAS_DECIMAL) {
+    EXPECT_EQ(this->cpu.get_accumulator(), 0x05);
+    EXPECT_TRUE(this->cpu.get_flag(nes::Flag::CARRY));
+  } else {
+    EXPECT_EQ(this->cpu.get_accumulator(), 0x9F);
+    EXPECT_FALSE(this->cpu.get_flag(nes::Flag::CARRY));
+  }
+}
+
+TYPED_TEST(CPUDecimalTest, adc_result_zero_flags) {
+  this->execute(nes::Opcode::ADC_IMM, 0x99, 0x01, false, true);
+
+  if (!this->HAS_DECIMAL) {
+    EXPECT_EQ(this->cpu.get_accumulator(), 0x9A);
+    return;
+  }
+
+  // 99 + 1 = 100. The NMOS 6502 takes Z from the binary sum ($9A) and N from
+  // the sum before the high nibble is adjusted ($A0); the 65C02 uses the result.
+  EXPECT_EQ(this->cpu.get_accumulator(), 0x00);
+  EXPECT_TRUE(this->cpu.get_flag(nes::Flag::CARRY));
+  EXPECT_EQ(this->cpu.get_flag(nes::Flag::ZERO), this->IS_65C02);
+  EXPECT_EQ(this->cpu.get_flag(nes::Flag::NEGATIVE), !this->IS_65C02);
+}
+
+TYPED_TEST(CPUDecimalTest, adc_overflow_positive_to_negative) {
+  this->execute(nes::Opcode::ADC_IMM, 0x79, 0x10, false, true);
+
+  // 79 + 10 = 89, V follows the signed sum before the high nibble is adjusted
+  EXPECT_EQ(this->cpu.get_accumulator(), 0x89);
+  EXPECT_TRUE(this->cpu.get_flag(nes::Flag::OVERFLOW_));
+  EXPECT_FALSE(this->cpu.get_flag(nes::Flag::CARRY));
+}
+
+TYPED_TEST(CPUDecimalTest, adc_zero_page) {
+  this->bus.write(0x0010, 0x25);
+  this->execute(nes::Opcode::ADC_ZPG, 0x38, 0x10, false, true);
+
+  EXPECT_EQ(this->cpu.get_accumulator(), this->HAS_DECIMAL ? 0x63 : 0x5D);
+}
+
+TYPED_TEST(CPUDecimalTest, sbc_basic_subtraction_carry_set) {
+  const nes::u8 cycles = this->execute(nes::Opcode::SBC_IMM, 0x46, 0x12, true, true);
+
+  EXPECT_EQ(this->cpu.get_accumulator(), 0x34);
+  EXPECT_TRUE(this->cpu.get_flag(nes::Flag::CARRY));
+  EXPECT_EQ(cycles, this->IS_65C02 ? 3 : 2);
+}
+
+TYPED_TEST(CPUDecimalTest, sbc_basic_subtraction_carry_clear) {
+  this->execute(nes::Opcode::SBC_IMM, 0x40, 0x13, false, true);
+
+  // 40 - 13 - 1 = 26 in BCD, 0x40 - 0x13 - 1 = 0x2C in binary
+  EXPECT_EQ(this->cpu.get_accumulator(), this->HAS_DECIMAL ? 0x26 : 0x2C);
+  EXPECT_TRUE(this->cpu.get_flag(nes::Flag::CARRY));
+}
+
+TYPED_TEST(CPUDecimalTest, sbc_with_borrow_out) {
+  this->execute(nes::Opcode::SBC_IMM, 0x12, 0x21, true, true);
+
+  // 12 - 21 = -9, which wraps to 91 in BCD
+  EXPECT_EQ(this->cpu.get_accumulator(), this->HAS_DECIMAL ? 0x91 : 0xF1);
+  EXPECT_FALSE(this->cpu.get_flag(nes::Flag::CARRY));
+  EXPECT_TRUE(this->cpu.get_flag(nes::Flag::NEGATIVE));
+}
+
+TYPED_TEST(CPUDecimalTest, sbc_result_zero_flags) {
+  this->execute(nes::Opcode::SBC_IMM, 0x00, 0x01, false, true);
+
+  if (!this->HAS_DECIMAL) {
+    EXPECT_EQ(this->cpu.get_accumulator(), 0xFE);
+    return;
+  }
+
+  // 0 - 1 - 1 = 98 with a borrow. The NMOS 6502 leaves N and Z from the
+  // binary difference ($FE), the 65C02 from the result.
+  EXPECT_EQ(this->cpu.get_accumulator(), 0x98);
+  EXPECT_FALSE(this->cpu.get_flag(nes::Flag::CARRY));
+  EXPECT_TRUE(this->cpu.get_flag(nes::Flag::NEGATIVE));
+  EXPECT_FALSE(this->cpu.get_flag(nes::Flag::ZERO));
+}
+
+TYPED_TEST(CPUDecimalTest, sbc_zero_result) {
+  this->execute(nes::Opcode::SBC_IMM, 0x50, 0x50, true, true);
+
+  EXPECT_EQ(this->cpu.get_accumulator(), 0x00);
+  EXPECT_TRUE(this->cpu.get_flag(nes::Flag::ZERO));
+  EXPECT_TRUE(this->cpu.get_flag(nes::Flag::CARRY));
+}
+
+TYPED_TEST(CPUDecimalTest, decimal_sequence) {
+  // Counts 0 to 99 in BCD one ADC #1 at a time
+  this->execute(nes::Opcode::ADC_IMM, 0x00, 0x01, false, true);
+  for (int i = 1; i < 99; i++) {
+    this->cpu.set_pc(0x0204);
+    this->cpu.set_flag(nes::Flag::CARRY, false);
+    this->cpu.step_instruction();
+  }
+
+  EXPECT_EQ(this->cpu.get_accumulator(), this->HAS_DECIMAL ? 0x99 : 99);
+}
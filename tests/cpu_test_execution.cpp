@@ -0,0 +1,119 @@
+#include "cpu_test_base.h"
+
+class CPUExecutionTest : public CPUTestBase {
+ protected:
+  void SetUp() override {
+    cpu.reset();
+    cpu.set_pc(0x0200);
+  }
+};
+
+TEST_F(CPUExecutionTest, step_instruction_returns_base_cycles) {
+  bus.write(0x0200, (nes::u8)(nes::Opcode::LDA_IMM));
+  bus.write(0x0201, 0x42);
+
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.get_accumulator(), 0x42);
+  EXPECT_EQ(cpu.get_pc(), 0x0202);
+  EXPECT_EQ(cpu.get_remaining_cycles(), 0);
+}
+
+TEST_F(CPUExecutionTest, step_instruction_includes_page_cross_penalty) {
+  bus.write(0x0200, (nes::u8)(nes::Opcode::LDX_IMM));
+  bus.write(0x0201, 0x01);
+  bus.write(0x0202, (nes::u8)(nes::Opcode::LDA_ABX));
+  bus.write(0x0203, 0xFF);
+  bus.write(0x0204, 0x00);  // $00FF + X crosses into page $01
+  bus.write(0x0100, 0x37);
+
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.step_instruction(), 5);
+  EXPECT_EQ(cpu.get_accumulator(), 0x37);
+}
+
+TEST_F(CPUExecutionTest, step_instruction_includes_branch_penalties) {
+  cpu.set_flag(nes::Flag::ZERO, false);
+
+  // Taken branch on the same page costs one extra cycle
+  bus.write(0x0200, (nes::u8)(nes::Opcode::BNE_REL));
+  bus.write(0x0201, 0x02);
+  EXPECT_EQ(cpu.step_instruction(), 3);
+  EXPECT_EQ(cpu.get_pc(), 0x0204);
+
+  // Taken branch into another page costs two extra cycles
+  cpu.set_pc(0x02F0);
+  bus.write(0x02F0, (nes::u8)(nes::Opcode::BNE_REL));
+  bus.write(0x02F1, 0x20);
+  EXPECT_EQ(cpu.step_instruction(), 4);
+  EXPECT_EQ(cpu.get_pc(), 0x0312);
+
+  // Branch not taken only costs the base cycles
+  cpu.set_flag(nes::Flag::ZERO, true);
+  cpu.set_pc(0x0200);
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.get_pc(), 0x0202);
+}
+
+TEST_F(CPUExecutionTest, step_instruction_finishes_instruction_started_by_clock) {
+  bus.write(0x0200, (nes::u8)(nes::Opcode::LDA_ZPG));
+  bus.write(0x0201, 0x10);
+  bus.write(0x0202, (nes::u8)(nes::Opcode::NOP_IMP));
+
+  cpu.clock();
+  EXPECT_EQ(cpu.get_remaining_cycles(), 2);
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.get_remaining_cycles(), 0);
+  EXPECT_EQ(cpu.get_pc(), 0x0202);
+
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.get_pc(), 0x0203);
+}
+
+TEST_F(CPUExecutionTest, run_stops_at_instruction_boundary_after_budget) {
+  for (nes::u16 addr = 0x0200; addr < 0x0210; addr++) {
+    bus.write(addr, (nes::u8)(nes::Opcode::INX_IMP));
+  }
+
+  // 5 cycles cannot be split, the third INX still runs to completion
+  EXPECT_EQ(cpu.run(5), 6);
+  EXPECT_EQ(cpu.get_x(), 3);
+  EXPECT_EQ(cpu.get_pc(), 0x0203);
+  EXPECT_EQ(cpu.get_remaining_cycles(), 0);
+}
+
+TEST_F(CPUExecutionTest, run_matches_per_cycle_clock) {
+  // Count X down from 5 to 0 with DEX/BNE
+  bus.write(0x0200, (nes::u8)(nes::Opcode::LDX_IMM));
+  bus.write(0x0201, 0x05);
+  bus.write(0x0202, (nes::u8)(nes::Opcode::DEX_IMP));
+  bus.write(0x0203, (nes::u8)(nes::Opcode::BNE_REL));
+  bus.write(0x0204, 0xFD);
+
+  // LDX (2) + 4 taken loops (2 + 3) + final DEX/BNE not taken (2 + 2)
+  const nes::u64 expected_cycles = 2 + 4 * 5 + 4;
+  EXPECT_EQ(cpu.run(expected_cycles), expected_cycles);
+  EXPECT_EQ(cpu.get_x(), 0);
+  EXPECT_EQ(cpu.get_pc(), 0x0205);
+
+  cpu.reset();
+  cpu.set_pc(0x0200);
+  execute_cycles(expected_cycles);
+  EXPECT_EQ(cpu.get_x(), 0);
+  EXPECT_EQ(cpu.get_pc(), 0x0205);
+}
+
+TEST_F(CPUExecutionTest, dynamic_cpu_matches_inlined_cpu) {
+  nes::DynamicCPU dynamic_cpu{bus};
+  dynamic_cpu.set_pc(0x0200);
+
+  bus.write(0x0200, (nes::u8)(nes::Opcode::LDA_IMM));
+  bus.write(0x0201, 0x80);
+  bus.write(0x0202, (nes::u8)(nes::Opcode::STA_ZPG));
+  bus.write(0x0203, 0x10);
+
+  EXPECT_EQ(dynamic_cpu.run(5), cpu.run(5));
+  EXPECT_EQ(dynamic_cpu.get_accumulator(), cpu.get_accumulator());
+  EXPECT_EQ(dynamic_cpu.get_status(), cpu.get_status());
+  EXPECT_EQ(dynamic_cpu.get_pc(), cpu.get_pc());
+  EXPECT_EQ(bus.read(0x0010), 0x80);
+}
@@ -0,0 +1,161 @@
+#include <stdexcept>
+#include "cpu_test_base.h"
+
+// $02 is a JAM opcode with no table entry
+static constexpr nes::u8 UNKNOWN_OPCODE = 0x02;
+
+class CPUFaultTest : public CPUTestBase {
+ protected:
+  void SetUp() override {
+    cpu.reset();
+    cpu.set_pc(0x0200);
+
+    bus.write(0x0200, (nes::u8)(nes::Opcode::INX_IMP));
+    bus.write(0x0201, UNKNOWN_OPCODE);
+    bus.write(0x0202, (nes::u8)(nes::Opcode::INX_IMP));
+    bus.write(0x0203, (nes::u8)(nes::Opcode::INX_IMP));
+  }
+};
+
+TEST_F(CPUFaultTest, halts_by_default) {
+  EXPECT_EQ(cpu.get_fault_policy(), nes::FaultPolicy::HALT);
+
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.step_instruction(), 0);
+  EXPECT_TRUE(cpu.is_halted());
+  EXPECT_EQ(cpu.get_fault(), nes::Fault::UNKNOWN_OPCODE);
+  EXPECT_EQ(cpu.get_fault_opcode(), UNKNOWN_OPCODE);
+  EXPECT_EQ(cpu.get_pc(), 0x0201);
+
+  // Nothing runs while halted
+  EXPECT_EQ(cpu.step_instruction(), 0);
+  execute_cycles(10);
+  EXPECT_EQ(cpu.get_pc(), 0x0201);
+  EXPECT_EQ(cpu.get_x(), 1);
+}
+
+TEST_F(CPUFaultTest, run_returns_early_when_halted) {
+  EXPECT_EQ(cpu.run(100), 2);
+  EXPECT_TRUE(cpu.is_halted());
+  EXPECT_EQ(cpu.run(100), 0);
+
+  nes::Scheduler scheduler;
+  EXPECT_EQ(cpu.run_until(scheduler, 100), 0);
+}
+
+TEST_F(CPUFaultTest, block_cache_run_returns_early_when_halted) {
+  ASSERT_TRUE(cpu.set_block_cache_enabled(true));
+  EXPECT_EQ(cpu.run(100), 2);
+  EXPECT_TRUE(cpu.is_halted());
+  EXPECT_EQ(cpu.get_pc(), 0x0201);
+}
+
+TEST_F(CPUFaultTest, clear_fault_resumes_after_patching) {
+  cpu.run(100);
+  bus.write(0x0201, (nes::u8)(nes::Opcode::INX_IMP));
+  cpu.clear_fault();
+
+  EXPECT_FALSE(cpu.is_halted());
+  EXPECT_EQ(cpu.get_fault(), nes::Fault::NONE);
+  EXPECT_EQ(cpu.run(6), 6);
+  EXPECT_EQ(cpu.get_x(), 4);
+}
+
+TEST_F(CPUFaultTest, reset_clears_fault) {
+  cpu.run(100);
+  cpu.reset();
+  EXPECT_FALSE(cpu.is_halted());
+  EXPECT_EQ(cpu.get_fault(), nes::Fault::NONE);
+}
+
+TEST_F(CPUFaultTest, nop_policy_skips_opcode) {
+  cpu.set_fault_policy(nes::FaultPolicy::NOP);
+
+  EXPECT_EQ(cpu.run(8), 8);
+  EXPECT_FALSE(cpu.is_halted());
+  EXPECT_EQ(cpu.get_x(), 3);
+  EXPECT_EQ(cpu.get_pc(), 0x0204);
+}
+
+TEST_F(CPUFaultTest, hook_policy_calls_hook_on_opcode) {
+  cpu.set_fault_policy(nes::FaultPolicy::HOOK);
+  cpu.set_fault_hook([](nes::CPU &faulting_cpu, nes::u8 opcode) -> nes::u8 {
+    EXPECT_EQ(opcode, UNKNOWN_OPCODE);
+    EXPECT_EQ(faulting_cpu.get_pc(), 0x0201);
+
+    // Treat it as a two byte instruction
+    faulting_cpu.set_pc(faulting_cpu.get_pc() + 2);
+    return 3;
+  });
+
+  cpu.step_instruction();
+  EXPECT_EQ(cpu.step_instruction(), 3);
+  EXPECT_EQ(cpu.get_pc(), 0x0203);
+  EXPECT_FALSE(cpu.is_halted());
+}
+
+TEST_F(CPUFaultTest, hook_policy_halts_when_hook_declines) {
+  cpu.set_fault_policy(nes::FaultPolicy::HOOK);
+  cpu.set_fault_hook([](nes::CPU &, nes::u8) -> nes::u8 { return 0; });
+
+  EXPECT_EQ(cpu.run(100), 2);
+  EXPECT_TRUE(cpu.is_halted());
+  EXPECT_EQ(cpu.get_pc(), 0x0201);
+}
+
+TEST_F(CPUFaultTest, throw_policy_throws) {
+  cpu.set_fault_policy(nes::FaultPolicy::THROW);
+
+  cpu.step_instruction();
+  EXPECT_THROW(cpu.step_instruction(), std::runtime_error);
+}
+
+TEST_F(CPUFaultTest, throw_policy_throws_after_translated_loop) {
+  if (!cpu.set_jit_enabled(true)) GTEST_SKIP() << "JIT not supported on this platform";
+  cpu.set_fault_policy(nes::FaultPolicy::THROW);
+
+  // INX; CPX #$20; BNE -5; then the unknown opcode once the loop is hot
+  bus.write(0x0200, (nes::u8)(nes::Opcode::INX_IMP));
+  bus.write(0x0201, (nes::u8)(nes::Opcode::CPX_IMM));
+  bus.write(0x0202, 0x20);
+  bus.write(0x0203, (nes::u8)(nes::Opcode::BNE_REL));
+  bus.write(0x0204, 0xFB);
+  bus.write(0x0205, UNKNOWN_OPCODE);
+
+  EXPECT_THROW(cpu.run(1000), std::runtime_error);
+  EXPECT_EQ(cpu.get_x(), 0x20);
+  EXPECT_EQ(cpu.get_pc(), 0x0206);
+}
+
+TEST_F(CPUFaultTest, device_exception_leaves_translated_block) {
+  class ThrowingDevice final : public nes::Addressable {
+   public:
+    nes::u8 read(nes::u16) const override { return 0; }
+    void write(nes::u16, nes::u8) override {
+      if (++writes == 40) throw std::runtime_error("device fault");
+    }
+    bool handles_address(nes::u16 address) const override { return (address >> 8) == 0x50; }
+    int writes = 0;
+  } device;
+  bus.map_device(0x50, &device);
+  if (!cpu.set_jit_enabled(true)) GTEST_SKIP() << "JIT not supported on this platform";
+
+  // Loop: STX $5000; INX; BNE loop. The store goes through the handler from
+  // translated code, so the exception has to get past it to reach run()
+  bus.write(0x0200, (nes::u8)(nes::Opcode::STX_ABS));
+  bus.write(0x0201, 0x00);
+  bus.write(0x0202, 0x50);
+  bus.write(0x0203, (nes::u8)(nes::Opcode::INX_IMP));
+  bus.write(0x0204, (nes::u8)(nes::Opcode::BNE_REL));
+  bus.write(0x0205, 0xFA);
+
+  EXPECT_THROW(cpu.run(10000), std::runtime_error);
+  EXPECT_EQ(device.writes, 40);
+  EXPECT_EQ(cpu.get_x(), 39);
+
+  // Nothing is left pending, the next run carries on after the store
+  EXPECT_FALSE(cpu.is_halted());
+  cpu.run(9);
+  EXPECT_EQ(device.writes, 41);
+  EXPECT_EQ(cpu.get_x(), 40);
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include "../include/cpu.h"
+#include "../include/flat_bus.h"
+
+class CPUFlatBusTest : public ::testing::Test {
+ protected:
+  void SetUp() override { cpu.reset(); }
+
+  void load(nes::u16 address, std::initializer_list<nes::u8> bytes) { bus.write_block(address, bytes.begin(), bytes.size()); }
+
+  nes::FlatBus bus;
+  nes::FlatCPU6502 cpu{bus};
+};
+
+TEST_F(CPUFlatBusTest, every_address_is_plain_ram) {
+  bus.write(0x0123, 0x42);
+  EXPECT_EQ(bus.read(0x0123), 0x42);
+  EXPECT_EQ(bus.read(0x0923), 0x00);  // No mirrors
+  bus.write(0x8000, 0x55);
+  EXPECT_EQ(bus.read(0x8000), 0x55);
+
+  bus.fill(0xFFFE, 0xEE, 3);
+  EXPECT_EQ(bus.read(0xFFFF), 0xEE);
+  EXPECT_EQ(bus.read(0x0000), 0xEE);
+
+  std::array<nes::u8, 4> data{};
+  bus.read_block(0xFFFE, data.data(), data.size());
+  EXPECT_EQ(data[2], 0xEE);
+  EXPECT_EQ(data[3], 0x00);
+}
+
+TEST_F(CPUFlatBusTest, runs_code_anywhere_in_decimal_mode) {
+  // SED / CLC / LDA #$19 / ADC #$28 / STA $C000 / JMP $E009
+  load(0xE000, {(nes::u8)nes::Opcode::SED_IMP, (nes::u8)nes::Opcode::CLC_IMP, (nes::u8)nes::Opcode::LDA_IMM, 0x19,
+                (nes::u8)nes::Opcode::ADC_IMM, 0x28, (nes::u8)nes::Opcode::STA_ABS, 0x00, 0xC0,
+                (nes::u8)nes::Opcode::JMP_ABS, 0x09, 0xE0});
+  cpu.set_pc(0xE000);
+  for (int i = 0; i < 6; i++) cpu.step_instruction();
+  EXPECT_EQ(bus.read(0xC000), 0x47);
+  EXPECT_EQ(cpu.get_pc(), 0xE009);
+
+  // The self jump is an idle loop, skipped since flat memory has no side effects
+  ASSERT_TRUE(cpu.is_idle_loop_skip_enabled());
+  EXPECT_EQ(cpu.run(3000), 3000u);
+  EXPECT_GT(cpu.get_idle_cycles_skipped(), 0u);
+  EXPECT_EQ(cpu.get_pc(), 0xE009);
+}
+
+TEST_F(CPUFlatBusTest, block_cache_sees_code_writes) {
+  ASSERT_TRUE(cpu.set_block_cache_enabled(true));
+  // LDA #$11 / STA $8001 / JMP $8000
+  load(0x8000, {(nes::u8)nes::Opcode::LDA_IMM, 0x11, (nes::u8)nes::Opcode::STA_ABS, 0x01, 0x80,
+                (nes::u8)nes::Opcode::JMP_ABS, 0x00, 0x80});
+  cpu.set_pc(0x8000);
+  cpu.run(2 + 4 + 3);
+  EXPECT_EQ(cpu.get_accumulator(), 0x11);
+
+  bus.write(0x8001, 0x22);
+  cpu.run(2 + 4 + 3);
+  EXPECT_EQ(cpu.get_accumulator(), 0x22);
+}
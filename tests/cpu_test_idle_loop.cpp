@@ -0,0 +1,184 @@
+#include "cpu_test_base.h"
+
+// Every case runs twice, once with idle-loop skipping and once on a reference
+// CPU without it, and both must end in exactly the same state
+class CPUIdleLoopTest : public CPUTestBase {
+ protected:
+  void SetUp() override {
+    cpu.reset();
+    cpu.set_pc(0x0200);
+    reference.reset();
+    reference.set_pc(0x0200);
+    reference.set_idle_loop_skip_enabled(false);
+  }
+
+  void load(nes::u16 address, std::initializer_list<nes::u8> bytes) {
+    bus.write_block(address, bytes.begin(), bytes.size());
+    reference_bus.write_block(address, bytes.begin(), bytes.size());
+  }
+
+  void expect_same_state() {
+    EXPECT_EQ(cpu.get_pc(), reference.get_pc());
+    EXPECT_EQ(cpu.get_accumulator(), reference.get_accumulator());
+    EXPECT_EQ(cpu.get_x(), reference.get_x());
+    EXPECT_EQ(cpu.get_y(), reference.get_y());
+    EXPECT_EQ(cpu.get_sp(), reference.get_sp());
+    EXPECT_EQ(cpu.get_status(), reference.get_status());
+  }
+
+  nes::Bus reference_bus;
+  nes::CPU reference{reference_bus};
+};
+
+TEST_F(CPUIdleLoopTest, enabled_by_default_on_bus_only) {
+  EXPECT_TRUE(cpu.is_idle_loop_skip_enabled());
+  EXPECT_FALSE(reference.is_idle_loop_skip_enabled());
+
+  nes::DynamicCPU dynamic_cpu{bus};
+  EXPECT_FALSE(dynamic_cpu.is_idle_loop_skip_enabled());
+  EXPECT_FALSE(dynamic_cpu.set_idle_loop_skip_enabled(true));
+}
+
+TEST_F(CPUIdleLoopTest, jmp_to_itself_is_skipped) {
+  load(0x0200, {(nes::u8)nes::Opcode::JMP_ABS, 0x00, 0x02});
+
+  EXPECT_EQ(cpu.run(100000), reference.run(100000));
+  EXPECT_GT(cpu.get_idle_cycles_skipped(), 99000u);
+  expect_same_state();
+}
+
+TEST_F(CPUIdleLoopTest, budget_ending_mid_iteration_matches_interpreter) {
+  // BIT (3) + BPL taken (3), the budget stops after a BIT
+  load(0x0200, {(nes::u8)nes::Opcode::BIT_ZPG, 0x10, (nes::u8)nes::Opcode::BPL_REL, 0xFC});
+
+  EXPECT_EQ(cpu.run(10003), reference.run(10003));
+  EXPECT_GT(cpu.get_idle_cycles_skipped(), 0u);
+  expect_same_state();
+}
+
+TEST_F(CPUIdleLoopTest, polling_loop_leaves_when_event_changes_memory) {
+  //   0200  LDA $10
+  //   0202  BEQ $0200
+  //   0204  LDX #$01
+  //   0206  JMP $0206
+  load(0x0200, {(nes::u8)nes::Opcode::LDA_ZPG, 0x10, (nes::u8)nes::Opcode::BEQ_REL, 0xFC,
+                (nes::u8)nes::Opcode::LDX_IMM, 0x01, (nes::u8)nes::Opcode::JMP_ABS, 0x06, 0x02});
+
+  nes::Scheduler scheduler;
+  nes::Scheduler reference_scheduler;
+  nes::u64 fired = 0;
+  nes::u64 reference_fired = 0;
+  scheduler.schedule(5000, [&] {
+    fired = scheduler.get_cycle();
+    bus.write(0x0010, 0x42);
+  });
+  reference_scheduler.schedule(5000, [&] {
+    reference_fired = reference_scheduler.get_cycle();
+    reference_bus.write(0x0010, 0x42);
+  });
+
+  EXPECT_EQ(cpu.run_until(scheduler, 20000), reference.run_until(reference_scheduler, 20000));
+  EXPECT_EQ(fired, reference_fired);
+  EXPECT_EQ(cpu.get_x(), 0x01);
+  EXPECT_GT(cpu.get_idle_cycles_skipped(), 10000u);
+  expect_same_state();
+}
+
+TEST_F(CPUIdleLoopTest, irq_is_taken_on_the_same_cycle) {
+  load(0x0200, {(nes::u8)nes::Opcode::CLI_IMP, (nes::u8)nes::Opcode::JMP_ABS, 0x01, 0x02});
+
+  nes::Scheduler scheduler;
+  nes::Scheduler reference_scheduler;
+  scheduler.schedule(1001, [&] { cpu.set_irq_line(true); });
+  reference_scheduler.schedule(1001, [&] { reference.set_irq_line(true); });
+
+  EXPECT_EQ(cpu.run_until(scheduler, 1010), reference.run_until(reference_scheduler, 1010));
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::INTERRUPT_DISABLE));
+  EXPECT_GT(cpu.get_idle_cycles_skipped(), 0u);
+  expect_same_state();
+}
+
+TEST_F(CPUIdleLoopTest, loops_that_change_state_are_not_skipped) {
+  // DEX/BNE counts, so no two iterations look the same
+  load(0x0200, {(nes::u8)nes::Opcode::DEX_IMP, (nes::u8)nes::Opcode::BNE_REL, 0xFD, (nes::u8)nes::Opcode::JMP_ABS, 0x00, 0x02});
+
+  EXPECT_EQ(cpu.run(5000), reference.run(5000));
+  EXPECT_EQ(cpu.get_idle_cycles_skipped(), 0u);
+  expect_same_state();
+}
+
+TEST_F(CPUIdleLoopTest, loops_that_write_memory_are_not_skipped) {
+  load(0x0200, {(nes::u8)nes::Opcode::STA_ZPG, 0x10, (nes::u8)nes::Opcode::JMP_ABS, 0x00, 0x02});
+
+  cpu.run(5000);
+  EXPECT_EQ(cpu.get_idle_cycles_skipped(), 0u);
+}
+
+TEST_F(CPUIdleLoopTest, alternating_loops_are_each_checked_once) {
+  // Two loops that store, so neither can be idle, taking turns 256 iterations at a time
+  //   0200  STA $10
+  //   0202  DEX
+  //   0203  BNE $0200
+  //   0205  STA $11
+  //   0207  DEY
+  //   0208  BNE $0205
+  //   020A  JMP $0200
+  load(0x0200, {(nes::u8)nes::Opcode::STA_ZPG, 0x10, (nes::u8)nes::Opcode::DEX_IMP, (nes::u8)nes::Opcode::BNE_REL, 0xFB,
+                (nes::u8)nes::Opcode::STA_ZPG, 0x11, (nes::u8)nes::Opcode::DEY_IMP, (nes::u8)nes::Opcode::BNE_REL, 0xFB,
+                (nes::u8)nes::Opcode::JMP_ABS, 0x00, 0x02});
+
+  EXPECT_EQ(cpu.run(100000), reference.run(100000));
+  EXPECT_EQ(cpu.get_idle_cycles_skipped(), 0u);
+  EXPECT_EQ(cpu.get_idle_loop_checks(), 2u);
+  expect_same_state();
+}
+
+TEST_F(CPUIdleLoopTest, branch_stats_include_skipped_iterations) {
+  load(0x0200, {(nes::u8)nes::Opcode::LDA_ZPG, 0x10, (nes::u8)nes::Opcode::BEQ_REL, 0xFC});
+  cpu.set_branch_stats_enabled(true);
+  reference.set_branch_stats_enabled(true);
+
+  cpu.run(6000);
+  reference.run(6000);
+  EXPECT_GT(cpu.get_idle_cycles_skipped(), 0u);
+  EXPECT_EQ(cpu.get_branch_stats(0x0202).taken, reference.get_branch_stats(0x0202).taken);
+}
+
+TEST_F(CPUIdleLoopTest, branch_stats_match_for_bra) {
+  nes::Bus bus_65c02;
+  nes::Bus reference_bus_65c02;
+  nes::CPU65C02 cpu_65c02{bus_65c02};
+  nes::CPU65C02 reference_65c02{reference_bus_65c02};
+  for (nes::Bus *memory : {&bus_65c02, &reference_bus_65c02}) {
+    memory->write(0x0200, (nes::u8)nes::Opcode::BRA_REL);
+    memory->write(0x0201, 0xFE);
+  }
+  for (nes::CPU65C02 *core : {&cpu_65c02, &reference_65c02}) {
+    core->reset();
+    core->set_pc(0x0200);
+    core->set_branch_stats_enabled(true);
+  }
+  reference_65c02.set_idle_loop_skip_enabled(false);
+
+  EXPECT_EQ(cpu_65c02.run(3000), reference_65c02.run(3000));
+  EXPECT_GT(cpu_65c02.get_idle_cycles_skipped(), 0u);
+  EXPECT_EQ(cpu_65c02.get_branch_stats(0x0200).taken, reference_65c02.get_branch_stats(0x0200).taken);
+  EXPECT_EQ(reference_65c02.get_branch_stats(0x0200).taken, 1000u);
+}
+
+TEST_F(CPUIdleLoopTest, block_cache_skips_the_same_way) {
+  load(0x0200, {(nes::u8)nes::Opcode::BIT_ABS, 0x00, 0x03, (nes::u8)nes::Opcode::BPL_REL, 0xFB});
+  ASSERT_TRUE(cpu.set_block_cache_enabled(true));
+
+  EXPECT_EQ(cpu.run(20001), reference.run(20001));
+  EXPECT_GT(cpu.get_idle_cycles_skipped(), 19000u);
+  expect_same_state();
+}
+
+TEST_F(CPUIdleLoopTest, disabled_skip_runs_every_iteration) {
+  load(0x0200, {(nes::u8)nes::Opcode::JMP_ABS, 0x00, 0x02});
+
+  EXPECT_FALSE(cpu.set_idle_loop_skip_enabled(false));
+  cpu.run(3000);
+  EXPECT_EQ(cpu.get_idle_cycles_skipped(), 0u);
+}
@@ -11,3 +11,17 @@ TEST_F(CPUTestInit, initialization) {
   EXPECT_EQ(cpu.get_status() & 0x30, 0x30); // UNUSED and BREAK flags
   EXPECT_EQ(cpu.get_remaining_cycles(), 0); // Should start with 0 cycles
 }
+
+TEST_F(CPUTestInit, instruction_table_metadata) {
+  EXPECT_EQ(cpu.get_instruction(nes::Opcode::LDA_ABX).cycles, 4);
+  EXPECT_TRUE(cpu.get_instruction(nes::Opcode::LDA_ABX).flags & nes::CPU::Instruction::EXTRA_CYCLE);
+  EXPECT_TRUE(cpu.get_instruction(nes::Opcode::TAX_IMP).flags & nes::CPU::Instruction::IMPLIED);
+
+  const nes::InstructionInfo &info = nes::CPU::get_instruction_info((nes::u8)nes::Opcode::ASL_ACC);
+  EXPECT_STREQ(info.mnemonic, "ASL");
+  EXPECT_STREQ(info.mode, "ACC");
+
+  // Unlisted opcodes stay invalid
+  EXPECT_EQ(cpu.get_instruction((nes::Opcode)0x02).cycles, 0);
+  EXPECT_STREQ(nes::CPU::get_instruction_info(0x02).mnemonic, "???");
+}
@@ -0,0 +1,156 @@
+#include "cpu_test_base.h"
+
+class CPUInterruptTest : public CPUTestBase {
+ protected:
+  void SetUp() override {
+    cpu.reset();
+    cpu.set_pc(0x0200);
+    cpu.set_flag(nes::Flag::INTERRUPT_DISABLE, false);
+
+    // NOPs at the interrupted code
+    for (nes::u16 addr = 0x0200; addr < 0x0210; addr++) {
+      bus.write(addr, (nes::u8)(nes::Opcode::NOP_IMP));
+    }
+
+    // IRQ handler at $0300. The NMI vector at $FFFA is left at 0, so NMIs
+    // go to $0000.
+    bus.write(0xFFFE, 0x00);
+    bus.write(0xFFFF, 0x03);
+    bus.write(0x0300, (nes::u8)(nes::Opcode::NOP_IMP));
+    bus.write(0x0000, (nes::u8)(nes::Opcode::NOP_IMP));
+  }
+
+  nes::u16 pushed_pc() const {
+    nes::u8 sp = cpu.get_sp();
+    return (bus.read(0x0100 + sp + 3) << 8) | bus.read(0x0100 + sp + 2);
+  }
+
+  nes::u8 pushed_status() const { return bus.read(0x0100 + cpu.get_sp() + 1); }
+};
+
+TEST_F(CPUInterruptTest, irq_enters_handler_in_seven_cycles) {
+  cpu.set_flag(nes::Flag::CARRY, true);
+  const nes::u8 status = cpu.get_status();
+  const nes::u8 sp = cpu.get_sp();
+
+  cpu.set_irq_line(true);
+  EXPECT_EQ(cpu.step_instruction(), 7);
+  EXPECT_EQ(cpu.get_pc(), 0x0300);
+  EXPECT_EQ(cpu.get_sp(), (nes::u8)(sp - 3));
+  EXPECT_EQ(pushed_pc(), 0x0200);
+
+  // B is clear in the pushed status, unlike BRK
+  EXPECT_EQ(pushed_status(), (status & ~(nes::u8)nes::Flag::BREAK) | (nes::u8)nes::Flag::UNUSED);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::INTERRUPT_DISABLE));
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::CARRY));
+}
+
+TEST_F(CPUInterruptTest, irq_entry_is_seven_clocks) {
+  cpu.set_irq_line(true);
+
+  cpu.clock();
+  EXPECT_EQ(cpu.get_pc(), 0x0300);
+  EXPECT_EQ(cpu.get_remaining_cycles(), 6);
+  execute_cycles(6);
+
+  // The handler's first instruction starts on the next clock
+  cpu.clock();
+  EXPECT_EQ(cpu.get_pc(), 0x0301);
+}
+
+TEST_F(CPUInterruptTest, irq_is_masked_by_interrupt_disable) {
+  cpu.set_flag(nes::Flag::INTERRUPT_DISABLE, true);
+  cpu.set_irq_line(true);
+
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.get_pc(), 0x0201);
+  EXPECT_TRUE(cpu.is_irq_line_active());
+
+  // Taken as soon as the flag is cleared while the line is still active
+  cpu.set_flag(nes::Flag::INTERRUPT_DISABLE, false);
+  EXPECT_EQ(cpu.step_instruction(), 7);
+  EXPECT_EQ(cpu.get_pc(), 0x0300);
+}
+
+TEST_F(CPUInterruptTest, irq_is_level_triggered) {
+  // Handler clears I without acknowledging the device, so the IRQ is taken again
+  bus.write(0x0300, (nes::u8)(nes::Opcode::CLI_IMP));
+  bus.write(0x0301, (nes::u8)(nes::Opcode::NOP_IMP));
+  cpu.set_irq_line(true);
+
+  EXPECT_EQ(cpu.step_instruction(), 7);
+  EXPECT_EQ(cpu.step_instruction(), 2);  // CLI
+  EXPECT_EQ(cpu.step_instruction(), 7);
+  EXPECT_EQ(cpu.get_pc(), 0x0300);
+  EXPECT_EQ(pushed_pc(), 0x0301);
+
+  cpu.set_irq_line(false);
+  EXPECT_EQ(cpu.step_instruction(), 2);  // CLI
+  EXPECT_EQ(cpu.step_instruction(), 2);  // Next byte, no interrupt this time
+  EXPECT_EQ(cpu.get_pc(), 0x0302);
+}
+
+TEST_F(CPUInterruptTest, rti_returns_from_irq) {
+  bus.write(0x0300, (nes::u8)(nes::Opcode::RTI_IMP));
+  cpu.set_irq_line(true);
+
+  EXPECT_EQ(cpu.step_instruction(), 7);
+  cpu.set_irq_line(false);
+  EXPECT_EQ(cpu.step_instruction(), 6);
+  EXPECT_EQ(cpu.get_pc(), 0x0200);
+  EXPECT_FALSE(cpu.get_flag(nes::Flag::INTERRUPT_DISABLE));
+}
+
+TEST_F(CPUInterruptTest, nmi_is_edge_triggered) {
+  cpu.set_nmi_line(true);
+  EXPECT_TRUE(cpu.is_nmi_pending());
+  EXPECT_EQ(cpu.step_instruction(), 7);
+  EXPECT_EQ(cpu.get_pc(), 0x0000);
+  EXPECT_EQ(pushed_pc(), 0x0200);
+  EXPECT_FALSE(cpu.is_nmi_pending());
+
+  // Holding the line does not retrigger
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.get_pc(), 0x0001);
+
+  // A new edge does
+  cpu.set_nmi_line(false);
+  cpu.set_nmi_line(true);
+  EXPECT_EQ(cpu.step_instruction(), 7);
+  EXPECT_EQ(pushed_pc(), 0x0001);
+}
+
+TEST_F(CPUInterruptTest, nmi_ignores_interrupt_disable_and_wins_over_irq) {
+  cpu.set_flag(nes::Flag::INTERRUPT_DISABLE, true);
+  cpu.set_irq_line(true);
+  cpu.trigger_nmi();
+
+  EXPECT_EQ(cpu.step_instruction(), 7);
+  EXPECT_EQ(cpu.get_pc(), 0x0000);
+
+  // I is set by the NMI entry, so the IRQ stays masked
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.get_pc(), 0x0001);
+}
+
+TEST_F(CPUInterruptTest, reset_drops_latched_nmi) {
+  cpu.trigger_nmi();
+  cpu.reset();
+  EXPECT_FALSE(cpu.is_nmi_pending());
+}
+
+TEST_F(CPUInterruptTest, scheduled_irq_interrupts_cached_blocks) {
+  ASSERT_TRUE(cpu.set_block_cache_enabled(true));
+  bus.write(0x0210, (nes::u8)(nes::Opcode::JMP_ABS));
+  bus.write(0x0211, 0x00);
+  bus.write(0x0212, 0x02);
+
+  nes::Scheduler scheduler;
+  scheduler.schedule(100, [&] { cpu.set_irq_line(true); });
+  cpu.run_until(scheduler, 100);
+  EXPECT_NE(cpu.get_pc(), 0x0300);
+
+  // The interrupt is entered at the boundary right after the event fired
+  EXPECT_EQ(cpu.run(1), 7);
+  EXPECT_EQ(cpu.get_pc(), 0x0300);
+}
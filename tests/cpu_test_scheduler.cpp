@@ -0,0 +1,89 @@
+#include <vector>
+#include "cpu_test_base.h"
+
+class CPUSchedulerTest : public CPUTestBase {
+ protected:
+  nes::Scheduler scheduler;
+
+  void SetUp() override {
+    cpu.reset();
+    cpu.set_pc(0x0200);
+
+    // INX forever: 2 cycles per instruction
+    for (nes::u16 addr = 0x0200; addr < 0x0210; addr++) {
+      bus.write(addr, (nes::u8)(nes::Opcode::INX_IMP));
+    }
+    bus.write(0x0210, (nes::u8)(nes::Opcode::JMP_ABS));
+    bus.write(0x0211, 0x00);
+    bus.write(0x0212, 0x02);
+  }
+};
+
+TEST_F(CPUSchedulerTest, run_until_without_events_reaches_target) {
+  EXPECT_EQ(cpu.run_until(scheduler, 10), 10);
+  EXPECT_EQ(scheduler.get_cycle(), 10);
+  EXPECT_EQ(cpu.get_x(), 5);
+
+  // Targets in the past do nothing
+  EXPECT_EQ(cpu.run_until(scheduler, 4), 0);
+}
+
+TEST_F(CPUSchedulerTest, events_fire_at_first_instruction_boundary) {
+  std::vector<std::pair<nes::u64, nes::u8>> fired;
+  scheduler.schedule(5, [&] { fired.push_back({scheduler.get_cycle(), cpu.get_x()}); });
+  scheduler.schedule(4, [&] { fired.push_back({scheduler.get_cycle(), cpu.get_x()}); });
+
+  cpu.run_until(scheduler, 20);
+
+  // INX takes 2 cycles, so an event at cycle 5 fires after the third one ends at 6
+  ASSERT_EQ(fired.size(), 2u);
+  EXPECT_EQ(fired[0], std::make_pair((nes::u64)4, (nes::u8)2));
+  EXPECT_EQ(fired[1], std::make_pair((nes::u64)6, (nes::u8)3));
+  EXPECT_FALSE(scheduler.has_pending_events());
+}
+
+TEST_F(CPUSchedulerTest, same_cycle_events_fire_in_scheduling_order) {
+  std::vector<int> order;
+  scheduler.schedule(8, [&] { order.push_back(1); });
+  scheduler.schedule(8, [&] { order.push_back(2); });
+  scheduler.schedule(2, [&] { order.push_back(0); });
+
+  cpu.run_until(scheduler, 8);
+  EXPECT_EQ(order, (std::vector<int>{0, 1, 2}));
+}
+
+TEST_F(CPUSchedulerTest, periodic_event_reschedules_itself) {
+  std::vector<nes::u64> ticks;
+  std::function<void()> timer = [&] {
+    ticks.push_back(scheduler.get_cycle());
+    scheduler.schedule_in(10, timer);
+  };
+  scheduler.schedule(10, timer);
+
+  // 16 INX and a 3-cycle JMP make the loop 35 cycles, so cycle 40 falls inside an INX
+  cpu.run_until(scheduler, 45);
+  EXPECT_EQ(ticks, (std::vector<nes::u64>{10, 20, 30, 41}));
+  EXPECT_EQ(scheduler.get_next_event_cycle(), 51);
+}
+
+TEST_F(CPUSchedulerTest, cancelled_events_do_not_fire) {
+  bool fired = false;
+  const nes::Scheduler::EventId id = scheduler.schedule(6, [&] { fired = true; });
+  scheduler.schedule(3, [&] { scheduler.cancel(id); });
+
+  cpu.run_until(scheduler, 10);
+  EXPECT_FALSE(fired);
+  EXPECT_EQ(scheduler.get_next_event_cycle(), nes::Scheduler::NO_EVENT);
+}
+
+TEST_F(CPUSchedulerTest, events_can_change_cpu_state) {
+  // Redirect execution to a DEX loop at cycle 10
+  bus.write(0x0300, (nes::u8)(nes::Opcode::DEX_IMP));
+  bus.write(0x0301, (nes::u8)(nes::Opcode::JMP_ABS));
+  bus.write(0x0302, 0x00);
+  bus.write(0x0303, 0x03);
+  scheduler.schedule(10, [&] { cpu.set_pc(0x0300); });
+
+  cpu.run_until(scheduler, 10 + 5 * 2);
+  EXPECT_EQ(cpu.get_x(), 5 - 2);
+}
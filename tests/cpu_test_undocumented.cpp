@@ -0,0 +1,231 @@
+#include "cpu_test_base.h"
+
+class CPUUndocumentedTest : public CPUTestBase {
+ protected:
+  void SetUp() override {
+    cpu.reset();
+    cpu.set_pc(0x0200);
+  }
+
+  void load(std::initializer_list<nes::u8> bytes) {
+    bus.write_block(cpu.get_pc(), bytes.begin(), bytes.size());
+  }
+
+  // Sets A and X through LDA/LDX so the test program stays at $0200
+  void set_registers(nes::u8 a, nes::u8 x) {
+    load({(nes::u8)nes::Opcode::LDA_IMM, a, (nes::u8)nes::Opcode::LDX_IMM, x});
+    cpu.step_instruction();
+    cpu.step_instruction();
+  }
+};
+
+TEST_F(CPUUndocumentedTest, only_jam_and_unstable_opcodes_remain_unknown) {
+  const nes::u8 unknown[] = {0x02, 0x12, 0x22, 0x32, 0x42, 0x52, 0x62, 0x72, 0x92, 0xB2,
+                             0xD2, 0xF2, 0x8B, 0xAB, 0x93, 0x9F, 0x9C, 0x9E, 0x9B, 0xBB};
+  int valid = 0;
+  for (int opcode = 0; opcode < 256; opcode++) {
+    if (cpu.get_instruction((nes::Opcode)opcode).cycles != 0) valid++;
+  }
+  EXPECT_EQ(valid, 256 - (int)sizeof(unknown));
+  for (nes::u8 opcode : unknown) {
+    EXPECT_EQ(cpu.get_instruction((nes::Opcode)opcode).cycles, 0) << (int)opcode;
+  }
+}
+
+TEST_F(CPUUndocumentedTest, lax_loads_a_and_x) {
+  bus.write(0x0010, 0x80);
+  load({(nes::u8)nes::Opcode::LAX_ZPG, 0x10});
+
+  EXPECT_EQ(cpu.step_instruction(), 3);
+  EXPECT_EQ(cpu.get_accumulator(), 0x80);
+  EXPECT_EQ(cpu.get_x(), 0x80);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::NEGATIVE));
+  EXPECT_FALSE(cpu.get_flag(nes::Flag::ZERO));
+}
+
+TEST_F(CPUUndocumentedTest, lax_aby_takes_page_cross_cycle) {
+  // Y = $01, $00FF + Y crosses into page $01
+  load({(nes::u8)nes::Opcode::LDY_IMM, 0x01, (nes::u8)nes::Opcode::LAX_ABY, 0xFF, 0x00});
+  bus.write(0x0100, 0x42);
+
+  cpu.step_instruction();
+  EXPECT_EQ(cpu.step_instruction(), 5);
+  EXPECT_EQ(cpu.get_x(), 0x42);
+}
+
+TEST_F(CPUUndocumentedTest, sax_stores_a_and_x_without_flags) {
+  set_registers(0xF0, 0x3C);
+  const nes::u8 status = cpu.get_status();
+  load({(nes::u8)nes::Opcode::SAX_ABS, 0x34, 0x02});
+
+  EXPECT_EQ(cpu.step_instruction(), 4);
+  EXPECT_EQ(bus.read(0x0234), 0x30);
+  EXPECT_EQ(cpu.get_status(), status);
+}
+
+TEST_F(CPUUndocumentedTest, dcp_decrements_then_compares) {
+  set_registers(0x40, 0x00);
+  bus.write(0x0010, 0x41);
+  load({(nes::u8)nes::Opcode::DCP_ZPG, 0x10});
+
+  EXPECT_EQ(cpu.step_instruction(), 5);
+  EXPECT_EQ(bus.read(0x0010), 0x40);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::ZERO));
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::CARRY));
+}
+
+TEST_F(CPUUndocumentedTest, isc_increments_then_subtracts) {
+  set_registers(0x10, 0x00);
+  cpu.set_flag(nes::Flag::CARRY, true);
+  bus.write(0x0010, 0x04);
+  load({(nes::u8)nes::Opcode::ISC_ZPG, 0x10});
+
+  EXPECT_EQ(cpu.step_instruction(), 5);
+  EXPECT_EQ(bus.read(0x0010), 0x05);
+  EXPECT_EQ(cpu.get_accumulator(), 0x0B);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::CARRY));
+}
+
+TEST_F(CPUUndocumentedTest, slo_shifts_then_ors) {
+  set_registers(0x01, 0x00);
+  bus.write(0x0010, 0x81);
+  load({(nes::u8)nes::Opcode::SLO_ZPG, 0x10});
+
+  EXPECT_EQ(cpu.step_instruction(), 5);
+  EXPECT_EQ(bus.read(0x0010), 0x02);
+  EXPECT_EQ(cpu.get_accumulator(), 0x03);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::CARRY));
+}
+
+TEST_F(CPUUndocumentedTest, rla_rotates_then_ands) {
+  set_registers(0xFF, 0x00);
+  cpu.set_flag(nes::Flag::CARRY, true);
+  bus.write(0x0010, 0x40);
+  load({(nes::u8)nes::Opcode::RLA_ZPG, 0x10});
+
+  EXPECT_EQ(cpu.step_instruction(), 5);
+  EXPECT_EQ(bus.read(0x0010), 0x81);
+  EXPECT_EQ(cpu.get_accumulator(), 0x81);
+  EXPECT_FALSE(cpu.get_flag(nes::Flag::CARRY));
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::NEGATIVE));
+}
+
+TEST_F(CPUUndocumentedTest, sre_shifts_then_eors) {
+  set_registers(0x0F, 0x00);
+  bus.write(0x0010, 0x03);
+  load({(nes::u8)nes::Opcode::SRE_ZPG, 0x10});
+
+  EXPECT_EQ(cpu.step_instruction(), 5);
+  EXPECT_EQ(bus.read(0x0010), 0x01);
+  EXPECT_EQ(cpu.get_accumulator(), 0x0E);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::CARRY));
+}
+
+TEST_F(CPUUndocumentedTest, rra_rotates_then_adds_with_rotated_carry) {
+  set_registers(0x10, 0x00);
+  cpu.set_flag(nes::Flag::CARRY, false);
+  bus.write(0x0010, 0x03);
+  load({(nes::u8)nes::Opcode::RRA_ZPG, 0x10});
+
+  // $03 ROR = $01 with C set, then A = $10 + $01 + 1
+  EXPECT_EQ(cpu.step_instruction(), 5);
+  EXPECT_EQ(bus.read(0x0010), 0x01);
+  EXPECT_EQ(cpu.get_accumulator(), 0x12);
+  EXPECT_FALSE(cpu.get_flag(nes::Flag::CARRY));
+}
+
+TEST_F(CPUUndocumentedTest, indexed_rmw_always_takes_fixed_cycles) {
+  // X = $01: $00FF + X crosses a page, $0010 + X does not, both cost 7
+  set_registers(0x00, 0x01);
+  load({(nes::u8)nes::Opcode::DCP_ABX, 0xFF, 0x00, (nes::u8)nes::Opcode::ISC_ABX, 0x10, 0x00});
+
+  EXPECT_EQ(cpu.step_instruction(), 7);
+  EXPECT_EQ(cpu.step_instruction(), 7);
+  EXPECT_EQ(bus.read(0x0100), 0xFF);
+  EXPECT_EQ(bus.read(0x0011), 0x01);
+}
+
+TEST_F(CPUUndocumentedTest, anc_copies_bit_seven_into_carry) {
+  set_registers(0xFF, 0x00);
+  load({(nes::u8)nes::Opcode::ANC_IMM, 0x80, (nes::u8)nes::Opcode::ANC_IMM_2B, 0x7F});
+
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.get_accumulator(), 0x80);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::CARRY));
+
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.get_accumulator(), 0x00);
+  EXPECT_FALSE(cpu.get_flag(nes::Flag::CARRY));
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::ZERO));
+}
+
+TEST_F(CPUUndocumentedTest, alr_ands_then_shifts_right) {
+  set_registers(0xFF, 0x00);
+  load({(nes::u8)nes::Opcode::ALR_IMM, 0x03});
+
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.get_accumulator(), 0x01);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::CARRY));
+}
+
+TEST_F(CPUUndocumentedTest, arr_sets_carry_and_overflow_from_result) {
+  set_registers(0xFF, 0x00);
+  cpu.set_flag(nes::Flag::CARRY, true);
+  load({(nes::u8)nes::Opcode::ARR_IMM, 0x40});
+
+  // ($FF AND $40) ROR with C = $A0: bit 6 clear, bit 5 set
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.get_accumulator(), 0xA0);
+  EXPECT_FALSE(cpu.get_flag(nes::Flag::CARRY));
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::OVERFLOW_));
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::NEGATIVE));
+}
+
+TEST_F(CPUUndocumentedTest, axs_subtracts_from_a_and_x) {
+  set_registers(0x0F, 0xFC);
+  load({(nes::u8)nes::Opcode::AXS_IMM, 0x0D});
+
+  // ($0F AND $FC) - $0D = $0C - $0D borrows
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.get_x(), 0xFF);
+  EXPECT_FALSE(cpu.get_flag(nes::Flag::CARRY));
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::NEGATIVE));
+  EXPECT_EQ(cpu.get_accumulator(), 0x0F);
+}
+
+TEST_F(CPUUndocumentedTest, sbc_eb_matches_sbc_immediate) {
+  set_registers(0x50, 0x00);
+  cpu.set_flag(nes::Flag::CARRY, true);
+  load({(nes::u8)nes::Opcode::SBC_IMM_EB, 0x10});
+
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.get_accumulator(), 0x40);
+  EXPECT_TRUE(cpu.get_flag(nes::Flag::CARRY));
+}
+
+TEST_F(CPUUndocumentedTest, multi_byte_nops_skip_operands) {
+  const nes::u8 status = cpu.get_status();
+  load({(nes::u8)nes::Opcode::NOP_IMP_1A,
+        (nes::u8)nes::Opcode::NOP_IMM_80, 0xFF,
+        (nes::u8)nes::Opcode::NOP_ZPG_04, 0x10,
+        (nes::u8)nes::Opcode::NOP_ZPX_14, 0x10,
+        (nes::u8)nes::Opcode::NOP_ABS_0C, 0x00, 0x03,
+        (nes::u8)nes::Opcode::NOP_ABX_1C, 0x00, 0x03});
+
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.step_instruction(), 2);
+  EXPECT_EQ(cpu.step_instruction(), 3);
+  EXPECT_EQ(cpu.step_instruction(), 4);
+  EXPECT_EQ(cpu.step_instruction(), 4);
+  EXPECT_EQ(cpu.step_instruction(), 4);
+  EXPECT_EQ(cpu.get_pc(), 0x020D);
+  EXPECT_EQ(cpu.get_status(), status);
+}
+
+TEST_F(CPUUndocumentedTest, nop_abx_takes_page_cross_cycle) {
+  set_registers(0x00, 0x01);
+  load({(nes::u8)nes::Opcode::NOP_ABX_FC, 0xFF, 0x02});
+
+  EXPECT_EQ(cpu.step_instruction(), 5);
+  EXPECT_EQ(cpu.get_pc(), 0x0207);
+}